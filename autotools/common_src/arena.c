@@ -0,0 +1,93 @@
+/**
+ * A region allocator shared by ls and find. Both build a batch of small
+ *   objects, names, nodes and stat structs, that all die together at the end
+ *   of a run, so rather than allocating and freeing each one they are carved
+ *   in order from large chunks, and the whole batch is freed with a single
+ *   reset. The first chunk is kept across resets, so a program listing many
+ *   small directories allocates it once.
+ */
+#include "arena.h"
+
+/**
+ * Initializes arena with no chunks.
+ */
+void arena_create(arena_t *arena) {
+    arena->chunks = NULL;
+    arena->bytes = 0;
+    arena->alloc_c = 0;
+    arena->chunk_c = 0;
+}
+
+/**
+ * Carves size bytes, rounded up to ARENA_ALIGN, from arena's newest chunk,
+ *   starting a new one of ARENA_CHUNK bytes, or of size if it is larger, when
+ *   it doesn't have room.
+ * Returns the memory on success and NULL if memory allocation fails.
+ */
+void* arena_alloc(arena_t *arena, size_t size) {
+    arena_chunk *chunk = arena->chunks;
+    void *ret = NULL;
+
+    size = (size + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+    if (chunk == NULL || chunk->used + size > chunk->size) {
+        errno = 0;
+        chunk = malloc(sizeof(arena_chunk) + \
+            (size > ARENA_CHUNK ? size : ARENA_CHUNK));
+        if (chunk != NULL) {
+            chunk->next = arena->chunks;
+            chunk->size = size > ARENA_CHUNK ? size : ARENA_CHUNK;
+            chunk->used = 0;
+            arena->chunks = chunk;
+            arena->chunk_c++;
+        }
+    }
+    if (chunk != NULL) {
+        ret = chunk->data + chunk->used;
+        chunk->used += size;
+        arena->bytes += size;
+        arena->alloc_c++;
+    }
+    return ret;
+}
+
+/**
+ * Copies the first len bytes of s into memory carved from arena, followed by
+ *   '\0'.
+ * Returns the copy on success and NULL if memory allocation fails.
+ */
+char* arena_strndup(arena_t *arena, const char *s, size_t len) {
+    char *ret = NULL;
+
+    ret = arena_alloc(arena, len + 1);
+    if (ret != NULL) {
+        memcpy(ret, s, len);
+        ret[len] = '\0';
+    }
+    return ret;
+}
+
+/**
+ * Frees every chunk of arena but its oldest, which is emptied for reuse.
+ */
+void arena_reset(arena_t *arena) {
+    arena_chunk *next = NULL;
+
+    while (arena->chunks != NULL && arena->chunks->next != NULL) {
+        next = arena->chunks->next;
+        free(arena->chunks);
+        arena->chunks = next;
+    }
+    if (arena->chunks != NULL) {
+        arena->chunks->used = 0;
+    }
+    arena->bytes = 0;
+}
+
+/**
+ * Frees every chunk of arena, leaving it empty.
+ */
+void arena_delete(arena_t *arena) {
+    arena_reset(arena);
+    free(arena->chunks);
+    arena->chunks = NULL;
+}
@@ -0,0 +1,51 @@
+#ifndef __ARENA_H
+#define __ARENA_H
+#include <stddef.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+
+// Bytes of the chunks an arena carves memory from, and the alignment of each
+//   piece carved, enough for any object
+#define ARENA_CHUNK (1 << 16)
+#define ARENA_ALIGN _Alignof(max_align_t)
+
+typedef struct arena_chunk_s arena_chunk;
+typedef struct arena_s arena_t;
+
+// A block of memory pieces are carved from.
+struct arena_chunk_s {
+    arena_chunk *next;
+    size_t size;
+    size_t used;
+    _Alignas(max_align_t) char data[];
+};
+
+// Memory for objects that all live as long as one run, whether a listing of
+//   ls or a sorted batch of find's matches, and are freed all at once. bytes
+//   counts what has been carved since the last reset. alloc_c counts the
+//   pieces carved and chunk_c the chunks allocated over the arena's life, so
+//   tests can check how many allocations a run made.
+struct arena_s {
+    arena_chunk *chunks;
+    size_t bytes;
+    unsigned long alloc_c;
+    unsigned long chunk_c;
+};
+
+// Initializes an empty arena. arena must already be allocated.
+void arena_create(arena_t *arena);
+
+// Carves size bytes out of arena, valid until it is reset.
+void* arena_alloc(arena_t *arena, size_t size);
+
+// Copies the first len bytes of s into arena, '\0'-terminated.
+char* arena_strndup(arena_t *arena, const char *s, size_t len);
+
+// Frees everything carved from arena at once, keeping its first chunk.
+void arena_reset(arena_t *arena);
+
+// Frees all of arena's memory.
+void arena_delete(arena_t *arena);
+
+#endif /* __ARENA_H */
@@ -0,0 +1,175 @@
+/**
+ * Long format pieces shared by ls -l and find -ls: the mode string, the date
+ *   string and user and group names. Looking up a name goes through NSS, which
+ *   can mean reading /etc/passwd or asking a remote directory, so the names of
+ *   recently seen ids are cached, as are the date strings of the most recently
+ *   seen minute. A tree is mostly owned by a handful of users, so after the
+ *   first few files formatting a file in long format makes no lookups at all.
+ * Lookups use the reentrant forms of getpwuid, getgrgid and localtime, so
+ *   formatting with separate caches is safe on separate threads.
+ */
+#include "long_fmt.h"
+
+/**
+ * Empties every cache of fmt.
+ */
+void long_fmt_init(long_fmt_t *fmt) {
+    memset(fmt, 0, sizeof(long_fmt_t));
+}
+
+/**
+ * Gets the user name of uid from fmt's cache, looking it up and caching it if
+ *   it isn't there. A uid without a user name gets its decimal value instead.
+ * Returns the name, storing its length in len.
+ */
+const char* long_fmt_usr(long_fmt_t *fmt, uid_t uid, size_t *len) {
+    struct name_slot *slot = &(fmt->usr[uid % LONG_FMT_CACHE_SLOTS]);
+    struct passwd passwd, *passwd_ent = NULL;
+    char buf[LONG_FMT_LOOKUP_BUF];
+
+    if (!slot->used || slot->id != uid) {
+        getpwuid_r(uid, &passwd, buf, LONG_FMT_LOOKUP_BUF, &passwd_ent);
+        name_slot_set(slot, uid, passwd_ent != NULL ? \
+            passwd_ent->pw_name : NULL);
+    }
+    *len = slot->len;
+    return slot->name;
+}
+
+/**
+ * Gets the group name of gid from fmt's cache, looking it up and caching it if
+ *   it isn't there. A gid without a group name gets its decimal value instead.
+ * Returns the name, storing its length in len.
+ */
+const char* long_fmt_grp(long_fmt_t *fmt, gid_t gid, size_t *len) {
+    struct name_slot *slot = &(fmt->grp[gid % LONG_FMT_CACHE_SLOTS]);
+    struct group group, *group_ent = NULL;
+    char buf[LONG_FMT_LOOKUP_BUF];
+
+    if (!slot->used || slot->id != gid) {
+        getgrgid_r(gid, &group, buf, LONG_FMT_LOOKUP_BUF, &group_ent);
+        name_slot_set(slot, gid, group_ent != NULL ? \
+            group_ent->gr_name : NULL);
+    }
+    *len = slot->len;
+    return slot->name;
+}
+
+/**
+ * Fills slot with id and name, truncated to LONG_FMT_NAME_MAX, or with the
+ *   decimal value of id if name is NULL.
+ */
+void name_slot_set(struct name_slot *slot, unsigned long id, \
+        const char *name) {
+    char digits[LONG_FMT_NAME_MAX + 1];
+    unsigned long val = id;
+    int i = LONG_FMT_NAME_MAX;
+
+    if (name == NULL) {
+        digits[i] = '\0';
+        do {
+            digits[--i] = '0' + val % 10;
+            val /= 10;
+        } while (val > 0);
+        name = digits + i;
+    }
+    slot->used = true;
+    slot->id = id;
+    slot->len = strnlen(name, LONG_FMT_NAME_MAX);
+    memcpy(slot->name, name, slot->len);
+    slot->name[slot->len] = '\0';
+}
+
+/**
+ * Gets the date string of mtim. Every time in the same minute has the same
+ *   string, so it is only formatted again when the minute changes.
+ * Returns the date string, or NULL if it can't be formatted.
+ */
+const char* long_fmt_mtim(long_fmt_t *fmt, time_t mtim) {
+    time_t min = mtim / LONG_FMT_SEC_PER_MIN;
+    const char *ret = fmt->mtim_str;
+
+    if (mtim % LONG_FMT_SEC_PER_MIN < 0) {
+        min--;
+    }
+    if (!fmt->mtim_used || fmt->mtim_min != min) {
+        fmt->mtim_used = parse_mtim_str(fmt->mtim_str, mtim) == 0;
+        fmt->mtim_min = min;
+        if (!fmt->mtim_used) {
+            ret = NULL;
+        }
+    }
+    return ret;
+}
+
+/**
+ * Fills a fixed sized character sequence representing important data from
+ *   mode, as ls -l prints it: the file type followed by the read, write and
+ *   execute permissions of the owner, group and others, with the
+ *   set-user-ID, set-group-ID and sticky bits shown in place of the execute
+ *   permission they go with.
+ */
+void parse_mode_str(char *mode_s, mode_t mode) {
+    mode_s[0] = mode_type_char(mode);
+    mode_s[1] = S_IRUSR & mode ? 'r' : '-';
+    mode_s[2] = S_IWUSR & mode ? 'w' : '-';
+    mode_s[3] = mode_exec_char(mode, S_IXUSR, S_ISUID, 's');
+    mode_s[4] = S_IRGRP & mode ? 'r' : '-';
+    mode_s[5] = S_IWGRP & mode ? 'w' : '-';
+    mode_s[6] = mode_exec_char(mode, S_IXGRP, S_ISGID, 's');
+    mode_s[7] = S_IROTH & mode ? 'r' : '-';
+    mode_s[8] = S_IWOTH & mode ? 'w' : '-';
+    mode_s[9] = mode_exec_char(mode, S_IXOTH, S_ISVTX, 't');
+    mode_s[10] = '\0';
+}
+
+/**
+ * Gets the char shown for the execute permission exec of mode, which shares
+ *   its place with the special bit shown as c.
+ * Returns c if both are set, c in uppercase if only the special bit is, and
+ *   'x' or '-' otherwise.
+ */
+char mode_exec_char(mode_t mode, mode_t exec, mode_t special, char c) {
+    char ret = exec & mode ? 'x' : '-';
+
+    if (special & mode) {
+        ret = exec & mode ? c : c - 'a' + 'A';
+    }
+    return ret;
+}
+
+/** 
+ * Gets the formatted date from mtim.
+ * Returns 0 on success and -1 if the parsing failed.
+ */
+int parse_mtim_str(char *mtim_str, time_t mtim) {
+    struct tm tm, *t;
+    int ret = 0;
+    
+    t = localtime_r(&mtim, &tm);
+    errno = 0;
+    if (t == NULL || strftime(mtim_str, DATE_STR_LEN, "%b %e %H:%M", t) == 0) {
+        ret = -1;
+    }
+    
+    return ret;
+}
+
+/**
+ * Returns the character representation of the filetype of mode, and a '?'
+ *   if the filetype is invalid.
+ */
+char mode_type_char(mode_t mode) {
+    static const char type_char[] = {'b', 'c', 'd', '-', 'l', 'p', 's', '?'};
+    static const mode_t type[] = {S_IFBLK, S_IFCHR, S_IFDIR, S_IFREG, S_IFLNK, \
+        S_IFIFO, S_IFSOCK};
+    static const int type_c = 7;
+    
+    mode &= S_IFMT;
+    int i = 0;
+    while (i < type_c && type[i] != mode) {
+        i++;
+    }
+
+    return type_char[i];
+}
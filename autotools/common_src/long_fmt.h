@@ -0,0 +1,76 @@
+#ifndef __LONG_FMT_H
+#define __LONG_FMT_H
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <pwd.h>
+#include <grp.h>
+#include <time.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+
+// Sizes of the strings filled by parse_mode_str and parse_mtim_str, '\0'
+//   included
+#define MODE_STR_LEN 11
+#define DATE_STR_LEN 13
+// Number of ids each name cache holds, and the longest name it stores
+#define LONG_FMT_CACHE_SLOTS 64
+#define LONG_FMT_NAME_MAX 255
+// Seconds covered by one formatted date
+#define LONG_FMT_SEC_PER_MIN 60
+// Size of the buffer a user or group entry is looked up in
+#define LONG_FMT_LOOKUP_BUF 4096
+
+typedef struct long_fmt_s long_fmt_t;
+
+// A cached name for a uid or gid
+struct name_slot {
+    bool used;
+    unsigned long id;
+    char name[LONG_FMT_NAME_MAX + 1];
+    size_t len;
+};
+
+// Caches for the lookups done when formatting files in long format: the user
+//   and group names of recently seen ids, and the date string of the most
+//   recently seen minute. A long_fmt_t that is all zero, like a static one, is
+//   already initialized.
+struct long_fmt_s {
+    struct name_slot usr[LONG_FMT_CACHE_SLOTS];
+    struct name_slot grp[LONG_FMT_CACHE_SLOTS];
+
+    bool mtim_used;
+    time_t mtim_min;
+    char mtim_str[DATE_STR_LEN];
+};
+
+// Empties every cache of fmt.
+void long_fmt_init(long_fmt_t *fmt);
+
+// Gets the user name of uid, or uid as a string if it has none, storing its
+//   length in len. The name is valid until the next call with fmt.
+const char* long_fmt_usr(long_fmt_t *fmt, uid_t uid, size_t *len);
+
+// Gets the group name of gid, or gid as a string if it has none, storing its
+//   length in len. The name is valid until the next call with fmt.
+const char* long_fmt_grp(long_fmt_t *fmt, gid_t gid, size_t *len);
+
+// Gets the date string of mtim, or NULL if it can't be formatted. The string
+//   is valid until the next call with fmt.
+const char* long_fmt_mtim(long_fmt_t *fmt, time_t mtim);
+
+// Helper for long_fmt_usr and long_fmt_grp
+void name_slot_set(struct name_slot *slot, unsigned long id, \
+    const char *name);
+
+// Fills mode_str with a fixed-size character representation of mode.
+void parse_mode_str(char *mode_str, mode_t mode);
+
+// Finds the formatted date for mtim. Returns 0 on success and -1 on failure.
+int parse_mtim_str(char *mtim_str, time_t mtim);
+
+// Helpers for parse_mode_str
+char mode_type_char(mode_t mode);
+char mode_exec_char(mode_t mode, mode_t exec, mode_t special, char c);
+
+#endif /* __LONG_FMT_H */
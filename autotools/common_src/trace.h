@@ -0,0 +1,26 @@
+#ifndef __TRACE_H
+#define __TRACE_H
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+// Static tracepoints for perf, bpftrace and other USDT consumers, named
+//   provider:name. Configured with --enable-usdt they are sys/sdt.h probes,
+//   a single nop and an ELF note each until a tracer attaches to them, so
+//   they can stay in production builds. Otherwise they compile to nothing and
+//   their arguments are not evaluated.
+#ifdef ENABLE_USDT
+#include <sys/sdt.h>
+#define TRACE0(provider, name) DTRACE_PROBE(provider, name)
+#define TRACE1(provider, name, a) DTRACE_PROBE1(provider, name, a)
+#define TRACE2(provider, name, a, b) DTRACE_PROBE2(provider, name, a, b)
+#define TRACE3(provider, name, a, b, c) \
+    DTRACE_PROBE3(provider, name, a, b, c)
+#else
+#define TRACE0(provider, name) ((void)0)
+#define TRACE1(provider, name, a) ((void)0)
+#define TRACE2(provider, name, a, b) ((void)0)
+#define TRACE3(provider, name, a, b, c) ((void)0)
+#endif
+
+#endif /* __TRACE_H */
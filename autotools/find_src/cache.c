@@ -0,0 +1,443 @@
+/**
+ * An in-memory copy of a file tree's metadata, for findd to answer queries
+ *   from without touching the file system. The tree is read once, and every
+ *   directory in it gets an inotify watch, so afterwards only the files that
+ *   changed are read again: a file created, moved in or changed in a watched
+ *   directory is stat'd again, a new directory is scanned, and a file deleted
+ *   or moved out is dropped along with everything below it. If the kernel's
+ *   queue of events overflows, the whole tree is read again.
+ * Children are kept sorted by name, so a change can find its node by binary
+ *   search. A freshly scanned directory is sorted once, rather than inserting
+ *   into it name by name.
+ */
+#include "cache.h"
+
+/**
+ * Resolves root to its real path and scans it into cache, watching each of
+ *   its directories.
+ * Returns 0 on success and -1 if root can't be resolved, inotify can't be
+ *   started or memory allocation fails, with errno set.
+ */
+int cache_open(cache_t *cache, char *root) {
+    size_t len = 0;
+    int ret = 0;
+
+    cache->top = NULL;
+    cache->watches = NULL;
+    cache->watch_max = 0;
+    cache->path = NULL;
+    cache->path_max = 0;
+    errno = 0;
+    cache->inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    cache->root = realpath(root, NULL);
+    if (cache->inotify_fd < 0 || cache->root == NULL || \
+            cache_set_path(cache, 0, cache->root, &len) < 0 || \
+            (cache->top = calloc(1, sizeof(cache_node))) == NULL || \
+            (cache->top->name = strdup(cache->root)) == NULL) {
+        ret = -1;
+    }
+    else {
+        cache->top->wd = -1;
+        if (lstat(cache->path, &(cache->top->st)) < 0) {
+            cache->top->err = errno;
+        }
+        else if (S_ISDIR(cache->top->st.st_mode)) {
+            ret = cache_scan(cache, cache->top, len);
+        }
+    }
+    if (ret < 0) {
+        cache_close(cache);
+    }
+    return ret;
+}
+
+/**
+ * Reads the events queued on cache's inotify descriptor until there are none
+ *   left and applies each of them.
+ * Returns 0 on success and -1 if reading fails or memory allocation fails.
+ */
+int cache_update(cache_t *cache) {
+    char buf[CACHE_EVENT_BUF] \
+        __attribute__((aligned(__alignof__(struct inotify_event))));
+    struct inotify_event *event = NULL;
+    ssize_t n = 1;
+    int ret = 0;
+
+    while (n > 0 && ret == 0) {
+        errno = 0;
+        n = read(cache->inotify_fd, buf, CACHE_EVENT_BUF);
+        if (n < 0 && errno != EAGAIN && errno != EINTR) {
+            ret = -1;
+        }
+        for (char *p = buf; p < buf + n && ret == 0; \
+                p += sizeof(struct inotify_event) + event->len) {
+            event = (struct inotify_event*)p;
+            ret = cache_event(cache, event);
+        }
+    }
+    return ret;
+}
+
+/**
+ * Follows each '/' separated component of rel down from cache's root.
+ * Returns the node rel names, or NULL if it isn't cached.
+ */
+cache_node* cache_lookup(cache_t *cache, char *rel) {
+    cache_node *ret = cache->top;
+    char *name = rel, *end = NULL;
+    size_t len = 0;
+    int pos = 0;
+
+    while (ret != NULL && *name != '\0') {
+        end = strchr(name, '/');
+        len = end != NULL ? (size_t)(end - name) : strlen(name);
+        if (len > 0 && len <= NAME_MAX) {
+            memcpy(cache->path, name, len);
+            cache->path[len] = '\0';
+            ret = cache_find(ret, cache->path, &pos);
+        }
+        else if (len > NAME_MAX) {
+            ret = NULL;
+        }
+        name += len + (end != NULL ? 1 : 0);
+    }
+    return ret;
+}
+
+/**
+ * Copies name into cache's path after its first dir_len bytes, separated by
+ *   a '/' unless dir_len is 0 or the path already ends in one, growing the
+ *   path as needed.
+ * Returns 0 on success and -1 if memory allocation fails.
+ */
+int cache_set_path(cache_t *cache, size_t dir_len, char *name, size_t *len) {
+    char *path = NULL;
+    size_t name_len = strlen(name), path_max = cache->path_max;
+    int ret = 0;
+
+    *len = dir_len;
+    if (dir_len > 0 && cache->path[dir_len - 1] != '/') {
+        (*len)++;
+    }
+    if (path_max < NAME_MAX + 1 || *len + name_len + 1 > path_max) {
+        if (path_max == 0) {
+            path_max = CACHE_PATH_INIT_MAX;
+        }
+        while (path_max < NAME_MAX + 1 || *len + name_len + 1 > path_max) {
+            path_max *= 2;
+        }
+        errno = 0;
+        path = realloc(cache->path, path_max);
+        if (path == NULL) {
+            ret = -1;
+        }
+        else {
+            cache->path = path;
+            cache->path_max = path_max;
+        }
+    }
+    if (ret == 0) {
+        if (*len > dir_len) {
+            cache->path[dir_len] = '/';
+        }
+        memcpy(cache->path + *len, name, name_len + 1);
+        *len += name_len;
+    }
+    return ret;
+}
+
+/**
+ * Deletes every node of cache, closes its inotify descriptor and frees its
+ *   buffers.
+ */
+void cache_close(cache_t *cache) {
+    if (cache->top != NULL) {
+        cache_node_delete(cache, cache->top);
+    }
+    if (cache->inotify_fd >= 0) {
+        close(cache->inotify_fd);
+    }
+    free(cache->root);
+    free(cache->watches);
+    free(cache->path);
+    cache->top = NULL;
+    cache->root = NULL;
+    cache->watches = NULL;
+    cache->path = NULL;
+    cache->inotify_fd = -1;
+}
+
+/**
+ * Creates a node for the file name in dir, whose path is the first dir_len
+ *   bytes of cache's path, stats it and scans it if it is a directory. It is
+ *   inserted among dir's children at pos, or appended if pos is -1, leaving
+ *   them to be sorted.
+ * Returns the node on success and NULL if memory allocation fails.
+ */
+cache_node* cache_add(cache_t *cache, cache_node *dir, char *name, \
+        size_t dir_len, int pos) {
+    cache_node *ret = NULL, **children = NULL;
+    size_t len = 0;
+    int child_max = dir->child_max == 0 ? CACHE_INIT_MAX : dir->child_max * 2;
+
+    errno = 0;
+    if (dir->child_c == dir->child_max) {
+        children = realloc(dir->children, sizeof(cache_node*) * child_max);
+        if (children != NULL) {
+            dir->children = children;
+            dir->child_max = child_max;
+        }
+    }
+    if (dir->child_c < dir->child_max && \
+            (ret = calloc(1, sizeof(cache_node))) != NULL && \
+            ((ret->name = strdup(name)) == NULL || \
+            cache_set_path(cache, dir_len, name, &len) < 0)) {
+        free(ret->name);
+        free(ret);
+        ret = NULL;
+    }
+    if (ret != NULL) {
+        ret->parent = dir;
+        ret->wd = -1;
+        if (pos < 0) {
+            pos = dir->child_c;
+        }
+        memmove(&(dir->children[pos + 1]), &(dir->children[pos]), \
+            sizeof(cache_node*) * (dir->child_c - pos));
+        dir->children[pos] = ret;
+        dir->child_c++;
+        if (lstat(cache->path, &(ret->st)) < 0) {
+            ret->err = errno;
+            memset(&(ret->st), 0, sizeof(struct stat));
+        }
+        else if (S_ISDIR(ret->st.st_mode) && cache_scan(cache, ret, len) < 0) {
+            ret = NULL;
+        }
+    }
+    return ret;
+}
+
+/**
+ * Watches dir, whose path is the first len bytes of cache's path, and adds a
+ *   node for each file in it, then sorts them. A directory that can't be
+ *   read is left without children.
+ * Returns 0 on success and -1 if memory allocation fails.
+ */
+int cache_scan(cache_t *cache, cache_node *dir, size_t len) {
+    DIR *d = NULL;
+    struct dirent *ent = NULL;
+    int ret = 0;
+
+    ret = cache_watch(cache, dir);
+    errno = 0;
+    d = ret == 0 ? opendir(cache->path) : NULL;
+    if (d != NULL) {
+        ent = readdir(d);
+        while (ent != NULL && ret == 0) {
+            if (strcmp(ent->d_name, ".") != 0 && \
+                    strcmp(ent->d_name, "..") != 0 && \
+                    cache_add(cache, dir, ent->d_name, len, -1) == NULL) {
+                ret = -1;
+            }
+            ent = readdir(d);
+        }
+        closedir(d);
+        qsort(dir->children, dir->child_c, sizeof(cache_node*), \
+            compare_nodes);
+    }
+    return ret;
+}
+
+/**
+ * Adds an inotify watch for dir, at cache's path, and maps it to dir. A
+ *   directory that can't be watched, for lack of permission or watches, is
+ *   cached all the same but won't be kept fresh.
+ * Returns 0 on success and -1 if memory allocation fails.
+ */
+int cache_watch(cache_t *cache, cache_node *dir) {
+    cache_node **watches = NULL;
+    int watch_max = cache->watch_max, ret = 0;
+
+    dir->wd = inotify_add_watch(cache->inotify_fd, cache->path, CACHE_EVENTS);
+    if (dir->wd >= watch_max) {
+        if (watch_max == 0) {
+            watch_max = CACHE_INIT_MAX;
+        }
+        while (dir->wd >= watch_max) {
+            watch_max *= 2;
+        }
+        errno = 0;
+        watches = realloc(cache->watches, sizeof(cache_node*) * watch_max);
+        if (watches == NULL) {
+            ret = -1;
+        }
+        else {
+            memset(&(watches[cache->watch_max]), 0, \
+                sizeof(cache_node*) * (watch_max - cache->watch_max));
+            cache->watches = watches;
+            cache->watch_max = watch_max;
+        }
+    }
+    if (ret == 0 && dir->wd >= 0) {
+        cache->watches[dir->wd] = dir;
+    }
+    else if (ret < 0) {
+        inotify_rm_watch(cache->inotify_fd, dir->wd);
+        dir->wd = -1;
+    }
+    return ret;
+}
+
+/**
+ * Deletes the child of dir at pos and everything below it, closing the gap
+ *   it leaves.
+ */
+void cache_remove(cache_t *cache, cache_node *dir, int pos) {
+    cache_node_delete(cache, dir->children[pos]);
+    dir->child_c--;
+    memmove(&(dir->children[pos]), &(dir->children[pos + 1]), \
+        sizeof(cache_node*) * (dir->child_c - pos));
+}
+
+/**
+ * Deletes node and its children, removing the watch of every directory.
+ */
+void cache_node_delete(cache_t *cache, cache_node *node) {
+    for (int i = 0; i < node->child_c; i++) {
+        cache_node_delete(cache, node->children[i]);
+    }
+    if (node->wd >= 0) {
+        inotify_rm_watch(cache->inotify_fd, node->wd);
+        cache->watches[node->wd] = NULL;
+    }
+    free(node->children);
+    free(node->name);
+    free(node);
+}
+
+/**
+ * Binary searches the children of dir for name.
+ * Returns the child named name, or NULL if there is none, with pos set to
+ *   where it is or would be inserted either way.
+ */
+cache_node* cache_find(cache_node *dir, char *name, int *pos) {
+    cache_node *ret = NULL;
+    int low = 0, high = dir->child_c, mid = 0, cmp = 0;
+
+    while (ret == NULL && low < high) {
+        mid = low + (high - low) / 2;
+        cmp = strcmp(name, dir->children[mid]->name);
+        if (cmp == 0) {
+            ret = dir->children[mid];
+            low = mid;
+        }
+        else if (cmp < 0) {
+            high = mid;
+        }
+        else {
+            low = mid + 1;
+        }
+    }
+    *pos = low;
+    return ret;
+}
+
+/**
+ * Sets cache's path to the path of node, built from the names of its
+ *   ancestors, and len to its length.
+ * Returns 0 on success and -1 if memory allocation fails.
+ */
+int cache_node_path(cache_t *cache, cache_node *node, size_t *len) {
+    int ret = 0;
+
+    if (node->parent == NULL) {
+        ret = cache_set_path(cache, 0, cache->root, len);
+    }
+    else {
+        ret = cache_node_path(cache, node->parent, len);
+        if (ret == 0) {
+            ret = cache_set_path(cache, *len, node->name, len);
+        }
+    }
+    return ret;
+}
+
+/**
+ * Applies event to cache. A file named by an event is stat'd again: if it is
+ *   gone it is removed, if it was created or moved in it is added anew,
+ *   replacing any node of that name, and otherwise its stat struct is
+ *   updated. An event on a directory itself updates its stat struct, and an
+ *   overflowed queue reads the whole tree again. Events of watches no longer
+ *   mapped are dropped.
+ * Returns 0 on success and -1 if memory allocation fails.
+ */
+int cache_event(cache_t *cache, struct inotify_event *event) {
+    cache_node *dir = NULL, *node = NULL;
+    struct stat st;
+    size_t len = 0, dir_len = 0;
+    int pos = 0, ret = 0;
+
+    if (event->mask & IN_Q_OVERFLOW) {
+        while (cache->top->child_c > 0) {
+            cache_remove(cache, cache->top, cache->top->child_c - 1);
+        }
+        if (cache->top->wd >= 0) {
+            inotify_rm_watch(cache->inotify_fd, cache->top->wd);
+            cache->watches[cache->top->wd] = NULL;
+        }
+        ret = cache_node_path(cache, cache->top, &len);
+        if (ret == 0 && S_ISDIR(cache->top->st.st_mode)) {
+            ret = cache_scan(cache, cache->top, len);
+        }
+    }
+    else if (event->wd >= 0 && event->wd < cache->watch_max) {
+        dir = cache->watches[event->wd];
+    }
+    if (dir != NULL && (event->mask & IN_IGNORED)) {
+        cache->watches[event->wd] = NULL;
+        dir->wd = -1;
+    }
+    else if (dir != NULL && event->len > 0) {
+        node = cache_find(dir, event->name, &pos);
+        ret = cache_node_path(cache, dir, &dir_len);
+        if (ret == 0) {
+            ret = cache_set_path(cache, dir_len, event->name, &len);
+        }
+        if (ret == 0 && lstat(cache->path, &st) < 0) {
+            if (node != NULL) {
+                cache_remove(cache, dir, pos);
+            }
+        }
+        else if (ret == 0 && (node == NULL || \
+                (event->mask & (IN_CREATE | IN_MOVED_TO)) || \
+                (S_ISDIR(st.st_mode) != S_ISDIR(node->st.st_mode)))) {
+            if (node != NULL) {
+                cache_remove(cache, dir, pos);
+            }
+            if (cache_add(cache, dir, event->name, dir_len, pos) == NULL) {
+                ret = -1;
+            }
+        }
+        else if (ret == 0) {
+            node->st = st;
+            node->err = 0;
+        }
+    }
+    else if (dir != NULL) {
+        ret = cache_node_path(cache, dir, &len);
+        if (ret == 0 && lstat(cache->path, &st) == 0) {
+            dir->st = st;
+        }
+    }
+    return ret;
+}
+
+/**
+ * Compares the names of the nodes a and b point to, for qsort.
+ * Returns a negative number, 0 or a positive number if a's name is less
+ *   than, equal to or greater than b's respectively.
+ */
+int compare_nodes(const void *a, const void *b) {
+    return strcmp((*(cache_node* const*)a)->name, \
+        (*(cache_node* const*)b)->name);
+}
@@ -0,0 +1,83 @@
+#ifndef __CACHE_H
+#define __CACHE_H
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/inotify.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <limits.h>
+#include <dirent.h>
+#include <unistd.h>
+
+// Initial number of children a directory and watches a cache have room for,
+//   and bytes of the path being built
+#define CACHE_INIT_MAX 8
+#define CACHE_PATH_INIT_MAX 256
+// Events watched on every cached directory
+#define CACHE_EVENTS (IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | \
+    IN_ATTRIB | IN_MODIFY | IN_ONLYDIR | IN_DONT_FOLLOW)
+// Size of the buffer inotify events are read into
+#define CACHE_EVENT_BUF (1 << 16)
+
+typedef struct cache_node cache_node;
+typedef struct cache_s cache_t;
+
+// A cached file with its stat struct, or the errno of stating it if err is
+//   not 0. A directory also has its children, sorted by name, and the watch
+//   keeping them fresh, -1 if it couldn't be watched.
+struct cache_node {
+    char *name;
+    struct stat st;
+    int err;
+    int wd;
+    cache_node *parent;
+    cache_node **children;
+    int child_c;
+    int child_max;
+};
+
+// A tree of cached files rooted at the real path root, kept fresh by an
+//   inotify watch on each directory. watches maps a watch to its directory.
+struct cache_s {
+    char *root;
+    cache_node *top;
+    int inotify_fd;
+    cache_node **watches;
+    int watch_max;
+    // Path being built while scanning or walking the cache.
+    char *path;
+    size_t path_max;
+};
+
+// Reads the tree at root into cache, watching every directory.
+int cache_open(cache_t *cache, char *root);
+
+// Applies every pending change to cache, without blocking.
+int cache_update(cache_t *cache);
+
+// Gets the node of the file at rel, a path relative to cache's root, or NULL
+//   if it isn't cached. An empty rel is the root.
+cache_node* cache_lookup(cache_t *cache, char *rel);
+
+// Sets the path of cache to the path of dir_len bytes already in it followed
+//   by name, and len to its length.
+int cache_set_path(cache_t *cache, size_t dir_len, char *name, size_t *len);
+
+// Frees every node of cache and closes its watches.
+void cache_close(cache_t *cache);
+
+// Helpers for building and updating the tree
+cache_node* cache_add(cache_t *cache, cache_node *dir, char *name, \
+    size_t dir_len, int pos);
+int cache_scan(cache_t *cache, cache_node *dir, size_t len);
+int cache_watch(cache_t *cache, cache_node *dir);
+void cache_remove(cache_t *cache, cache_node *dir, int pos);
+void cache_node_delete(cache_t *cache, cache_node *node);
+cache_node* cache_find(cache_node *dir, char *name, int *pos);
+int cache_node_path(cache_t *cache, cache_node *node, size_t *len);
+int cache_event(cache_t *cache, struct inotify_event *event);
+int compare_nodes(const void *a, const void *b);
+
+#endif /* __CACHE_H */
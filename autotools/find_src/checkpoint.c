@@ -0,0 +1,173 @@
+/**
+ * Checkpoints of a long traversal, so it can be resumed after find is killed
+ *   instead of starting over. A checkpoint holds the frontier of a streaming
+ *   walk, the stack of directories being walked and the subdirectories each
+ *   has left, followed by what every output holds: the runs a sorting output
+ *   has spilled, which are kept under the checkpoint's path, as streaming
+ *   outputs hold nothing once written out.
+ * Checkpoints are only taken between directory listings, when the frontier
+ *   is made of whole directories, and at most every interval seconds. Files
+ *   matched after the last checkpoint are evaluated again on resume, so a
+ *   streaming output may print them twice.
+ * The runs a checkpoint keeps are spilled before it replaces the last one,
+ *   so if find is killed in between they are only named by the temporary
+ *   file left behind. Resuming or finishing the traversal reads that file
+ *   and removes them.
+ */
+#include "checkpoint.h"
+
+/**
+ * Initializes checkpoint with path and interval, allocating the path of its
+ *   temporary file. The interval starts now.
+ * Returns 0 on success and -1 if memory allocation fails.
+ */
+int checkpoint_create(checkpoint_t *checkpoint, char *path, long interval) {
+    int ret = 0;
+
+    checkpoint->path = path;
+    checkpoint->interval = interval;
+    clock_gettime(CLOCK_MONOTONIC, &(checkpoint->last));
+    errno = 0;
+    checkpoint->tmp_path = malloc(strlen(path) + \
+        sizeof(CHECKPOINT_TMP_SUFFIX));
+    if (checkpoint->tmp_path == NULL) {
+        ret = -1;
+    }
+    else {
+        sprintf(checkpoint->tmp_path, "%s%s", path, CHECKPOINT_TMP_SUFFIX);
+    }
+    return ret;
+}
+
+/**
+ * Compares the time since checkpoint was last saved against its interval.
+ * Returns true if a checkpoint should be saved now, false otherwise.
+ */
+bool checkpoint_due(checkpoint_t *checkpoint) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec - checkpoint->last.tv_sec >= checkpoint->interval;
+}
+
+/**
+ * Writes CHECKPOINT_MAGIC, the frontier of walk and the outputs of set to
+ *   checkpoint's temporary file, syncs it and renames it over its path. Only
+ *   then are the runs the last checkpoint kept, and this one doesn't, removed.
+ *   walk_can_save must be true.
+ * Returns 0 on success and -1 on failure, with errno set.
+ */
+int checkpoint_save(checkpoint_t *checkpoint, walk_t *walk, query_set_t *set) {
+    FILE *file = NULL;
+    int ret = 0;
+
+    errno = 0;
+    file = fopen(checkpoint->tmp_path, "w");
+    if (file == NULL) {
+        ret = -1;
+    }
+    else {
+        fputs(CHECKPOINT_MAGIC, file);
+        if (walk_save(walk, file) < 0 || query_set_checkpoint(set, \
+                checkpoint->path, file) != OUTPUT_ERR_NONE || \
+                fflush(file) != 0 || fsync(fileno(file)) < 0) {
+            ret = -1;
+        }
+        if (fclose(file) != 0) {
+            ret = -1;
+        }
+        if (ret == 0 && rename(checkpoint->tmp_path, checkpoint->path) < 0) {
+            ret = -1;
+        }
+        if (ret == 0) {
+            query_set_forget(set);
+        }
+        else {
+            unlink(checkpoint->tmp_path);
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &(checkpoint->last));
+    return ret;
+}
+
+/**
+ * Reads the checkpoint at path into walk and set. A temporary file left next
+ *   to it by a save that was cut short is then discarded.
+ * Returns 0 on success and -1 if it can't be read or doesn't match walk and
+ *   set, with errno set.
+ */
+int checkpoint_load(char *path, walk_t *walk, query_set_t *set) {
+    FILE *file = NULL;
+    char *line = NULL, *tmp_path = NULL;
+    size_t line_max = 0;
+    int ret = 0;
+
+    errno = 0;
+    file = fopen(path, "r");
+    if (file == NULL) {
+        ret = -1;
+    }
+    else {
+        if (getline(&line, &line_max, file) < 0 || \
+                strcmp(line, CHECKPOINT_MAGIC) != 0 || \
+                walk_load(walk, file) < 0 || \
+                query_set_restore(set, file) != OUTPUT_ERR_NONE) {
+            ret = -1;
+        }
+        if (ret < 0 && errno == 0) {
+            errno = EINVAL;
+        }
+        free(line);
+        fclose(file);
+    }
+    if (ret == 0 && (tmp_path = malloc(strlen(path) + \
+            sizeof(CHECKPOINT_TMP_SUFFIX))) != NULL) {
+        sprintf(tmp_path, "%s%s", path, CHECKPOINT_TMP_SUFFIX);
+        checkpoint_discard(tmp_path, set);
+        free(tmp_path);
+    }
+    return ret;
+}
+
+/**
+ * Unlinks checkpoint's file, and its temporary file along with the runs it
+ *   names if a save was cut short, and has set remove the runs merged away
+ *   since. Runs still held by set are already merged by the time the
+ *   traversal is over.
+ */
+void checkpoint_remove(checkpoint_t *checkpoint, query_set_t *set) {
+    unlink(checkpoint->path);
+    checkpoint_discard(checkpoint->tmp_path, set);
+    query_set_forget(set);
+}
+
+/**
+ * Unlinks the temporary file at tmp_path, if a save was cut short and left
+ *   one, and the runs it names that set doesn't hold. It is read as far as it
+ *   was written, as no checkpoint in place names the runs it kept.
+ */
+void checkpoint_discard(char *tmp_path, query_set_t *set) {
+    FILE *file = NULL;
+    char *line = NULL;
+    size_t line_max = 0;
+
+    file = fopen(tmp_path, "r");
+    if (file != NULL) {
+        if (getline(&line, &line_max, file) >= 0 && \
+                strcmp(line, CHECKPOINT_MAGIC) == 0 && \
+                walk_skip_saved(file) == 0) {
+            query_set_discard(set, file);
+        }
+        free(line);
+        fclose(file);
+        unlink(tmp_path);
+    }
+}
+
+/**
+ * Frees checkpoint's temporary path.
+ */
+void checkpoint_delete(checkpoint_t *checkpoint) {
+    free(checkpoint->tmp_path);
+    checkpoint->tmp_path = NULL;
+}
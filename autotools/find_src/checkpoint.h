@@ -0,0 +1,57 @@
+#ifndef __CHECKPOINT_H
+#define __CHECKPOINT_H
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include "query.h"
+#include "walk.h"
+
+// First line of a checkpoint file, naming its format
+#define CHECKPOINT_MAGIC "find checkpoint 2\n"
+// Suffix of the file a checkpoint is written to before it replaces the last
+#define CHECKPOINT_TMP_SUFFIX ".tmp"
+// Seconds between checkpoints unless --checkpoint-interval is given
+#define CHECKPOINT_INTERVAL_DEFAULT 60
+
+typedef struct checkpoint_s checkpoint_t;
+
+// Where and how often the state of a traversal is saved. A checkpoint is
+//   written to tmp_path and renamed over path, so path always holds a whole
+//   checkpoint even if find is killed while writing one.
+struct checkpoint_s {
+    char *path;
+    char *tmp_path;
+    long interval;
+    struct timespec last;
+};
+
+// Initializes checkpoint to save to path at most every interval seconds, or
+//   whenever possible if interval is 0.
+int checkpoint_create(checkpoint_t *checkpoint, char *path, long interval);
+
+// Determines if interval seconds have passed since the last checkpoint.
+bool checkpoint_due(checkpoint_t *checkpoint);
+
+// Saves the frontier of walk and what the outputs of set hold.
+int checkpoint_save(checkpoint_t *checkpoint, walk_t *walk, query_set_t *set);
+
+// Restores walk and the outputs of set from the checkpoint at path. walk must
+//   be a streaming walk just opened on the same root, and set must have the
+//   same queries.
+int checkpoint_load(char *path, walk_t *walk, query_set_t *set);
+
+// Removes the checkpoint and the runs it kept once the traversal is over.
+void checkpoint_remove(checkpoint_t *checkpoint, query_set_t *set);
+
+// Removes the temporary file of a save that was cut short and the runs only
+//   it names.
+void checkpoint_discard(char *tmp_path, query_set_t *set);
+
+// Frees the memory held by checkpoint.
+void checkpoint_delete(checkpoint_t *checkpoint);
+
+#endif /* __CHECKPOINT_H */
@@ -0,0 +1,243 @@
+/**
+ * Coprocesses for the -exec-coproc primary. Rather than starting a program for
+ *   every file like -exec, the program is started once and streamed every path
+ *   over a pipe, answering with a single verdict byte per path over another.
+ *   This makes expensive-to-start helpers cost one process for the whole tree.
+ * To keep the helper busy, paths can be sent ahead of their verdicts when
+ *   nothing later in the expression depends on the result. Up to a window of
+ *   paths are kept in flight and the matches among them are added to the
+ *   query's output as their verdicts arrive.
+ */
+#include "coproc.h"
+
+/**
+ * Initializes coproc to run argv. The coprocess isn't started until the first
+ *   path is sent to it, so what was printed before then can be written out
+ *   ahead of anything it prints.
+ */
+void coproc_create(coproc_t *coproc, char **argv) {
+    coproc->argv = argv;
+    coproc->pid = -1;
+    coproc->to_fd = -1;
+    coproc->from_fd = -1;
+    coproc->window = 1;
+    coproc->emit = NULL;
+    coproc->tag = NULL;
+    coproc->pending = NULL;
+    coproc->pending_start = 0;
+    coproc->pending_c = 0;
+    coproc->err = false;
+}
+
+/**
+ * Creates the pipes to and from the coprocess and starts coproc's argv in it,
+ *   with its stdin and stdout connected to them. The coprocess is started in
+ *   the current working directory, so it is given paths as they appear to the
+ *   caller. SIGPIPE is ignored from here on so a coprocess that exits early
+ *   shows up as a failed write instead of killing the program.
+ * Our ends of the pipes are closed on exec, otherwise any later coprocess
+ *   would hold this one's stdin open and it would never see the end of it.
+ * Returns 0 on success and -1 if the pipes could not be created or the
+ *   process could not be started, which is also recorded in coproc.
+ */
+int coproc_start(coproc_t *coproc) {
+    int to[2], from[2];
+    int ret = 0;
+
+    errno = 0;
+    if (pipe(to) < 0) {
+        ret = -1;
+    }
+    else if (pipe(from) < 0) {
+        close(to[0]);
+        close(to[1]);
+        ret = -1;
+    }
+    else {
+        fcntl(to[1], F_SETFD, FD_CLOEXEC);
+        fcntl(from[0], F_SETFD, FD_CLOEXEC);
+        signal(SIGPIPE, SIG_IGN);
+        coproc->pid = fork();
+        if (coproc->pid == 0) {
+            dup2(to[0], STDIN_FILENO);
+            dup2(from[1], STDOUT_FILENO);
+            close(to[0]);
+            close(to[1]);
+            close(from[0]);
+            close(from[1]);
+            signal(SIGPIPE, SIG_DFL);
+            execvp(coproc->argv[0], coproc->argv);
+            _exit(127);
+        }
+        close(to[0]);
+        close(from[1]);
+        if (coproc->pid < 0) {
+            close(to[1]);
+            close(from[0]);
+            ret = -1;
+        }
+        else {
+            coproc->to_fd = to[1];
+            coproc->from_fd = from[0];
+        }
+    }
+    if (ret < 0) {
+        coproc->err = true;
+    }
+    return ret;
+}
+
+/**
+ * Sets the number of paths that can be in flight, clamped to
+ *   COPROC_WINDOW_MAX. A window of 1 waits on every path.
+ * Returns 0 on success and -1 if memory allocation fails.
+ */
+int coproc_set_window(coproc_t *coproc, int window, output_t *emit, \
+        const char *tag) {
+    int ret = 0;
+
+    if (window > COPROC_WINDOW_MAX) {
+        window = COPROC_WINDOW_MAX;
+    }
+    if (window > 1) {
+        errno = 0;
+        coproc->pending = malloc(sizeof(char*) * window);
+        if (coproc->pending == NULL) {
+            ret = -1;
+        }
+        else {
+            coproc->window = window;
+            coproc->emit = emit;
+            coproc->tag = tag;
+        }
+    }
+    return ret;
+}
+
+/**
+ * Sends path to the coprocess. With a window of 1 this waits on and returns
+ *   its verdict. Otherwise path is queued, and once the window is full the
+ *   oldest verdict is received. Queued paths always evaluate to false here,
+ *   as whether they match is only known later.
+ * Returns the verdict for path if it was waited on, false otherwise.
+ */
+bool coproc_evaluate(coproc_t *coproc, char *path) {
+    char *copy = NULL;
+    bool ret = false;
+
+    if (!coproc->err && coproc_send(coproc, path) == 0) {
+        if (coproc->window == 1) {
+            ret = coproc_receive(coproc);
+        }
+        else {
+            errno = 0;
+            copy = strdup(path);
+            if (copy == NULL) {
+                coproc->err = true;
+            }
+            else {
+                coproc->pending[(coproc->pending_start + coproc->pending_c) % \
+                    coproc->window] = copy;
+                coproc->pending_c++;
+                if (coproc->pending_c == coproc->window) {
+                    coproc_receive_pending(coproc);
+                }
+            }
+        }
+    }
+    return ret;
+}
+
+/**
+ * Writes path and its terminating '\0' to the coprocess.
+ * Returns 0 on success and -1 if the write fails, which is also recorded in
+ *   coproc.
+ */
+int coproc_send(coproc_t *coproc, char *path) {
+    size_t len = strlen(path) + 1, done = 0;
+    ssize_t n = 0;
+    int ret = 0;
+
+    while (done < len && ret == 0) {
+        errno = 0;
+        n = write(coproc->to_fd, path + done, len - done);
+        if (n < 0 && errno != EINTR) {
+            coproc->err = true;
+            ret = -1;
+        }
+        else if (n > 0) {
+            done += n;
+        }
+    }
+    return ret;
+}
+
+/**
+ * Reads the next verdict from the coprocess.
+ * Returns true if the verdict was COPROC_TRUE, false otherwise. If nothing
+ *   could be read the failure is recorded in coproc.
+ */
+bool coproc_receive(coproc_t *coproc) {
+    char verdict = '\0';
+    ssize_t n = 0;
+
+    do {
+        errno = 0;
+        n = read(coproc->from_fd, &verdict, 1);
+    } while (n < 0 && errno == EINTR);
+    if (n != 1) {
+        coproc->err = true;
+    }
+    return n == 1 && verdict == COPROC_TRUE;
+}
+
+/**
+ * Receives the verdict for the oldest queued path, adding the path to emit if
+ *   it is true.
+ */
+void coproc_receive_pending(coproc_t *coproc) {
+    char *path = coproc->pending[coproc->pending_start];
+
+    if (coproc_receive(coproc) && coproc->emit != NULL) {
+        output_add(coproc->emit, path, coproc->tag, OUTPUT_TERM);
+    }
+    free(path);
+    coproc->pending_start = (coproc->pending_start + 1) % coproc->window;
+    coproc->pending_c--;
+}
+
+/**
+ * Closes the coprocess's stdin so it knows no more paths are coming, receives
+ *   the verdicts for every queued path and waits for it to exit.
+ * Returns 0 on success and -1 if communicating with the coprocess failed.
+ */
+int coproc_finish(coproc_t *coproc) {
+    int status;
+
+    if (coproc->to_fd >= 0) {
+        close(coproc->to_fd);
+        coproc->to_fd = -1;
+    }
+    while (coproc->pending_c > 0) {
+        coproc_receive_pending(coproc);
+    }
+    if (coproc->from_fd >= 0) {
+        close(coproc->from_fd);
+        coproc->from_fd = -1;
+    }
+    if (coproc->pid > 0) {
+        waitpid(coproc->pid, &status, 0);
+        coproc->pid = -1;
+    }
+    return coproc->err ? -1 : 0;
+}
+
+/**
+ * Finishes the coprocess if that hasn't been done yet and frees the memory
+ *   held by coproc.
+ */
+void coproc_delete(coproc_t *coproc) {
+    coproc_finish(coproc);
+    free(coproc->pending);
+    coproc->pending = NULL;
+}
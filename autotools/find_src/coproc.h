@@ -0,0 +1,79 @@
+#ifndef __COPROC_H
+#define __COPROC_H
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include "output.h"
+
+// Verdict byte a coprocess writes for a path it evaluates to true. Any other
+//   byte is false.
+#define COPROC_TRUE '1'
+// Default and maximum number of paths that may be waiting on a verdict. The
+//   maximum keeps unread verdicts well within a pipe's capacity, so neither
+//   process can block the other.
+#define COPROC_WINDOW_DEFAULT 64
+#define COPROC_WINDOW_MAX 4096
+
+typedef struct coproc_s coproc_t;
+
+// A helper program started once and sent every path to evaluate.
+//
+// Protocol: each path is written to the helper's stdin followed by a '\0'. For
+//   each path, in order, the helper writes a single verdict byte to its stdout,
+//   COPROC_TRUE if the path matches. The helper must flush each verdict, as
+//   find may wait on it before sending the next path.
+struct coproc_s {
+    char **argv;
+    pid_t pid;
+    int to_fd;
+    int from_fd;
+
+    // If window is greater than 1, paths are not waited on. They are queued
+    //   and their verdicts read once window paths are in flight, and those
+    //   found true are added to emit with tag, if emit is not NULL.
+    int window;
+    output_t *emit;
+    const char *tag;
+    char **pending;
+    int pending_start;
+    int pending_c;
+
+    // Set if the helper could not be started, written to or read from.
+    bool err;
+};
+
+// Initializes coproc to run the program argv in a coprocess once started.
+//   argv must be NULL-terminated and valid for the life of coproc. coproc
+//   must already be allocated.
+void coproc_create(coproc_t *coproc, char **argv);
+
+// Starts the coprocess, before the first path is sent to it.
+int coproc_start(coproc_t *coproc);
+
+// Lets up to window paths be in flight before their verdicts are needed,
+//   adding the true ones to emit with tag.
+int coproc_set_window(coproc_t *coproc, int window, output_t *emit, \
+    const char *tag);
+
+// Sends path to coproc. If paths are not queued, returns the verdict for path,
+//   otherwise returns false.
+bool coproc_evaluate(coproc_t *coproc, char *path);
+
+// Helpers for coproc_evaluate
+int coproc_send(coproc_t *coproc, char *path);
+bool coproc_receive(coproc_t *coproc);
+void coproc_receive_pending(coproc_t *coproc);
+
+// Receives every queued verdict and waits for the coprocess to exit.
+int coproc_finish(coproc_t *coproc);
+
+// Stops the coprocess if it is still running and frees coproc's memory.
+void coproc_delete(coproc_t *coproc);
+
+#endif /* __COPROC_H */
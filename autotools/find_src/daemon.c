@@ -0,0 +1,355 @@
+/**
+ * The protocol between find --daemon and findd. A client connects to the
+ *   daemon's UNIX socket, sends its working directory, the root of the query
+ *   and the expression as '\0' terminated arguments followed by an empty one,
+ *   and shuts down its side. The daemon replies with DAEMON_OK and whatever
+ *   the query prints, or DAEMON_ERR and a message, then closes the
+ *   connection.
+ * The daemon answers from its cache rather than walking the tree: the root
+ *   is looked up in it, and each file below is evaluated in preorder with an
+ *   entry built from its cached stat struct, as a streaming walk builds one.
+ *   Paths start with the root as the client gave it, and are resolved from
+ *   the client's working directory, which the daemon moves to while it
+ *   answers, so actions behave as they would in the client's find. The
+ *   connection is the query's stdout.
+ */
+#include "daemon.h"
+
+/**
+ * Connects to socket_path, writes the request for argv preceded by the
+ *   working directory, and copies the reply to stdout or stderr after its
+ *   first byte tells which.
+ * Returns 0 on success, 1 if the daemon reported an error and -1 if the
+ *   request couldn't be sent or the reply read, with errno set.
+ */
+int daemon_query(char *socket_path, char **argv) {
+    struct sockaddr_un addr;
+    char cwd[PATH_MAX], buf[DAEMON_BUF_SIZE], status = DAEMON_ERR;
+    size_t len = 0;
+    ssize_t n = 0;
+    int fd = -1, ret = 0;
+
+    memset(&addr, 0, sizeof(struct sockaddr_un));
+    addr.sun_family = AF_UNIX;
+    errno = 0;
+    if (strlen(socket_path) >= sizeof(addr.sun_path)) {
+        errno = ENAMETOOLONG;
+        ret = -1;
+    }
+    else if (getcwd(cwd, PATH_MAX) == NULL || \
+            (fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)) < 0) {
+        ret = -1;
+    }
+    else {
+        strcpy(addr.sun_path, socket_path);
+        if (connect(fd, (struct sockaddr*)&addr, \
+                sizeof(struct sockaddr_un)) < 0) {
+            ret = -1;
+        }
+    }
+    len = ret == 0 ? strlen(cwd) + 2 : 0;
+    for (int i = 0; ret == 0 && argv[i] != NULL; i++) {
+        len += strlen(argv[i]) + 1;
+    }
+    if (len > DAEMON_REQUEST_MAX) {
+        errno = E2BIG;
+        ret = -1;
+    }
+    if (ret == 0 && write_all(fd, cwd, strlen(cwd) + 1) < 0) {
+        ret = -1;
+    }
+    for (int i = 0; ret == 0 && argv[i] != NULL; i++) {
+        ret = write_all(fd, argv[i], strlen(argv[i]) + 1);
+    }
+    if (ret == 0 && (write_all(fd, "", 1) < 0 || \
+            shutdown(fd, SHUT_WR) < 0 || read(fd, &status, 1) != 1)) {
+        if (errno == 0) {
+            errno = ECONNRESET;
+        }
+        ret = -1;
+    }
+    n = 1;
+    while (ret == 0 && n > 0) {
+        n = read(fd, buf, DAEMON_BUF_SIZE);
+        if (n < 0 || (n > 0 && write_all(status == DAEMON_OK ? \
+                STDOUT_FILENO : STDERR_FILENO, buf, n) < 0)) {
+            ret = -1;
+        }
+    }
+    if (ret == 0 && status != DAEMON_OK) {
+        ret = 1;
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+    return ret;
+}
+
+/**
+ * Creates a socket at socket_path, replacing a stale one, with a umask
+ *   keeping other users out, and listens on it.
+ * Returns the socket's file descriptor on success and -1 on failure.
+ */
+int daemon_listen(char *socket_path) {
+    struct sockaddr_un addr;
+    mode_t mask = 0;
+    int ret = 0;
+
+    memset(&addr, 0, sizeof(struct sockaddr_un));
+    addr.sun_family = AF_UNIX;
+    errno = 0;
+    if (strlen(socket_path) >= sizeof(addr.sun_path)) {
+        errno = ENAMETOOLONG;
+        ret = -1;
+    }
+    else {
+        strcpy(addr.sun_path, socket_path);
+        ret = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    }
+    if (ret >= 0 && unlink(socket_path) < 0 && errno != ENOENT) {
+        close(ret);
+        ret = -1;
+    }
+    if (ret >= 0) {
+        mask = umask(S_IRWXG | S_IRWXO);
+        if (bind(ret, (struct sockaddr*)&addr, \
+                sizeof(struct sockaddr_un)) < 0 || \
+                listen(ret, DAEMON_BACKLOG) < 0) {
+            close(ret);
+            ret = -1;
+        }
+        umask(mask);
+    }
+    return ret;
+}
+
+/**
+ * Reads the request of client, applies pending changes to cache, and, if
+ *   the root is in it, evaluates the expression against every file below.
+ *   Anything wrong with the request is replied to as an error. The daemon
+ *   returns to "/" afterwards so it keeps no directory busy.
+ * Returns -1 if memory allocation failed, leaving cache unusable, and 0
+ *   otherwise.
+ */
+int daemon_serve(cache_t *cache, int client) {
+    query_set_t set;
+    char *buf = NULL, **args = NULL, *real = NULL, *rel = NULL, *msg = NULL;
+    FTSENT *entry = NULL;
+    cache_node *node = NULL;
+    expr_err e_err = EXPR_ERR_NONE;
+    output_err o_err = OUTPUT_ERR_NONE;
+    size_t len = 0;
+    ssize_t n = 0;
+    int arg_c = 0, out = -1, ret = 0;
+
+    errno = 0;
+    if ((buf = malloc(DAEMON_REQUEST_MAX + 1)) == NULL || \
+            (args = malloc(sizeof(char*) * (DAEMON_REQUEST_MAX / 2 + 1))) \
+            == NULL) {
+        ret = -1;
+    }
+    else if ((n = daemon_read_request(client, buf)) < 0) {
+        msg = "invalid request";
+    }
+    else {
+        for (char *p = buf; p < buf + n && *p != '\0'; p += strlen(p) + 1) {
+            args[arg_c++] = p;
+        }
+        args[arg_c] = NULL;
+    }
+    if (ret == 0 && msg == NULL && arg_c < 2) {
+        msg = "invalid request";
+    }
+    else if (ret == 0 && msg == NULL && chdir(args[0]) < 0) {
+        msg = strerror(errno);
+    }
+    else if (ret == 0 && msg == NULL && \
+            (rel = daemon_relative(cache, args[1], &real)) == NULL) {
+        msg = real == NULL ? strerror(errno) : "not under the daemon's root";
+    }
+    else if (ret == 0 && msg == NULL && cache_update(cache) < 0) {
+        ret = -1;
+    }
+    else if (ret == 0 && msg == NULL && \
+            (node = cache_lookup(cache, rel)) == NULL) {
+        msg = strerror(ENOENT);
+    }
+    else if (ret == 0 && msg == NULL) {
+        e_err = query_set_create(&set, false, 0, false);
+        if (e_err == EXPR_ERR_NONE) {
+            e_err = query_set_add(&set, &(args[2]), NULL);
+        }
+        len = strlen(args[1]) > NAME_MAX ? strlen(args[1]) : NAME_MAX;
+        if (e_err == EXPR_ERR_MALLOC || (e_err == EXPR_ERR_NONE && \
+                ((entry = calloc(1, sizeof(FTSENT) + len + 1)) == NULL || \
+                cache_set_path(cache, 0, args[1], &len) < 0))) {
+            ret = -1;
+        }
+        else if (e_err != EXPR_ERR_NONE) {
+            msg = "invalid expression";
+        }
+        else if (write_all(client, &(char){DAEMON_OK}, 1) == 0 && \
+                (out = dup(STDOUT_FILENO)) >= 0 && \
+                dup2(client, STDOUT_FILENO) >= 0) {
+            o_err = daemon_evaluate(cache, &set, entry, node, args[1], len, \
+                0);
+            if (o_err == OUTPUT_ERR_MALLOC) {
+                ret = -1;
+            }
+            query_set_finish(&set);
+            fflush(stdout);
+            dup2(out, STDOUT_FILENO);
+        }
+        query_set_delete(&set);
+    }
+    if (ret == 0 && msg != NULL) {
+        daemon_reply_error(client, msg);
+    }
+    if (out >= 0) {
+        close(out);
+    }
+    close(client);
+    chdir("/");
+    free(entry);
+    free(real);
+    free(args);
+    free(buf);
+    return ret;
+}
+
+/**
+ * Reads from client until it shuts down its side, giving up after
+ *   DAEMON_TIMEOUT seconds so a stuck client can't hold up the daemon. The
+ *   request is '\0' terminated in buf, which must hold DAEMON_REQUEST_MAX + 1
+ *   bytes.
+ * Returns the length of the request on success, and -1 if it couldn't be
+ *   read or is too long.
+ */
+ssize_t daemon_read_request(int client, char *buf) {
+    struct timeval timeout = {DAEMON_TIMEOUT, 0};
+    ssize_t n = 1, ret = 0;
+
+    errno = 0;
+    if (setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, \
+            sizeof(struct timeval)) < 0) {
+        ret = -1;
+    }
+    while (ret >= 0 && n > 0) {
+        n = read(client, buf + ret, DAEMON_REQUEST_MAX + 1 - ret);
+        if (n < 0 || (n == 0 && ret == 0)) {
+            ret = -1;
+        }
+        else {
+            ret += n;
+            if (ret > DAEMON_REQUEST_MAX) {
+                ret = -1;
+            }
+        }
+    }
+    if (ret >= 0) {
+        buf[ret] = '\0';
+    }
+    return ret;
+}
+
+/**
+ * Replies to client with DAEMON_ERR and msg, followed by a newline.
+ * Returns 0 on success and -1 if writing fails.
+ */
+int daemon_reply_error(int client, char *msg) {
+    int ret = 0;
+
+    if (write_all(client, &(char){DAEMON_ERR}, 1) < 0 || \
+            write_all(client, msg, strlen(msg)) < 0 || \
+            write_all(client, "\n", 1) < 0) {
+        ret = -1;
+    }
+    return ret;
+}
+
+/**
+ * Resolves root into real, which must be freed, and checks it is cache's
+ *   root or below it.
+ * Returns the path of root relative to cache's root, which points into real,
+ *   or NULL if it is outside the cache or can't be resolved, in which case
+ *   real is NULL and errno is set.
+ */
+char* daemon_relative(cache_t *cache, char *root, char **real) {
+    size_t len = strlen(cache->root);
+    char *ret = NULL;
+
+    errno = 0;
+    *real = realpath(root, NULL);
+    if (*real != NULL && strncmp(*real, cache->root, len) == 0) {
+        if (len > 0 && cache->root[len - 1] == '/') {
+            ret = *real + len;
+        }
+        else if ((*real)[len] == '/') {
+            ret = *real + len + 1;
+        }
+        else if ((*real)[len] == '\0') {
+            ret = *real + len;
+        }
+    }
+    return ret;
+}
+
+/**
+ * Evaluates set against node, whose path is the first len bytes of cache's
+ *   path and whose name is name, and then against every file below it in
+ *   preorder, until a query quits. entry is filled in for each, and must
+ *   have room for any name.
+ * Returns OUTPUT_ERR_NONE on success and the error of query_set_evaluate,
+ *   or OUTPUT_ERR_MALLOC if a path can't be built, otherwise.
+ */
+output_err daemon_evaluate(cache_t *cache, query_set_t *set, FTSENT *entry, \
+        cache_node *node, char *name, size_t len, int level) {
+    cache_node *child = NULL;
+    size_t child_len = 0;
+    output_err ret = OUTPUT_ERR_NONE;
+
+    entry->fts_path = cache->path;
+    entry->fts_accpath = cache->path;
+    entry->fts_pathlen = len;
+    entry->fts_namelen = strlen(name);
+    memcpy(entry->fts_name, name, entry->fts_namelen + 1);
+    entry->fts_level = level;
+    entry->fts_info = node->err != 0 ? FTS_NS : walk_info(&(node->st));
+    entry->fts_errno = node->err;
+    entry->fts_statp = &(node->st);
+    ret = query_set_evaluate(set, entry);
+    for (int i = 0; i < node->child_c && ret == OUTPUT_ERR_NONE && \
+            !set->state_args.quit; i++) {
+        child = node->children[i];
+        if (cache_set_path(cache, len, child->name, &child_len) < 0) {
+            ret = OUTPUT_ERR_MALLOC;
+        }
+        else {
+            ret = daemon_evaluate(cache, set, entry, child, child->name, \
+                child_len, level + 1);
+        }
+    }
+    return ret;
+}
+
+/**
+ * Writes all len bytes of buf to fd, retrying short writes.
+ * Returns 0 on success and -1 on failure.
+ */
+int write_all(int fd, char *buf, size_t len) {
+    ssize_t n = 0;
+    int ret = 0;
+
+    while (ret == 0 && len > 0) {
+        errno = 0;
+        n = write(fd, buf, len);
+        if (n < 0 && errno != EINTR) {
+            ret = -1;
+        }
+        else if (n > 0) {
+            buf += n;
+            len -= n;
+        }
+    }
+    return ret;
+}
@@ -0,0 +1,55 @@
+#ifndef __DAEMON_H
+#define __DAEMON_H
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/time.h>
+#include <sys/stat.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+#include <fts.h>
+#include "cache.h"
+#include "query.h"
+#include "walk.h"
+
+// Most bytes a request may take: the client's working directory, the root and
+//   the expression, each argument ended by '\0' and the last by another
+#define DAEMON_REQUEST_MAX (1 << 16)
+// First byte of a reply, followed by the query's output or an error message
+#define DAEMON_OK '0'
+#define DAEMON_ERR '1'
+// Connections waiting to be served
+#define DAEMON_BACKLOG 16
+// Seconds a client has to send its request
+#define DAEMON_TIMEOUT 5
+// Size of the chunks a reply is copied in
+#define DAEMON_BUF_SIZE (1 << 15)
+
+// Sends a query for argv, a NULL-terminated root and expression, to the
+//   daemon listening on socket_path and copies its reply to stdout, or to
+//   stderr if the daemon reports an error. Returns 0 on success, 1 if the
+//   daemon reported an error and -1 if talking to it failed, with errno set.
+int daemon_query(char *socket_path, char **argv);
+
+// Listens for queries on a new UNIX socket at socket_path, only reachable by
+//   the user. Returns its file descriptor, or -1 on failure with errno set.
+int daemon_listen(char *socket_path);
+
+// Answers the query of client, which has just connected, from cache and
+//   closes it. Returns -1 if memory allocation failed and 0 otherwise.
+int daemon_serve(cache_t *cache, int client);
+
+// Helpers for daemon_serve
+ssize_t daemon_read_request(int client, char *buf);
+int daemon_reply_error(int client, char *msg);
+char* daemon_relative(cache_t *cache, char *root, char **real);
+output_err daemon_evaluate(cache_t *cache, query_set_t *set, FTSENT *entry, \
+    cache_node *node, char *name, size_t len, int level);
+int write_all(int fd, char *buf, size_t len);
+
+#endif /* __DAEMON_H */
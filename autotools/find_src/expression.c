@@ -12,86 +12,95 @@
  *   of this, it is sufficient that our expressions be represented as a linked
  *   list of primaries. If all are true, the expression is true, and is false
  *   otherwise.
+ * Some primaries are actions, which do something with the files that reach
+ *   them (like adding them to a -group-by table) and always evaluate to true.
+ *   If an expression has any actions, the caller should not print its matches.
  */
 #include "expression.h"
+#include "../common_src/trace.h"
 
 /**
  * Creates an expression from a list of string arguments. Because each primary
  *   has an unknown number of arguments, expression_create_primary is passed
- *   a pointer to the current position in expr_argv and moves it to the next
- *   unparsed position in expr_argv. This is then the position of the next
- *   primary. expr_argv itself is untouched.
- * If expr_argv contains no arguments, the expression is still valid and will
- *   always return true if evaluated.
+ *   expr_argv_i and moves it to the next unparsed position in the array. This
+ *   is then the position of the next primary. Parsing stops at the end of the
+ *   array or at EXPRESSION_SEP, which is left unconsumed. Since a primary's
+ *   args are consumed with it, an EXPRESSION_SEP given as one of them does not
+ *   end the expression.
+ * If there are no arguments before the end, the expression is still valid and
+ *   will always return true if evaluated.
  * Returns EXPR_ERR_NONE on success, and any other expr_err value if some
  *   part of the parsing fails.
  */
-expr_err expression_create(expression_t *expression, char **expr_argv) {
+expr_err expression_create(expression_t *expression, prog_state *state_args, \
+        arena_t *arena, char ***expr_argv_i) {
     primary_node *node = NULL;
-    char *primary_str = NULL, **primary_arg_i = NULL;
+    char *primary_str = NULL;
     expr_err ret = EXPR_ERR_NONE;
 
     assert(expression != NULL);
-    if (get_prog_state(&(expression->state_args)) < 0) {
-        ret = EXPR_ERR_STATE;
-    }
-    else {
-        expression->head = NULL;
-        primary_str = expr_argv[0];
-        primary_arg_i = &(expr_argv[1]);
-        while (primary_str != NULL && ret == EXPR_ERR_NONE) {
-            ret = expression_create_primary(&node, primary_str, \
-                &primary_arg_i);
-            if (ret != EXPR_ERR_NONE) {
-                expression_delete(expression);
-            }
-            else {
-                expression_add_primary(expression, node);
-
-                primary_str = primary_arg_i[0];
-                if (primary_arg_i[0] != NULL) {
-                    primary_arg_i = &(primary_arg_i[1]);
-                }
+    expression->state_args = state_args;
+    expression->head = NULL;
+    expression->print = true;
+    primary_str = (*expr_argv_i)[0];
+    while (primary_str != NULL && strcmp(primary_str, EXPRESSION_SEP) != 0 && \
+            ret == EXPR_ERR_NONE) {
+        incr_argv_i(expr_argv_i, 1);
+        ret = expression_create_primary(&node, arena, primary_str, \
+            expr_argv_i);
+        if (ret != EXPR_ERR_NONE) {
+            expression_delete(expression);
+        }
+        else {
+            expression_add_primary(expression, node);
+            if (primary_action_map[node->primary]) {
+                expression->print = false;
             }
+            primary_str = (*expr_argv_i)[0];
         }
     }
     return ret;
 }
 
 /**
- * Creates and fills a primary node by consuming arguments of primary_arg_i.
+ * Creates and fills a primary node carved from arena by consuming arguments
+ *   of primary_arg_i. A node that fails to parse is left in arena, to be freed
+ *   with it.
  * On success, primary_arg_i points to the next arg after the last consumed
  *   arg. This is accomplished by the actual parsing function this function
  *   calls.
  * Returns EXPR_ERR_NONE on success and any other expr_err on failure
  *   indicating what part of the parsing/allocating process failed.
  */
-expr_err expression_create_primary(primary_node **node, char *primary_str, \
-        char ***primary_arg_i) {
+expr_err expression_create_primary(primary_node **node, arena_t *arena, \
+        char *primary_str, char ***primary_arg_i) {
     expr_err ret = EXPR_ERR_NONE;
 
-    errno = 0;
-    *node = malloc(sizeof(primary_node));
+    *node = arena_alloc(arena, sizeof(primary_node));
     if (*node == NULL) {
         ret = EXPR_ERR_MALLOC;
     }
     else if (primary_parse(&((*node)->primary), primary_str) < 0) {
         ret = EXPR_ERR_PRIMARY;
-        free(*node);
         *node = NULL;
     }
-    else if ((*primary_arg_i)[0] == NULL) {
+    else if ((*primary_arg_i)[0] == NULL && \
+            primary_arg_type_map[(*node)->primary] != PRINT_ARG && \
+            primary_arg_type_map[(*node)->primary] != LONG_LIST_ARG && \
+            primary_arg_type_map[(*node)->primary] != QUIT_ARG) {
         ret = EXPR_ERR_NO_ARG;
-        free(*node);
         *node = NULL;
     }
     else if (primary_arg_parse((*node)->primary, &((*node)->arg), \
             primary_arg_i) < 0) {
         ret = EXPR_ERR_ARG;
-        free(*node);
         *node = NULL;
     }
     else {
+        (*node)->shared = NULL;
+        (*node)->cache_id = 0;
+        (*node)->eval_c = 0;
+        (*node)->true_c = 0;
         (*node)->next = NULL;
     }
     return ret;
@@ -115,17 +124,30 @@ void expression_add_primary(expression_t *expression, primary_node *node) {
 }
 
 /**
- * Evaluates the expression against entry.
+ * Evaluates the expression against entry. If a primary shares its result with
+ *   an equivalent one, the shared primary is only evaluated if it hasn't
+ *   already been for entry_id, and its cached result is used otherwise. Only
+ *   actual evaluations are counted in the primary's stats.
  * Returns true if all primaries in expression evaluate to true, false
  *   otherwise.
  */
-bool expression_evaluate(expression_t *expression, FTSENT *entry) {
-    primary_node *curr = expression->head;
+bool expression_evaluate(expression_t *expression, FTSENT *entry, \
+        unsigned long entry_id) {
+    primary_node *curr = expression->head, *eval = NULL;
     bool ret = true;
 
     while (ret && curr != NULL) {
-        if (!primary_evaluate(curr->primary, &(curr->arg), \
-                &(expression->state_args), entry)) {
+        eval = curr->shared != NULL ? curr->shared : curr;
+        if (eval->cache_id != entry_id) {
+            eval->cache_val = primary_evaluate(eval->primary, &(eval->arg), \
+                expression->state_args, entry);
+            eval->cache_id = entry_id;
+            eval->eval_c++;
+            eval->true_c += eval->cache_val;
+            TRACE3(find, primary_eval, entry->fts_path, (int)eval->primary, \
+                (int)eval->cache_val);
+        }
+        if (!eval->cache_val) {
             ret = false;
         }
         else {
@@ -135,16 +157,34 @@ bool expression_evaluate(expression_t *expression, FTSENT *entry) {
     return ret;
 }
 
+/**
+ * Calls primary_finish on every primary of expression, in order. All primaries
+ *   are finished even if one fails.
+ * Returns EXPR_ERR_NONE on success and EXPR_ERR_FINISH if any primary failed.
+ */
+expr_err expression_finish(expression_t *expression) {
+    primary_node *curr = expression->head;
+    expr_err ret = EXPR_ERR_NONE;
+
+    while (curr != NULL) {
+        if (primary_finish(curr->primary, &(curr->arg)) < 0) {
+            ret = EXPR_ERR_FINISH;
+        }
+        curr = curr->next;
+    }
+    return ret;
+}
+
 /**
  * Deletes the entire expression. If any memory was allocated for the arg, it
- *   is deleted with primary_delete_arg.
+ *   is deleted with primary_delete_arg. The nodes themselves are left to the
+ *   arena they were carved from.
  */
 void expression_delete(expression_t *expression) {
-    primary_node *next, *curr = expression->head;
+    primary_node *curr = expression->head;
     while (curr != NULL) {
-        next = curr->next;
         primary_delete_arg(curr->primary, &(curr->arg));
-        free(curr);
-        curr = next;
+        curr = curr->next;
     }
+    expression->head = NULL;
 }
\ No newline at end of file
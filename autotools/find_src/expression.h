@@ -7,23 +7,41 @@
 #include <assert.h>
 #include "expression_prim_eval.h"
 #include "expression_prim_parse.h"
+#include "../common_src/arena.h"
 
 typedef struct primary_node primary_node;
 typedef struct expression expression_t;
 typedef enum expr_err expr_err;
 
+// Separates consecutive expressions in an argument array
+#define EXPRESSION_SEP ","
+
 // A node representing one primary.
 struct primary_node {
     primary_t primary;
     primary_arg arg;
 
+    // An equivalent primary whose result is used in place of this one's, or
+    //   NULL. Set when several expressions are evaluated against each file.
+    primary_node *shared;
+    // The id of the file last evaluated by this primary and the result.
+    unsigned long cache_id;
+    bool cache_val;
+    // The number of files the primary was evaluated against, and true for.
+    unsigned long eval_c;
+    unsigned long true_c;
+
     primary_node *next;
 };
 
 // expression struct which includes state information about the program.
 struct expression {
-    prog_state state_args;
+    prog_state *state_args;
     primary_node *head;
+
+    // true if the expression has no actions, meaning every file it evaluates
+    //   to true for should be printed.
+    bool print;
 };
 
 // Error defines
@@ -33,25 +51,38 @@ enum expr_err {
     EXPR_ERR_STATE   = 2,
     EXPR_ERR_PRIMARY = 3,
     EXPR_ERR_ARG     = 4,
-    EXPR_ERR_NO_ARG  = 5
+    EXPR_ERR_NO_ARG  = 5,
+    EXPR_ERR_FINISH  = 6,
+    EXPR_ERR_OUTPUT  = 7,
+    EXPR_ERR_INPUT   = 8
 };
 
-// Creates an expression. expression is expected to be already allocated.
-//   expr_argv must be null-terminated.
-expr_err expression_create(expression_t *expression, char **expr_argv);
+// Creates an expression, consuming args from expr_argv_i until the end of the
+//   array or EXPRESSION_SEP. expression is expected to be already allocated.
+//   The array pointed at by expr_argv_i must be null-terminated, and
+//   state_args and arena must be valid for the life of the expression.
+expr_err expression_create(expression_t *expression, prog_state *state_args, \
+    arena_t *arena, char ***expr_argv_i);
 
-// Creates a primary node. Allocation of primary_node is done here, so node must
-//   point to valid memory. primary_arg_i is moved to the next index after most
-//   recently parsed arg and must be NULL terminated.
-expr_err expression_create_primary(primary_node **node, char *primary_str, \
-    char ***primary_arg_i);
+// Creates a primary node, carved from arena, so node must point to valid
+//   memory. primary_arg_i is moved to the next index after most recently
+//   parsed arg and must be NULL terminated.
+expr_err expression_create_primary(primary_node **node, arena_t *arena, \
+    char *primary_str, char ***primary_arg_i);
 
 // Adds a primary node to the expression.
 void expression_add_primary(expression_t *expression, primary_node *node);
 
-// Evaluates the expression against entry.
-bool expression_evaluate(expression_t *expression, FTSENT *entry);
+// Evaluates the expression against entry. entry_id must be unique to entry
+//   among all entries evaluated by expressions sharing primaries.
+bool expression_evaluate(expression_t *expression, FTSENT *entry, \
+    unsigned long entry_id);
+
+// Completes any work the expression's primaries deferred until after the last
+//   evaluation.
+expr_err expression_finish(expression_t *expression);
 
-// Deletes the expression.
+// Deletes the expression. Its nodes are freed with the arena they were carved
+//   from.
 void expression_delete(expression_t *expression);
 #endif /* __EXPRESSION_H */
\ No newline at end of file
@@ -13,8 +13,12 @@
 
 typedef enum primary primary_t;
 typedef enum arg_type arg_type;
+typedef enum exec_builtin exec_builtin;
 typedef union primary_arg primary_arg;
 typedef struct prog_state prog_state;
+typedef struct num_cmp_s num_cmp_t;
+typedef struct perm_s perm_t;
+typedef struct limit_s limit_t;
 
 // For rounding time to the nearest day/minute
 #define SEC_PER_DAY 86400
@@ -24,6 +28,23 @@ typedef struct prog_state prog_state;
 #define PRIM_EXEC_PATH_EXPAND "{}"
 // Terminating arg in an argument array for the EXEC primary
 #define PRIM_EXEC_ARGV_END ";"
+// Prefixes of a number compared against a file's value: less than, greater
+//   than and, with no prefix, equal to
+#define PRIM_CMP_LESS '-'
+#define PRIM_CMP_MORE '+'
+#define PRIM_CMP_EQUAL '='
+// Size of the units of the SIZE primary with no suffix, in bytes
+#define PRIM_SIZE_BLOCK 512
+// Prefixes of a PERM mode needing all or any of its bits, rather than exactly
+//   its bits
+#define PRIM_PERM_ALL '-'
+#define PRIM_PERM_ANY '/'
+// Bits of a mode compared by the PERM primary
+#define PRIM_PERM_BITS 07777
+// Size of the buffer files are read into by the EXEC_BUILTIN_GREP builtin
+#define PRIM_EXEC_GREP_BUF 65536
+// Size of the buffer a user or group entry is looked up in
+#define PRIM_LOOKUP_BUF 4096
 
 // Primaries
 enum primary {
@@ -34,7 +55,22 @@ enum primary {
     MTIME  = 4,
     TYPE   = 5,
     EXEC   = 6,
-    PRIMARY_NUM = 7
+    GROUP_BY = 7,
+    FPRINT = 8,
+    EXEC_COPROC = 9,
+    PRINT = 10,
+    PRINT0 = 11,
+    PRINTF = 12,
+    LS = 13,
+    USER = 14,
+    GROUP = 15,
+    UID = 16,
+    GID = 17,
+    PERM = 18,
+    SIZE = 19,
+    QUIT = 20,
+    LIMIT = 21,
+    PRIMARY_NUM = 22
 };
 
 // Argument types taken by primaries. 
@@ -42,20 +78,93 @@ enum arg_type {
     LONG_ARG = 0,
     CHAR_ARG = 1,
     CTIM_ARG = 2,
-    ARGV_ARG = 3
+    ARGV_ARG = 3,
+    GRPBY_ARG = 4,
+    FILE_ARG = 5,
+    COPROC_ARG = 6,
+    PRINT_ARG = 7,
+    FORMAT_ARG = 8,
+    LONG_LIST_ARG = 9,
+    USER_ARG = 10,
+    GROUP_ARG = 11,
+    NUM_ARG = 12,
+    SIZE_ARG = 13,
+    PERM_ARG = 14,
+    QUIT_ARG = 15,
+    LIMIT_ARG = 16
+};
+
+// Commands run by the EXEC primary that can be evaluated without starting a
+//   process. Each TEST builtin is a file test of the test utility taking the
+//   path as its only operand, and GREP is grep -qs with a fixed pattern.
+enum exec_builtin {
+    EXEC_BUILTIN_NONE   = 0,
+    EXEC_BUILTIN_TEST_E = 1,
+    EXEC_BUILTIN_TEST_F = 2,
+    EXEC_BUILTIN_TEST_D = 3,
+    EXEC_BUILTIN_TEST_L = 4,
+    EXEC_BUILTIN_TEST_S = 5,
+    EXEC_BUILTIN_TEST_R = 6,
+    EXEC_BUILTIN_TEST_W = 7,
+    EXEC_BUILTIN_TEST_X = 8,
+    EXEC_BUILTIN_GREP   = 9
 };
 
 // Arrays for mapping any primary to its string representation or argument type
 //   respectively.
 extern const char *const primary_str_map[];
 extern const arg_type primary_arg_type_map[];
+// Maps any primary to whether it is an action. Actions do something with the
+//   files that reach them, and an expression containing one no longer prints
+//   its matches.
+extern const bool primary_action_map[];
 
 // A container holding argument array argv, a secondary storage array for argv,
-//   and the number of arguments.
+//   and the number of arguments. If the command can be evaluated without
+//   starting a process, builtin says how, and pattern is the pattern for
+//   EXEC_BUILTIN_GREP, with buf the PRIM_EXEC_GREP_BUF bytes files are read
+//   into.
 struct argv_s {
     char **argv;
     char **argv_dest;
     int argc;
+    exec_builtin builtin;
+    char *pattern;
+    char *buf;
+};
+
+// The file named by the FPRINT primary, and the output writing to it. out is
+//   only set once the expression is part of a query set. PRINT and PRINT0
+//   write to the query's own output, with path NULL, and print its tag.
+struct fprint_s {
+    char *path;
+    struct output_s *out;
+    const char *tag;
+};
+
+// A number a file's value is compared against. The value is first divided by
+//   unit, rounding up, then must be less than, greater than or equal to val
+//   as cmp says.
+struct num_cmp_s {
+    char cmp;
+    unsigned long long val;
+    unsigned long long unit;
+};
+
+// The masks a PERM primary compiles its mode into. A file matches if its mode
+//   ANDed with mask equals want or, if any is true, is not 0. A mask of 0
+//   with any set matches every file.
+struct perm_s {
+    mode_t mask;
+    mode_t want;
+    bool any;
+};
+
+// How many files the LIMIT primary lets through, and how many it has so far.
+//   Once count reaches max the query it is in is no longer evaluated.
+struct limit_s {
+    unsigned long max;
+    unsigned long count;
 };
 
 // Holds the arg for any given primary
@@ -64,6 +173,14 @@ union primary_arg {
     char char_arg;
     struct timespec *ctim_arg;
     struct argv_s *argv_arg;
+    struct group_by_s *group_by_arg;
+    struct fprint_s *fprint_arg;
+    struct coproc_s *coproc_arg;
+    struct format_s *format_arg;
+    struct long_list_s *long_list_arg;
+    struct num_cmp_s *num_cmp_arg;
+    struct perm_s *perm_arg;
+    struct limit_s *limit_arg;
 };
 
 // Holds values representing the program's state that some primaries take as
@@ -71,6 +188,18 @@ union primary_arg {
 struct prog_state {
     time_t start_time_day;
     time_t start_time_min;
+    // Number of paths an EXEC_COPROC primary may have in flight
+    int coproc_window;
+    // Whether EXEC primaries may use their builtin instead of a new process
+    bool exec_builtins;
+    // Set by QUIT to stop the traversal after the current file
+    bool quit;
+    // Outputs of the query set, whose buffers are written out before a
+    //   command or coprocess that may write to the same file is started
+    struct output_s *outputs;
+    // Set by LIMIT to stop evaluating the query being evaluated after the
+    //   current file
+    bool done;
 };
 
 #endif /* __EXPRESSION_PRIM_DEFS_H */
\ No newline at end of file
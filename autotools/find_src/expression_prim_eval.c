@@ -5,6 +5,7 @@
  *   extra assertions to ensure each primaries arg was appropriately parsed.
  */
 #include "expression_prim_eval.h"
+#include "../common_src/trace.h"
 
 /**
  * Takes a primary, its arg value, the programs state and FTSENT struct for a
@@ -14,6 +15,11 @@
  *   function. This also means asserts can be included as one final check that
  *   the mapping used by primary_arg_parse was correct and we can be sure our
  *   dereference of arg is the correct data type.
+ * QUIT stops the traversal and evaluates to false, so nothing after it in
+ *   the expression is done for the file that reached it.
+ * EXEC only uses its builtin for files on disk. Members of a tar archive,
+ *   whose entries have fts_pointer set, run the command, so they get the same
+ *   answer the command would give.
  * In the case that the primary doesn't exist, the program aborts.
  */
 bool primary_evaluate(primary_t primary, primary_arg *arg,\
@@ -50,8 +56,86 @@ bool primary_evaluate(primary_t primary, primary_arg *arg,\
         break;
     case EXEC:
         assert(primary_arg_type_map[primary] == ARGV_ARG);
-        ret = eval_exec(entry->fts_path, arg->argv_arg->argv, \
-            arg->argv_arg->argv_dest, arg->argv_arg->argc);
+        if (arg->argv_arg->builtin != EXEC_BUILTIN_NONE && \
+                state_args->exec_builtins && entry->fts_pointer == NULL) {
+            ret = eval_exec_builtin(entry, arg->argv_arg);
+        }
+        else {
+            ret = eval_exec(entry->fts_path, arg->argv_arg->argv, \
+                arg->argv_arg->argv_dest, arg->argv_arg->argc, \
+                state_args->outputs);
+        }
+        break;
+    case GROUP_BY:
+        assert(primary_arg_type_map[primary] == GRPBY_ARG);
+        ret = eval_group_by(arg->group_by_arg, entry, \
+            state_args->start_time_day);
+        break;
+    case FPRINT:
+        assert(primary_arg_type_map[primary] == FILE_ARG);
+        assert(arg->fprint_arg->out != NULL);
+        ret = eval_fprint(arg->fprint_arg->out, entry->fts_path, NULL, \
+            OUTPUT_TERM);
+        break;
+    case PRINT:
+        assert(primary_arg_type_map[primary] == PRINT_ARG);
+        assert(arg->fprint_arg->out != NULL);
+        ret = eval_fprint(arg->fprint_arg->out, entry->fts_path, \
+            arg->fprint_arg->tag, OUTPUT_TERM);
+        break;
+    case PRINT0:
+        assert(primary_arg_type_map[primary] == PRINT_ARG);
+        assert(arg->fprint_arg->out != NULL);
+        ret = eval_fprint(arg->fprint_arg->out, entry->fts_path, \
+            arg->fprint_arg->tag, OUTPUT_TERM0);
+        break;
+    case PRINTF:
+        assert(primary_arg_type_map[primary] == FORMAT_ARG);
+        assert(arg->format_arg->out != NULL);
+        ret = format_evaluate(arg->format_arg, entry);
+        break;
+    case LS:
+        assert(primary_arg_type_map[primary] == LONG_LIST_ARG);
+        assert(arg->long_list_arg->out != NULL);
+        ret = long_list_evaluate(arg->long_list_arg, entry);
+        break;
+    case USER:
+        assert(primary_arg_type_map[primary] == USER_ARG);
+        ret = entry->fts_statp->st_uid == (uid_t)arg->long_arg;
+        break;
+    case GROUP:
+        assert(primary_arg_type_map[primary] == GROUP_ARG);
+        ret = entry->fts_statp->st_gid == (gid_t)arg->long_arg;
+        break;
+    case UID:
+        assert(primary_arg_type_map[primary] == NUM_ARG);
+        ret = eval_num_cmp(entry->fts_statp->st_uid, arg->num_cmp_arg);
+        break;
+    case GID:
+        assert(primary_arg_type_map[primary] == NUM_ARG);
+        ret = eval_num_cmp(entry->fts_statp->st_gid, arg->num_cmp_arg);
+        break;
+    case PERM:
+        assert(primary_arg_type_map[primary] == PERM_ARG);
+        ret = eval_perm(entry->fts_statp->st_mode, arg->perm_arg);
+        break;
+    case SIZE:
+        assert(primary_arg_type_map[primary] == SIZE_ARG);
+        ret = eval_num_cmp(entry->fts_statp->st_size, arg->num_cmp_arg);
+        break;
+    case EXEC_COPROC:
+        assert(primary_arg_type_map[primary] == COPROC_ARG);
+        ret = eval_exec_coproc(arg->coproc_arg, entry->fts_path, \
+            state_args->outputs);
+        break;
+    case QUIT:
+        assert(primary_arg_type_map[primary] == QUIT_ARG);
+        state_args->quit = true;
+        ret = false;
+        break;
+    case LIMIT:
+        assert(primary_arg_type_map[primary] == LIMIT_ARG);
+        ret = eval_limit(arg->limit_arg, state_args);
         break;
     case PRIMARY_NUM:
         abort();
@@ -61,6 +145,29 @@ bool primary_evaluate(primary_t primary, primary_arg *arg,\
     return ret;
 }
 
+/**
+ * Completes any work primary deferred until the entire file tree was
+ *   evaluated: output of the -group-by table, and collecting the verdicts of
+ *   paths still in flight to an -exec-coproc.
+ * Returns 0 on success, -1 on error.
+ */
+int primary_finish(primary_t primary, primary_arg *arg) {
+    int ret = 0;
+    switch(primary) {
+    case GROUP_BY:
+        assert(primary_arg_type_map[primary] == GRPBY_ARG);
+        ret = group_by_output(arg->group_by_arg, stdout);
+        break;
+    case EXEC_COPROC:
+        assert(primary_arg_type_map[primary] == COPROC_ARG);
+        ret = coproc_finish(arg->coproc_arg);
+        break;
+    default:
+        break;
+    }
+    return ret;
+}
+
 // Primary evaluator functions. The use of primary_evaluate allows for
 //   meaningful and descriptive function signatures for each function.
 
@@ -118,6 +225,40 @@ bool eval_type(mode_t mode, char t) {
     return get_type_char(mode) == t;
 }
 
+/**
+ * Returns true if val, divided by num_cmp's unit and rounded up, is less than,
+ *   greater than or equal to num_cmp's value as its cmp says. Otherwise
+ *   returns false.
+ */
+bool eval_num_cmp(unsigned long long val, num_cmp_t *num_cmp) {
+    bool ret = false;
+
+    if (num_cmp->unit > 1) {
+        val = val / num_cmp->unit + (val % num_cmp->unit > 0);
+    }
+    switch (num_cmp->cmp) {
+    case PRIM_CMP_LESS:
+        ret = val < num_cmp->val;
+        break;
+    case PRIM_CMP_MORE:
+        ret = val > num_cmp->val;
+        break;
+    default:
+        ret = val == num_cmp->val;
+        break;
+    }
+    return ret;
+}
+
+/**
+ * Returns true if the permission bits of mode pass perm's masks. Otherwise
+ *   returns false.
+ */
+bool eval_perm(mode_t mode, perm_t *perm) {
+    return perm->any ? perm->mask == 0 || (mode & perm->mask) != 0 : \
+        (mode & perm->mask) == perm->want;
+}
+
 /**
  * Returns true if the program executed with argv returns 0. Otherwise returns
  *   false. Any element of argv that is equivalent to the string
@@ -125,8 +266,12 @@ bool eval_type(mode_t mode, char t) {
  * argv_dest is included to make the job of string replacement easier as without
  *   it a new array would have to be allocated every call. argv_dest is made
  *   valid by the writting and is only read by the new process.
+ * The streaming outputs in the list starting at outputs are written out
+ *   first, so what the program prints comes after the paths found before it.
  */
-bool eval_exec(char *path, char **argv, char **argv_dest, int argc) {
+bool eval_exec(char *path, char **argv, char **argv_dest, int argc, \
+        output_t *outputs) {
+    struct timespec start;
     pid_t pid;
     int status;
 
@@ -141,17 +286,183 @@ bool eval_exec(char *path, char **argv, char **argv_dest, int argc) {
     }
     argv_dest[argc] = NULL;
 
+    output_drain(outputs);
+    find_stats.exec_c++;
+    stats_begin(&start);
     pid = fork();
     if (pid == 0) {
         execvp(argv_dest[0], argv_dest);
         abort();
     }
-    else if (waitpid(pid, &status, 0) == -1) {
+    TRACE2(find, exec_spawn, (int)pid, path);
+    if (waitpid(pid, &status, 0) == -1) {
         status = -1;
     }
+    TRACE2(find, exec_reap, (int)pid, status);
+    stats_end(STATS_EXEC, &start);
     return status == 0;
 }
 
+/**
+ * Returns what running exec's command, recognized as a builtin, on entry's
+ *   path would, without running it. The file tests use entry's stat struct
+ *   where it holds the same information the test utility would get, and only
+ *   make a system call when entry is a symbolic link that has to be followed,
+ *   when fts could not stat entry, or for permission tests, which test
+ *   answers with access(2) rather than the mode bits.
+ */
+bool eval_exec_builtin(FTSENT *entry, struct argv_s *exec) {
+    exec_builtin builtin = exec->builtin;
+    struct stat f_stat;
+    bool ret = false;
+    bool have_stat = entry->fts_info != FTS_NS && entry->fts_info != FTS_NSOK;
+
+    switch (builtin) {
+    case EXEC_BUILTIN_TEST_E:
+    case EXEC_BUILTIN_TEST_F:
+    case EXEC_BUILTIN_TEST_D:
+    case EXEC_BUILTIN_TEST_S:
+        if (have_stat && !S_ISLNK(entry->fts_statp->st_mode)) {
+            f_stat = *(entry->fts_statp);
+        }
+        else if (stat(entry->fts_path, &f_stat) < 0) {
+            break;
+        }
+        ret = builtin == EXEC_BUILTIN_TEST_E || \
+            (builtin == EXEC_BUILTIN_TEST_F && S_ISREG(f_stat.st_mode)) || \
+            (builtin == EXEC_BUILTIN_TEST_D && S_ISDIR(f_stat.st_mode)) || \
+            (builtin == EXEC_BUILTIN_TEST_S && f_stat.st_size > 0);
+        break;
+    case EXEC_BUILTIN_TEST_L:
+        if (have_stat) {
+            ret = S_ISLNK(entry->fts_statp->st_mode);
+        }
+        else {
+            ret = lstat(entry->fts_path, &f_stat) == 0 && \
+                S_ISLNK(f_stat.st_mode);
+        }
+        break;
+    case EXEC_BUILTIN_TEST_R:
+        ret = faccessat(AT_FDCWD, entry->fts_path, R_OK, AT_EACCESS) == 0;
+        break;
+    case EXEC_BUILTIN_TEST_W:
+        ret = faccessat(AT_FDCWD, entry->fts_path, W_OK, AT_EACCESS) == 0;
+        break;
+    case EXEC_BUILTIN_TEST_X:
+        ret = faccessat(AT_FDCWD, entry->fts_path, X_OK, AT_EACCESS) == 0;
+        break;
+    case EXEC_BUILTIN_GREP:
+        ret = grep_file(entry->fts_path, exec->pattern, exec->buf);
+        break;
+    case EXEC_BUILTIN_NONE:
+        abort();
+    }
+    return ret;
+}
+
+/**
+ * Folds entry into the group_by table. Always returns true, so primaries after
+ *   it see the same files it did.
+ */
+bool eval_group_by(group_by_t *group_by, FTSENT *entry, \
+        time_t start_time_day) {
+    group_by_add(group_by, entry, start_time_day);
+    return true;
+}
+
+/**
+ * Adds path to out after tag if it is not NULL, ending it with term. Always
+ *   returns true.
+ */
+bool eval_fprint(output_t *out, char *path, const char *tag, char term) {
+    output_add(out, path, tag, term);
+    return true;
+}
+
+/**
+ * Returns true if the coprocess's verdict for path is true. If the coprocess
+ *   has paths in flight, the verdict isn't known yet and false is returned.
+ *   The coprocess then adds path to its output itself if it matches.
+ * The coprocess is started by the first path, after the streaming outputs in
+ *   the list starting at outputs are written out, as for eval_exec.
+ */
+bool eval_exec_coproc(coproc_t *coproc, char *path, output_t *outputs) {
+    if (coproc->pid < 0 && !coproc->err) {
+        output_drain(outputs);
+        coproc_start(coproc);
+    }
+    return coproc_evaluate(coproc, path);
+}
+
+/**
+ * Counts a file reaching limit. Returns true for the first limit->max files,
+ *   and once the last of them is counted marks the query being evaluated as
+ *   done, so no later file is evaluated against it.
+ */
+bool eval_limit(limit_t *limit, prog_state *state_args) {
+    bool ret = false;
+
+    if (limit->count < limit->max) {
+        limit->count++;
+        ret = true;
+        if (limit->count == limit->max) {
+            state_args->done = true;
+        }
+    }
+    return ret;
+}
+
+/**
+ * Returns true if the file at path contains pattern, which must be a fixed
+ *   string with no newline, so a match anywhere is a match on some line. The
+ *   file is read into buf in PRIM_EXEC_GREP_BUF sized pieces, keeping the end
+ *   of each piece so matches spanning two of them are found. Any error
+ *   reading the file, including it being a directory, makes the result false,
+ *   as it does for grep -qs.
+ */
+bool grep_file(char *path, char *pattern, char *buf) {
+    size_t pattern_len = strlen(pattern), len = 0;
+    ssize_t n = 0;
+    bool ret = false;
+    int fd;
+
+    assert(pattern_len < PRIM_EXEC_GREP_BUF);
+    fd = open(path, O_RDONLY);
+    if (fd >= 0) {
+        do {
+            n = read(fd, buf + len, PRIM_EXEC_GREP_BUF - len);
+            if (n > 0) {
+                len += n;
+                ret = find_bytes(buf, len, pattern, pattern_len);
+                if (len >= pattern_len) {
+                    memmove(buf, buf + len - (pattern_len - 1), \
+                        pattern_len - 1);
+                    len = pattern_len - 1;
+                }
+            }
+        } while (!ret && (n > 0 || (n < 0 && errno == EINTR)));
+        close(fd);
+    }
+    return ret;
+}
+
+/**
+ * Returns true if the len bytes at buf contain the pattern_len bytes at
+ *   pattern.
+ */
+bool find_bytes(char *buf, size_t len, char *pattern, size_t pattern_len) {
+    char *start = buf, *end = buf + len;
+    bool ret = false;
+
+    while (!ret && (size_t)(end - start) >= pattern_len && \
+            (start = memchr(start, pattern[0], end - start)) != NULL && \
+            (size_t)(end - start) >= pattern_len) {
+        ret = memcmp(start, pattern, pattern_len) == 0;
+        start++;
+    }
+    return ret;
+}
+
 /**
  * Returns the character representation of the filetype of mode, and a '?'
  *   if the filetype is invalid.
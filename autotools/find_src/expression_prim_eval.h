@@ -4,11 +4,19 @@
 #include <sys/wait.h>
 #include <fcntl.h>
 #include "expression_prim_defs.h"
+#include "group_by.h"
+#include "output.h"
+#include "coproc.h"
+#include "format.h"
+#include "long_list.h"
 
 // Evaluates a primary against entry.
 bool primary_evaluate(primary_t primary, primary_arg *arg,\
     prog_state *state_args, FTSENT *entry);
 
+// Completes any work a primary deferred until every file was evaluated.
+int primary_finish(primary_t primary, primary_arg *arg);
+
 // Primary evaluator functions
 bool eval_cnewer(struct timespec *ctim, struct timespec *o_ctim);
 bool eval_cmin(struct timespec *ctim, long n, time_t start_time_min);
@@ -16,9 +24,20 @@ bool eval_ctime(struct timespec *ctim, long n, time_t start_time_day);
 bool eval_mmin(struct timespec *mtim, long n, time_t start_time_min);
 bool eval_mtime(struct timespec *mtim, long n, time_t start_time_day);
 bool eval_type(mode_t mode, char t);
-bool eval_exec(char *path, char **argv, char **argv_dest, int argc);
+bool eval_exec(char *path, char **argv, char **argv_dest, int argc, \
+    output_t *outputs);
+bool eval_exec_builtin(FTSENT *entry, struct argv_s *exec);
+bool eval_num_cmp(unsigned long long val, num_cmp_t *num_cmp);
+bool eval_perm(mode_t mode, perm_t *perm);
+bool eval_group_by(group_by_t *group_by, FTSENT *entry, \
+    time_t start_time_day);
+bool eval_fprint(output_t *out, char *path, const char *tag, char term);
+bool eval_exec_coproc(coproc_t *coproc, char *path, output_t *outputs);
+bool eval_limit(limit_t *limit, prog_state *state_args);
 
-// Helper for primary evaluator functions
+// Helpers for primary evaluator functions
 char get_type_char(mode_t mode);
+bool grep_file(char *path, char *pattern, char *buf);
+bool find_bytes(char *buf, size_t len, char *pattern, size_t pattern_len);
 
 #endif /* __EXPRESSION_PRIM_EVAL_H */
\ No newline at end of file
@@ -9,15 +9,23 @@
 
 // Arrays representing mappings from primary_t enums to their string
 //   representations and arg types respectively.
-const char *const primary_str_map[] = {"-cnewer", "-cmin", "-ctime", "-mmin", \
-    "-mtime", "-type", "-exec"};
-const arg_type primary_arg_type_map[] = {CTIM_ARG, LONG_ARG, LONG_ARG, LONG_ARG, \
-    LONG_ARG, CHAR_ARG, ARGV_ARG};
+const char *const primary_str_map[] = {"-cnewer", "-cmin", "-ctime", \
+    "-mmin", "-mtime", "-type", "-exec", "-group-by", "-fprint", \
+    "-exec-coproc", "-print", "-print0", "-printf", "-ls", "-user", "-group", \
+    "-uid", "-gid", "-perm", "-size", "-quit", "-limit"};
+const arg_type primary_arg_type_map[] = {CTIM_ARG, LONG_ARG, LONG_ARG, \
+    LONG_ARG, LONG_ARG, CHAR_ARG, ARGV_ARG, GRPBY_ARG, FILE_ARG, COPROC_ARG, \
+    PRINT_ARG, PRINT_ARG, FORMAT_ARG, LONG_LIST_ARG, USER_ARG, GROUP_ARG, \
+    NUM_ARG, NUM_ARG, PERM_ARG, SIZE_ARG, QUIT_ARG, LIMIT_ARG};
+const bool primary_action_map[] = {false, false, false, false, false, false, \
+    false, true, true, false, true, true, true, true, false, false, false, \
+    false, false, false, true, false};
 
 /**
  * Parses primary_str_map and puts the corresponding primary_t into primary.
  *   Since primary_t is an enum, the primary we are looking for is the index
- *   where primary_str_map matches primary_str.
+ *   where primary_str_map matches primary_str. The match must be exact, as
+ *   some primaries are prefixes of others.
  * Returns 0 on success, and -1 if primary_str does not correspond to a
  *   primary.
  */
@@ -25,7 +33,7 @@ int primary_parse(primary_t *primary, char *primary_str) {
     unsigned int prim = 0;
     int ret = 0;
     while (prim < PRIMARY_NUM && strncmp(primary_str, primary_str_map[prim], \
-            strlen(primary_str_map[prim])) != 0) {
+            strlen(primary_str_map[prim]) + 1) != 0) {
         prim++;
     }
     if (prim == PRIMARY_NUM) {
@@ -60,6 +68,44 @@ int primary_arg_parse(primary_t primary, primary_arg *arg, char ***argv_i) {
     case ARGV_ARG:
         ret = get_arg_argv(arg, argv_i);
         break;
+    case GRPBY_ARG:
+        ret = get_arg_group_by(arg, argv_i);
+        break;
+    case FILE_ARG:
+        ret = get_arg_file(arg, argv_i);
+        break;
+    case COPROC_ARG:
+        ret = get_arg_coproc(arg, argv_i);
+        break;
+    case PRINT_ARG:
+        ret = get_arg_print(arg, argv_i);
+        break;
+    case FORMAT_ARG:
+        ret = get_arg_format(arg, argv_i);
+        break;
+    case LONG_LIST_ARG:
+        ret = get_arg_long_list(arg, argv_i);
+        break;
+    case USER_ARG:
+        ret = get_arg_user(arg, argv_i);
+        break;
+    case GROUP_ARG:
+        ret = get_arg_group(arg, argv_i);
+        break;
+    case NUM_ARG:
+        ret = get_arg_num_cmp(arg, argv_i, false);
+        break;
+    case SIZE_ARG:
+        ret = get_arg_num_cmp(arg, argv_i, true);
+        break;
+    case PERM_ARG:
+        ret = get_arg_perm(arg, argv_i);
+        break;
+    case QUIT_ARG:
+        break;
+    case LIMIT_ARG:
+        ret = get_arg_limit(arg, argv_i);
+        break;
     default:
         ret = -1;
     }
@@ -177,9 +223,24 @@ int get_arg_argv(primary_arg *arg, char ***argv_i) {
                     memset(argv_s->argv_dest, '\0', argc * sizeof(void*));
                     argv_s->argv[argc] = NULL;
                     argv_s->argc = argc;
+                    argv_s->builtin = get_exec_builtin(argv_s->argv, argc);
+                    argv_s->pattern = argv_s->builtin == EXEC_BUILTIN_GREP ? \
+                        argv_s->argv[2] : NULL;
+                    argv_s->buf = NULL;
 
-                    arg->argv_arg = argv_s;
-                    incr_argv_i(argv_i, argc + 1);
+                    errno = 0;
+                    if (argv_s->builtin == EXEC_BUILTIN_GREP && \
+                            (argv_s->buf = malloc(PRIM_EXEC_GREP_BUF)) == \
+                            NULL) {
+                        free(argv_s->argv_dest);
+                        free(argv_s->argv);
+                        free(argv_s);
+                        ret = -1;
+                    }
+                    else {
+                        arg->argv_arg = argv_s;
+                        incr_argv_i(argv_i, argc + 1);
+                    }
                 }
             }
         }
@@ -187,6 +248,440 @@ int get_arg_argv(primary_arg *arg, char ***argv_i) {
     return ret;
 }
 
+/**
+ * Recognizes commands given to the EXEC primary whose result can be worked
+ *   out without running them. Only exact argument shapes are recognized, each
+ *   with the path as the file operand:
+ *     test -e|-f|-d|-L|-h|-s|-r|-w|-x {}
+ *     [ -e|-f|-d|-L|-h|-s|-r|-w|-x {} ]
+ *     grep -qs|-sq pattern {}
+ *   grep is only recognized if pattern is printable ASCII with no characters
+ *   special to a basic regular expression, so it matches as a fixed string,
+ *   and doesn't start with '-', so grep wouldn't take it as an option.
+ * Returns the builtin for argv, or EXEC_BUILTIN_NONE if there isn't one.
+ */
+exec_builtin get_exec_builtin(char **argv, int argc) {
+    static const char test_ops[] = "efdLhsrwx";
+    static const exec_builtin test_builtins[] = {EXEC_BUILTIN_TEST_E, \
+        EXEC_BUILTIN_TEST_F, EXEC_BUILTIN_TEST_D, EXEC_BUILTIN_TEST_L, \
+        EXEC_BUILTIN_TEST_L, EXEC_BUILTIN_TEST_S, EXEC_BUILTIN_TEST_R, \
+        EXEC_BUILTIN_TEST_W, EXEC_BUILTIN_TEST_X};
+    exec_builtin ret = EXEC_BUILTIN_NONE;
+    char *op = NULL;
+
+    if ((argc == 3 && strcmp(argv[0], "test") == 0) || \
+            (argc == 4 && strcmp(argv[0], "[") == 0 && \
+            strcmp(argv[3], "]") == 0)) {
+        if (strcmp(argv[2], PRIM_EXEC_PATH_EXPAND) == 0 && \
+                argv[1][0] == '-' && argv[1][1] != '\0' && \
+                argv[1][2] == '\0' && \
+                (op = strchr(test_ops, argv[1][1])) != NULL) {
+            ret = test_builtins[op - test_ops];
+        }
+    }
+    else if (argc == 4 && strcmp(argv[0], "grep") == 0 && \
+            (strcmp(argv[1], "-qs") == 0 || strcmp(argv[1], "-sq") == 0) && \
+            strcmp(argv[3], PRIM_EXEC_PATH_EXPAND) == 0 && \
+            argv[2][0] != '\0' && argv[2][0] != '-') {
+        ret = EXEC_BUILTIN_GREP;
+        for (int i = 0; argv[2][i] != '\0'; i++) {
+            if (!isprint((unsigned char)argv[2][i]) || \
+                    strchr(".[]*^$\\", argv[2][i]) != NULL) {
+                ret = EXEC_BUILTIN_NONE;
+            }
+        }
+    }
+    return ret;
+}
+
+/**
+ * Expected argv value: A GROUP_BY_KEY_SEP separated list of group_key names
+ * Consumes: 1 arg
+ * Returns 0 on success or -1 if a key is invalid or an error occured.
+ */
+int get_arg_group_by(primary_arg *arg, char ***argv_i) {
+    group_by_t *group_by;
+    int ret = 0;
+
+    errno = 0;
+    group_by = malloc(sizeof(group_by_t));
+    if (group_by == NULL) {
+        ret = -1;
+    }
+    else if (group_by_create(group_by, (*argv_i)[0]) < 0) {
+        group_by_delete(group_by);
+        free(group_by);
+        ret = -1;
+    }
+    else {
+        arg->group_by_arg = group_by;
+        incr_argv_i(argv_i, 1);
+    }
+    return ret;
+}
+
+/**
+ * Expected argv value: A path to a file to write to
+ * Consumes: 1 arg
+ * The file isn't opened here, since every primary writing to the same file
+ *   must share one output. That is left to the query set the expression
+ *   becomes part of.
+ * Returns 0 on success or -1 on error.
+ */
+int get_arg_file(primary_arg *arg, char ***argv_i) {
+    struct fprint_s *fprint;
+    int ret = 0;
+
+    errno = 0;
+    fprint = malloc(sizeof(struct fprint_s));
+    if (fprint == NULL) {
+        ret = -1;
+    }
+    else {
+        fprint->path = (*argv_i)[0];
+        fprint->out = NULL;
+        fprint->tag = NULL;
+        arg->fprint_arg = fprint;
+        incr_argv_i(argv_i, 1);
+    }
+    return ret;
+}
+
+/**
+ * Expected argv value: None, the primary prints to the query's own output
+ * Consumes: 0 args
+ * Returns 0 on success or -1 on error
+ */
+int get_arg_print(primary_arg *arg, char ***argv_i) {
+    struct fprint_s *print;
+    int ret = 0;
+
+    (void)argv_i;
+    errno = 0;
+    print = malloc(sizeof(struct fprint_s));
+    if (print == NULL) {
+        ret = -1;
+    }
+    else {
+        print->path = NULL;
+        print->out = NULL;
+        print->tag = NULL;
+        arg->fprint_arg = print;
+    }
+    return ret;
+}
+
+/**
+ * Expected argv values: An array of args to execute a program terminated by
+ *   PRIM_EXEC_ARGV_END. Unlike ARGV_ARG, no arg is replaced by the path, as
+ *   paths are sent to the program's stdin.
+ * Consumes: >=2 args, minimum number being the program followed by
+ *   PRIM_EXEC_ARGV_END.
+ * The program is started once the first path reaches it. Walks never change
+ *   directory, so it runs in the directory find started in.
+ * Returns 0 on success, -1 if an error occured or if the args are not
+ *   terminated with PRIM_EXEC_ARGV_END.
+ */
+int get_arg_coproc(primary_arg *arg, char ***argv_i) {
+    coproc_t *coproc = NULL;
+    char **argv = NULL;
+    int ret = 0;
+
+    int argc = 0;
+    while ((*argv_i)[argc] != NULL && strncmp(PRIM_EXEC_ARGV_END, \
+            (*argv_i)[argc], strlen(PRIM_EXEC_ARGV_END) + 1)) {
+        argc++;
+    }
+    if (argc == 0 || (*argv_i)[argc] == NULL) {
+        ret = -1;
+    }
+    else {
+        errno = 0;
+        coproc = malloc(sizeof(coproc_t));
+        argv = malloc(sizeof(char*) * (argc + 1));
+        if (coproc == NULL || argv == NULL) {
+            free(coproc);
+            free(argv);
+            ret = -1;
+        }
+        else {
+            memcpy(argv, *argv_i, argc * sizeof(char*));
+            argv[argc] = NULL;
+            coproc_create(coproc, argv);
+            arg->coproc_arg = coproc;
+            incr_argv_i(argv_i, argc + 1);
+        }
+    }
+    return ret;
+}
+
+/**
+ * Expected argv value: A format string, see format.c for what it may contain
+ * Consumes: 1 arg
+ * Returns 0 on success or -1 if the format is invalid or on error
+ */
+int get_arg_format(primary_arg *arg, char ***argv_i) {
+    format_t *format;
+    int ret = 0;
+
+    errno = 0;
+    format = malloc(sizeof(format_t));
+    if (format == NULL) {
+        ret = -1;
+    }
+    else if (format_create(format, (*argv_i)[0]) < 0) {
+        free(format);
+        ret = -1;
+    }
+    else {
+        arg->format_arg = format;
+        incr_argv_i(argv_i, 1);
+    }
+    return ret;
+}
+
+/**
+ * Expected argv value: None, the primary prints to the query's own output
+ * Consumes: 0 args
+ * Returns 0 on success or -1 on error
+ */
+int get_arg_long_list(primary_arg *arg, char ***argv_i) {
+    long_list_t *long_list;
+    int ret = 0;
+
+    (void)argv_i;
+    errno = 0;
+    long_list = malloc(sizeof(long_list_t));
+    if (long_list == NULL) {
+        ret = -1;
+    }
+    else {
+        long_list_create(long_list);
+        arg->long_list_arg = long_list;
+    }
+    return ret;
+}
+
+/**
+ * Expected argv value: A user name, or a uid if no user has that name
+ * Consumes: 1 arg
+ * The name is looked up here, once, so evaluating compares integers.
+ * Returns 0 on success or -1 if there is no such user.
+ */
+int get_arg_user(primary_arg *arg, char ***argv_i) {
+    struct passwd passwd, *passwd_ent = NULL;
+    char buf[PRIM_LOOKUP_BUF], *end_ptr;
+    int ret = 0;
+
+    getpwnam_r((*argv_i)[0], &passwd, buf, PRIM_LOOKUP_BUF, &passwd_ent);
+    if (passwd_ent != NULL) {
+        arg->long_arg = passwd_ent->pw_uid;
+    }
+    else {
+        arg->long_arg = strtol((*argv_i)[0], &end_ptr, 10);
+        if (*end_ptr != '\0' || end_ptr == (*argv_i)[0] || \
+                arg->long_arg < 0) {
+            ret = -1;
+        }
+    }
+    if (ret == 0) {
+        incr_argv_i(argv_i, 1);
+    }
+    return ret;
+}
+
+/**
+ * Expected argv value: A group name, or a gid if no group has that name
+ * Consumes: 1 arg
+ * The name is looked up here, once, so evaluating compares integers.
+ * Returns 0 on success or -1 if there is no such group.
+ */
+int get_arg_group(primary_arg *arg, char ***argv_i) {
+    struct group group, *group_ent = NULL;
+    char buf[PRIM_LOOKUP_BUF], *end_ptr;
+    int ret = 0;
+
+    getgrnam_r((*argv_i)[0], &group, buf, PRIM_LOOKUP_BUF, &group_ent);
+    if (group_ent != NULL) {
+        arg->long_arg = group_ent->gr_gid;
+    }
+    else {
+        arg->long_arg = strtol((*argv_i)[0], &end_ptr, 10);
+        if (*end_ptr != '\0' || end_ptr == (*argv_i)[0] || \
+                arg->long_arg < 0) {
+            ret = -1;
+        }
+    }
+    if (ret == 0) {
+        incr_argv_i(argv_i, 1);
+    }
+    return ret;
+}
+
+/**
+ * Expected argv value: A non-negative integer, optionally preceded by
+ *   PRIM_CMP_LESS or PRIM_CMP_MORE. If size is true it may be followed by a
+ *   unit: c for bytes, w for 2 bytes, b for PRIM_SIZE_BLOCK bytes (the
+ *   default), or k, M or G for kibibytes, mebibytes and gibibytes.
+ * Consumes: 1 arg
+ * Returns 0 on success or -1 if the arg is not such a number or on error.
+ */
+int get_arg_num_cmp(primary_arg *arg, char ***argv_i, bool size) {
+    static const char units[] = "cwbkMG";
+    static const unsigned long long unit_bytes[] = {1, 2, PRIM_SIZE_BLOCK, \
+        1ULL << 10, 1ULL << 20, 1ULL << 30};
+    num_cmp_t *num_cmp;
+    char *read = (*argv_i)[0], *end_ptr = NULL, *unit = NULL;
+    int ret = 0;
+
+    errno = 0;
+    num_cmp = malloc(sizeof(num_cmp_t));
+    if (num_cmp == NULL) {
+        ret = -1;
+    }
+    else {
+        num_cmp->cmp = PRIM_CMP_EQUAL;
+        num_cmp->unit = size ? PRIM_SIZE_BLOCK : 1;
+        if (*read == PRIM_CMP_LESS || *read == PRIM_CMP_MORE) {
+            num_cmp->cmp = *(read++);
+        }
+        if (!isdigit((unsigned char)*read)) {
+            ret = -1;
+        }
+        else {
+            errno = 0;
+            num_cmp->val = strtoull(read, &end_ptr, 10);
+            if (errno) {
+                ret = -1;
+            }
+            else if (size && *end_ptr != '\0' && end_ptr[1] == '\0' && \
+                    (unit = strchr(units, *end_ptr)) != NULL) {
+                num_cmp->unit = unit_bytes[unit - units];
+            }
+            else if (*end_ptr != '\0') {
+                ret = -1;
+            }
+        }
+        if (ret < 0) {
+            free(num_cmp);
+        }
+        else {
+            arg->num_cmp_arg = num_cmp;
+            incr_argv_i(argv_i, 1);
+        }
+    }
+    return ret;
+}
+
+/**
+ * Expected argv value: A mode, optionally preceded by PRIM_PERM_ALL or
+ *   PRIM_PERM_ANY. The mode is either octal or symbolic, see parse_perm_mode.
+ *   Without a prefix a file's permissions must be exactly the mode, with
+ *   PRIM_PERM_ALL they must include all of its bits and with PRIM_PERM_ANY
+ *   any of them.
+ * Consumes: 1 arg
+ * The mode is compiled here into the masks evaluation applies.
+ * Returns 0 on success or -1 if the mode is invalid or on error.
+ */
+int get_arg_perm(primary_arg *arg, char ***argv_i) {
+    perm_t *perm;
+    char *read = (*argv_i)[0];
+    char kind = '\0';
+    mode_t mode = 0;
+    int ret = 0;
+
+    if (*read == PRIM_PERM_ALL || *read == PRIM_PERM_ANY) {
+        kind = *(read++);
+    }
+    if (parse_perm_mode(&mode, read) < 0) {
+        ret = -1;
+    }
+    else {
+        errno = 0;
+        perm = malloc(sizeof(perm_t));
+        if (perm == NULL) {
+            ret = -1;
+        }
+        else {
+            perm->mask = kind == '\0' ? PRIM_PERM_BITS : mode;
+            perm->want = kind == PRIM_PERM_ANY ? 0 : mode;
+            perm->any = kind == PRIM_PERM_ANY;
+            arg->perm_arg = perm;
+            incr_argv_i(argv_i, 1);
+        }
+    }
+    return ret;
+}
+
+/**
+ * Parses mode_str into mode. mode_str is either up to four octal digits, or a
+ *   comma separated list of symbolic clauses applied in order to an empty
+ *   mode. Each clause is any of u, g, o and a naming whose bits it changes,
+ *   all of them if none are given, then one of =, + and - to set, add or
+ *   remove the bits, then any of r, w, x, s and t.
+ * Returns 0 on success or -1 if mode_str is not a valid mode.
+ */
+int parse_perm_mode(mode_t *mode, char *mode_str) {
+    static const char whos[] = "ugoa";
+    static const mode_t who_bits[] = {S_ISUID | S_IRWXU, S_ISGID | S_IRWXG, \
+        S_IRWXO, PRIM_PERM_BITS};
+    static const char perms[] = "rwxst";
+    static const mode_t perm_bits[] = {S_IRUSR | S_IRGRP | S_IROTH, \
+        S_IWUSR | S_IWGRP | S_IWOTH, S_IXUSR | S_IXGRP | S_IXOTH, \
+        S_ISUID | S_ISGID, S_ISVTX};
+    char *read = mode_str, *end_ptr = NULL, *found = NULL;
+    mode_t who = 0, bits = 0;
+    char op = '\0';
+    int ret = 0;
+
+    *mode = 0;
+    if (isdigit((unsigned char)*read)) {
+        *mode = strtoul(read, &end_ptr, 8);
+        if (*end_ptr != '\0' || end_ptr - read > 4) {
+            ret = -1;
+        }
+    }
+    else {
+        do {
+            who = 0;
+            bits = 0;
+            while (*read != '\0' && (found = strchr(whos, *read)) != NULL) {
+                who |= who_bits[found - whos];
+                read++;
+            }
+            if (who == 0) {
+                who = PRIM_PERM_BITS;
+            }
+            op = *(read++);
+            if (op != '=' && op != '+' && op != '-') {
+                ret = -1;
+            }
+            while (ret == 0 && *read != '\0' && *read != ',') {
+                found = strchr(perms, *(read++));
+                if (found == NULL) {
+                    ret = -1;
+                }
+                else {
+                    bits |= perm_bits[found - perms];
+                }
+            }
+            if (ret == 0) {
+                bits &= who;
+                if (op == '=') {
+                    *mode = (*mode & ~who) | bits;
+                }
+                else if (op == '+') {
+                    *mode |= bits;
+                }
+                else {
+                    *mode &= ~bits;
+                }
+            }
+        } while (ret == 0 && *(read++) == ',');
+    }
+    return ret;
+}
+
 /**
  * Increments the value pointed at by argv_i by i
  */
@@ -208,16 +703,139 @@ void primary_delete_arg(primary_t primary, primary_arg *arg) {
         free(arg->ctim_arg);
         break;
     case ARGV_ARG:
+        free(arg->argv_arg->buf);
         free(arg->argv_arg->argv);
         free(arg->argv_arg);
         break;
+    case GRPBY_ARG:
+        group_by_delete(arg->group_by_arg);
+        free(arg->group_by_arg);
+        break;
+    case FILE_ARG:
+    case PRINT_ARG:
+        free(arg->fprint_arg);
+        break;
+    case COPROC_ARG:
+        coproc_delete(arg->coproc_arg);
+        free(arg->coproc_arg->argv);
+        free(arg->coproc_arg);
+        break;
+    case FORMAT_ARG:
+        format_delete(arg->format_arg);
+        free(arg->format_arg);
+        break;
+    case LONG_LIST_ARG:
+        free(arg->long_list_arg);
+        break;
+    case USER_ARG:
+    case GROUP_ARG:
+        break;
+    case NUM_ARG:
+    case SIZE_ARG:
+        free(arg->num_cmp_arg);
+        break;
+    case PERM_ARG:
+        free(arg->perm_arg);
+        break;
+    case QUIT_ARG:
+        break;
+    case LIMIT_ARG:
+        free(arg->limit_arg);
+        break;
+    }
+}
+
+/**
+ * Determines if two primaries given the same args would always evaluate the
+ *   same, so only one of them needs to be evaluated. Actions are never equal,
+ *   since each has its own effect. Nor are commands run by EXEC, which may
+ *   have effects of their own, except the test and [ commands recognized as
+ *   builtins, which only look at the file.
+ * Returns true if primary is not an action and arg1 is equivalent to arg2,
+ *   false otherwise.
+ */
+bool primary_arg_equal(primary_t primary, primary_arg *arg1, \
+        primary_arg *arg2) {
+    bool ret = false;
+    if (!primary_action_map[primary]) {
+        switch(primary_arg_type_map[primary]) {
+        case LONG_ARG:
+        case USER_ARG:
+        case GROUP_ARG:
+            ret = arg1->long_arg == arg2->long_arg;
+            break;
+        case NUM_ARG:
+        case SIZE_ARG:
+            ret = arg1->num_cmp_arg->cmp == arg2->num_cmp_arg->cmp && \
+                arg1->num_cmp_arg->val == arg2->num_cmp_arg->val && \
+                arg1->num_cmp_arg->unit == arg2->num_cmp_arg->unit;
+            break;
+        case PERM_ARG:
+            ret = arg1->perm_arg->mask == arg2->perm_arg->mask && \
+                arg1->perm_arg->want == arg2->perm_arg->want && \
+                arg1->perm_arg->any == arg2->perm_arg->any;
+            break;
+        case CHAR_ARG:
+            ret = arg1->char_arg == arg2->char_arg;
+            break;
+        case CTIM_ARG:
+            ret = arg1->ctim_arg->tv_sec == arg2->ctim_arg->tv_sec && \
+                arg1->ctim_arg->tv_nsec == arg2->ctim_arg->tv_nsec;
+            break;
+        case ARGV_ARG:
+            ret = arg1->argv_arg->builtin != EXEC_BUILTIN_NONE && \
+                arg1->argv_arg->builtin != EXEC_BUILTIN_GREP && \
+                arg1->argv_arg->argc == arg2->argv_arg->argc;
+            for (int i = 0; ret && i < arg1->argv_arg->argc; i++) {
+                ret = strcmp(arg1->argv_arg->argv[i], \
+                    arg2->argv_arg->argv[i]) == 0;
+            }
+            break;
+        default:
+            break;
+        }
+    }
+    return ret;
+}
+
+/**
+ * Expected argv value: A positive integer, the number of files to let through
+ * Consumes: 1 arg
+ * Returns 0 on success or -1 if the number is invalid or on error.
+ */
+int get_arg_limit(primary_arg *arg, char ***argv_i) {
+    limit_t *limit;
+    char *end_ptr;
+    unsigned long max;
+    int ret = 0;
+
+    errno = 0;
+    max = strtoul((*argv_i)[0], &end_ptr, 10);
+    if (errno || *end_ptr != '\0' || max == 0 || \
+            !isdigit((unsigned char)(*argv_i)[0][0])) {
+        ret = -1;
+    }
+    else {
+        errno = 0;
+        limit = malloc(sizeof(limit_t));
+        if (limit == NULL) {
+            ret = -1;
+        }
+        else {
+            limit->max = max;
+            limit->count = 0;
+            arg->limit_arg = limit;
+            incr_argv_i(argv_i, 1);
+        }
     }
+    return ret;
 }
 
 /**
  * Fills out state_args with information from the program's state.
- * Currently the only values in use are the number of minutes since the epoch
- *   and the number of days since the epoch, rounded up. The resolution of this
+ * The values taken from the program's state are the number of minutes since
+ *   the epoch and the number of days since the epoch, rounded up. Values that
+ *   are set by options are given their defaults. The resolution of this
  *   calculation is only in seconds, nanosecond resolution would be very
  *   overkill given the specific use of these values.
  * Returns 0 on success, and -1 on error.
@@ -238,6 +856,12 @@ int get_prog_state(prog_state *state_args) {
         if (tm.tv_sec % SEC_PER_MIN > 0) {
             state_args->start_time_min++;
         }
+
+        state_args->coproc_window = COPROC_WINDOW_DEFAULT;
+        state_args->exec_builtins = true;
+        state_args->quit = false;
+        state_args->outputs = NULL;
+        state_args->done = false;
     }
     return ret;
 }
@@ -1,6 +1,13 @@
 #ifndef __EXPRESSION_PRIM_PARSE_H
 #define __EXPRESSION_PRIM_PARSE_H
+#include <ctype.h>
+#include <pwd.h>
+#include <grp.h>
 #include "expression_prim_defs.h"
+#include "group_by.h"
+#include "coproc.h"
+#include "format.h"
+#include "long_list.h"
 
 // Parses arg_s and stores its equivalent primary_t in primary.
 int primary_parse(primary_t *primary, char *primary_str);
@@ -17,6 +24,19 @@ int get_arg_long(primary_arg *arg, char ***argv_i);
 int get_arg_char(primary_arg *arg, char ***argv_i);
 int get_arg_ctim(primary_arg *arg, char ***argv_i);
 int get_arg_argv(primary_arg *arg, char ***arg_i);
+exec_builtin get_exec_builtin(char **argv, int argc);
+int get_arg_group_by(primary_arg *arg, char ***argv_i);
+int get_arg_file(primary_arg *arg, char ***argv_i);
+int get_arg_coproc(primary_arg *arg, char ***argv_i);
+int get_arg_print(primary_arg *arg, char ***argv_i);
+int get_arg_format(primary_arg *arg, char ***argv_i);
+int get_arg_long_list(primary_arg *arg, char ***argv_i);
+int get_arg_user(primary_arg *arg, char ***argv_i);
+int get_arg_group(primary_arg *arg, char ***argv_i);
+int get_arg_num_cmp(primary_arg *arg, char ***argv_i, bool size);
+int get_arg_perm(primary_arg *arg, char ***argv_i);
+int parse_perm_mode(mode_t *mode, char *mode_str);
+int get_arg_limit(primary_arg *arg, char ***argv_i);
 
 // Increments the value pointed at by argv_i by i
 void incr_argv_i(char ***argv_i, int i);
@@ -24,6 +44,11 @@ void incr_argv_i(char ***argv_i, int i);
 // Deletes arg given the primary it corresponds to.
 void primary_delete_arg(primary_t primary, primary_arg *arg);
 
+// Determines if two primaries of the same type with args arg1 and arg2 will
+//   always evaluate the same.
+bool primary_arg_equal(primary_t primary, primary_arg *arg1, \
+    primary_arg *arg2);
+
 // Gets arguments usable by all primaries from the program's state and stores
 //   them in state_args.
 int get_prog_state(prog_state *state_args);
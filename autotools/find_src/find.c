@@ -1,126 +1,437 @@
 /**
  * find program. Recursively searches a given file tree, and given an expression
- *   prints all files for which the expression evaluates to true.
+ *   prints all files for which the expression evaluates to true. If the
+ *   expression contains an action, the action decides the output instead.
  */
 #include <stdio.h>
-#include "list.h"
-#include "expression.h"
+#include <getopt.h>
+#include "query.h"
+#include "ignore.h"
+#include "walk.h"
+#include "checkpoint.h"
+#include "throttle.h"
+#include "stats.h"
+#include "progress.h"
+#include "daemon.h"
+#include "tar.h"
+#include "../common_src/trace.h"
+
+// All valid short options for find. The leading '+' stops option parsing at
+//   the first non-option, which is the file, so the expression is left alone.
+#define OPTION_STRING "+"
+// Suffixes of --sort-memory for KiB, MiB and GiB
+#define SIZE_UNITS "KMG"
+// Argument of --stats printing them as JSON
+#define STATS_JSON "json"
+
+// Option flags. These are ONLY set by the get_options function.
+
+// File of queries, one per line, evaluated along with any on the command line
+char *option_query_file = NULL;
+// Paths an -exec-coproc may have in flight, 0 for the default
+int option_coproc_window = 0;
+// Always start a process for -exec, even for commands find can evaluate itself
+bool option_no_exec_builtins = false;
+// Write matches as they are found instead of in sorted order
+bool option_unsorted = false;
+// Bytes of paths each sorted output may hold in memory, 0 for no limit
+size_t option_sort_memory = 0;
+// Read directories in chunks instead of whole, keeping memory bounded
+bool option_stream_dirs = false;
+// Stat the files of each chunk read in the order of their inode numbers
+bool option_inode_order = false;
+// Read the directories the walk descends into next on a helper thread
+bool option_prefetch = false;
+// File of patterns, as in a .gitignore, for files to skip in the whole tree
+char *option_ignore_file = NULL;
+// Skip files matched by the .gitignore of the directory they are in or above
+bool option_gitignore = false;
+// File the traversal's progress is saved to, and file it resumes from
+char *option_checkpoint = NULL;
+char *option_resume = NULL;
+// Seconds between checkpoints, 0 to save one whenever possible
+long option_checkpoint_interval = CHECKPOINT_INTERVAL_DEFAULT;
+// Directory reads and stat calls per second, 0 for no limit
+double option_io_rate = 0;
+// Milliseconds the THROTTLE_PERCENTILE of their latency is kept to, 0 for a
+//   fixed rate
+double option_io_latency = 0;
+// Print counters and timings of the run to stderr on exit, as JSON if
+//   option_stats_json is set
+bool option_stats = false;
+bool option_stats_json = false;
+// Seconds between progress reports, 0 to only report on PROGRESS_SIGNAL
+double option_progress = 0;
+// Socket of a findd to send the query to instead of walking the tree
+char *option_daemon = NULL;
+// List the members of uncompressed tar archives as files below them
+bool option_tar = false;
+
+// Long options for find, each of which may also be given with a single '-'
+static const struct option long_options[] = {
+    {"query-file",    required_argument, NULL, 'q'},
+    {"coproc-window", required_argument, NULL, 'w'},
+    {"no-exec-builtins", no_argument,    NULL, 'b'},
+    {"unsorted",      no_argument,       NULL, 'u'},
+    {"sort-memory",   required_argument, NULL, 'm'},
+    {"stream-dirs",   no_argument,       NULL, 's'},
+    {"inode-order",   no_argument,       NULL, 'n'},
+    {"prefetch",      no_argument,       NULL, 'f'},
+    {"ignore-file",   required_argument, NULL, 'i'},
+    {"gitignore",     no_argument,       NULL, 'g'},
+    {"checkpoint",    required_argument, NULL, 'c'},
+    {"resume",        required_argument, NULL, 'r'},
+    {"checkpoint-interval", required_argument, NULL, 'k'},
+    {"io-rate",       required_argument, NULL, 'o'},
+    {"io-latency",    required_argument, NULL, 'l'},
+    {"stats",         optional_argument, NULL, 'S'},
+    {"progress",      required_argument, NULL, 'p'},
+    {"daemon",        required_argument, NULL, 'D'},
+    {"tar",           no_argument,       NULL, 't'},
+    {NULL,         0,                 NULL, 0}
+};
 
 typedef enum find_err find_err;
 enum find_err {
     FIND_ERR_NONE     = 0,
     FIND_ERR_MALLOC   = 1,
     FIND_ERR_FTREE    = 2,
-    FIND_ERR_FTS_READ = 3
+    FIND_ERR_FTS_READ = 3,
+    FIND_ERR_FINISH   = 4,
+    FIND_ERR_OUTPUT   = 5,
+    FIND_ERR_IGNORE   = 6,
+    FIND_ERR_CHECKPOINT = 7,
+    FIND_ERR_PROGRESS = 8,
+    FIND_ERR_TAR      = 9
 };
 
-find_err find(char *file, expression_t *expression);
+find_err find(char *file, query_set_t *query_set, ignore_t *ignore, \
+    bool stream_dirs, bool inode_order, bool prefetch, \
+    checkpoint_t *checkpoint, char *resume, throttle_t *throttle, \
+    bool archives);
 
 // Helpers for find
-find_err descend_tree(FTS *file_tree, expression_t *expression, list *path_list);
-void output_path_list(list *path_list);
+find_err resume_tree(walk_t *walk, query_set_t *query_set, ignore_t *ignore, \
+    char *resume);
+find_err descend_tree(walk_t *walk, query_set_t *query_set, ignore_t *ignore, \
+    checkpoint_t *checkpoint, bool archives);
+find_err descend_archive(FTSENT *entry, query_set_t *query_set);
+
+// Sets the option flags given an array of arguments and their size.
+int get_options(const int argc, char **argv);
+
+// Helper for get_options
+int get_size(char *arg, size_t *size);
+int get_positive(char *arg, double *value);
+
+// Prints the counters of find_stats and the primaries of query_set to stderr.
+void print_stats(query_set_t *query_set, bool json);
 
 // Error printing
 void expression_perror(expr_err err, char *pname);
 void find_perror(find_err err, char *pname);
 
 /**
- * Creates an expression given input from argv, and then calls find to iterrate
- *   through the file tree and evaluate each file. The file is assumed to be at
- *   argv[1] and the expression starts at argv[2]
+ * Sets option flags, creates a query set given input from argv, and then calls
+ *   find to iterrate through the file tree and evaluate each file. The file is
+ *   the first argument after the options and the expressions follow it,
+ *   separated by EXPRESSION_SEP. If a query file was given, its queries are
+ *   added first and the expressions may be left out. Patterns of an ignore
+ *   file apply to the whole tree, so they are relative to the file.
+ * Resuming keeps checkpointing to the same file unless another is given, and
+ *   either needs directories to be streamed, as do stating in inode order and
+ *   prefetching.
+ *   A rate or latency target for file system operations throttles the walk.
+ *   Stats are printed whether or not the traversal succeeded. Progress is
+ *   always reported on PROGRESS_SIGNAL. With a daemon's socket, the file and
+ *   expressions are sent to it instead and every other option is ignored.
  * Returns 0 on success, 1 on error.
  */
 int main(int argc, char **argv) {
     char **expr_argv = NULL;
-    expression_t expression;
+    query_set_t query_set;
+    ignore_t ignore;
+    checkpoint_t checkpoint, *checkpoint_p = NULL;
+    throttle_t throttle, *throttle_p = NULL;
     expr_err e_err = EXPR_ERR_NONE;
     find_err f_err = FIND_ERR_NONE;
-    int ret = 0;
+    size_t base_len = 0;
+    int file_i = 0, ret = 0;
 
-    if (argc == 1) {
+    file_i = get_options(argc, argv);
+    if (file_i < 0 || file_i >= argc) {
         printf("%s: invalid arguments\n", argv[0]);
-        printf("Usage: %s file [expression]\n", argv[0]);
+        printf("Usage: %s [--query-file file] [--coproc-window n] " \
+            "[--no-exec-builtins] [--unsorted] [--sort-memory limit] " \
+            "[--stream-dirs] [--inode-order] [--prefetch] " \
+            "[--ignore-file file] [--gitignore] " \
+            "[--checkpoint file] [--resume file] " \
+            "[--checkpoint-interval seconds] [--io-rate ops] " \
+            "[--io-latency ms] [--stats[=json]] [--progress seconds] " \
+            "[--daemon socket] [--tar] file " \
+            "[expression] [, expression]...\n", argv[0]);
         ret = 1;
     }
+    else if (option_daemon != NULL) {
+        ret = daemon_query(option_daemon, &(argv[file_i]));
+        if (ret < 0) {
+            fprintf(stderr, "%s: %s: %s\n", argv[0], option_daemon, \
+                strerror(errno));
+            ret = 1;
+        }
+    }
     else {
-        expr_argv = &(argv[2]);
+        expr_argv = &(argv[file_i + 1]);
+
+        if (option_checkpoint == NULL) {
+            option_checkpoint = option_resume;
+        }
+        e_err = query_set_create(&query_set, option_unsorted, \
+            option_sort_memory, option_resume != NULL);
+        if (option_coproc_window > 0) {
+            query_set.state_args.coproc_window = option_coproc_window;
+        }
+        query_set.state_args.exec_builtins = !option_no_exec_builtins;
+        if (e_err == EXPR_ERR_NONE && option_query_file != NULL) {
+            e_err = query_set_add_file(&query_set, option_query_file);
+        }
+        if (e_err == EXPR_ERR_NONE && \
+                (option_query_file == NULL || expr_argv[0] != NULL)) {
+            e_err = query_set_add(&query_set, expr_argv, NULL);
+        }
+
+        ignore_create(&ignore, option_gitignore);
+        if (e_err == EXPR_ERR_NONE && option_ignore_file != NULL) {
+            base_len = strlen(argv[file_i]);
+            if (base_len > 0 && argv[file_i][base_len - 1] == '/') {
+                base_len--;
+            }
+            if (ignore_add_file(&ignore, option_ignore_file, base_len, \
+                    IGNORE_LEVEL_ALL) < 0) {
+                f_err = FIND_ERR_IGNORE;
+            }
+        }
+        if (e_err == EXPR_ERR_NONE && f_err == FIND_ERR_NONE && \
+                option_checkpoint != NULL) {
+            if (checkpoint_create(&checkpoint, option_checkpoint, \
+                    option_checkpoint_interval) < 0) {
+                f_err = FIND_ERR_MALLOC;
+            }
+            else {
+                checkpoint_p = &checkpoint;
+            }
+        }
+        if (option_stats) {
+            stats_enable();
+        }
+        if (f_err == FIND_ERR_NONE && progress_start(option_progress) < 0) {
+            f_err = FIND_ERR_PROGRESS;
+        }
+        if (option_io_rate > 0 || option_io_latency > 0) {
+            throttle_create(&throttle, option_io_rate, \
+                (long)(option_io_latency * NSEC_PER_MSEC));
+            throttle_p = &throttle;
+        }
 
-        e_err = expression_create(&expression, expr_argv);
         if (e_err != EXPR_ERR_NONE) {
             expression_perror(e_err, argv[0]);
             ret = 1;
         }
+        else if (f_err != FIND_ERR_NONE) {
+            find_perror(f_err, argv[0]);
+            ret = 1;
+        }
         else {
-            f_err = find(argv[1], &expression);
+            f_err = find(argv[file_i], &query_set, &ignore, \
+                option_stream_dirs || option_inode_order || \
+                option_prefetch || checkpoint_p != NULL, option_inode_order, \
+                option_prefetch, checkpoint_p, option_resume, throttle_p, \
+                option_tar);
             if (f_err != FIND_ERR_NONE) {
                 find_perror(f_err, argv[0]);
                 ret = 1;
             }
-            expression_delete(&expression);
+            if (option_stats) {
+                print_stats(&query_set, option_stats_json);
+            }
+        }
+        query_set_delete(&query_set);
+        ignore_delete(&ignore);
+        if (checkpoint_p != NULL) {
+            checkpoint_delete(checkpoint_p);
         }
     }
     return ret;
 }
 
 /**
- * Implementation of find. Descends the file tree with its root at file and
- *   prints out all files in the tree for which expression evaluates to true.
- *   fts_open takes a NULL-terminated array so the NULL-terminated array
- *   consisting of file and NULL is necessary.
+ * Implementation of find. Descends the file tree with its root at file,
+ *   evaluating every query of query_set against each file in a single
+ *   traversal, and then writes out each query's results. The walk never
+ *   changes the working directory, so each file's path is valid for the
+ *   programs -exec runs and the system calls primaries make. If stream_dirs
+ *   is true directories are streamed rather than read whole by fts, and if
+ *   inode_order is also true the files of each chunk are stat'd in the order
+ *   of their inode numbers. If prefetch is also true, a helper thread reads
+ *   the directories the walk is about to descend into, unless the walk is
+ *   throttled, as its reads would not be. Files matched by ignore are
+ *   skipped.
+ * If checkpoint is not NULL the traversal is checkpointed as it goes, and the
+ *   checkpoint removed once it completes. If resume is not NULL the traversal
+ *   continues from the checkpoint at that path. Both need stream_dirs. If
+ *   throttle is not NULL it paces the walk. If archives is true the members
+ *   of tar archives are evaluated as files below them.
  * Returns FIND_ERR_NONE on success and any other find_err on failure.
  */
-find_err find(char *file, expression_t *expression) {
-    FTS *file_tree = NULL;
-    list path_list = NULL;
+find_err find(char *file, query_set_t *query_set, ignore_t *ignore, \
+        bool stream_dirs, bool inode_order, bool prefetch, \
+        checkpoint_t *checkpoint, char *resume, throttle_t *throttle, \
+        bool archives) {
+    walk_t walk;
+    prefetch_t prefetcher;
     find_err ret = FIND_ERR_NONE;
-    char *files[] = {file, NULL};
+    expr_err e_err = EXPR_ERR_NONE;
 
-    errno = 0;
-    file_tree = fts_open(files, FTS_PHYSICAL, NULL);
-    if (file_tree == NULL) {
+    if (walk_open(&walk, file, stream_dirs, throttle) < 0) {
         ret = FIND_ERR_FTREE;
     }
     else {
-        ret = descend_tree(file_tree, expression, &path_list);
+        walk.inode_order = inode_order;
+        if (stream_dirs && prefetch && throttle == NULL && \
+                prefetch_start(&prefetcher) == 0) {
+            walk.prefetch = &prefetcher;
+        }
+        if (resume != NULL) {
+            ret = resume_tree(&walk, query_set, ignore, resume);
+        }
+        if (ret == FIND_ERR_NONE) {
+            ret = descend_tree(&walk, query_set, ignore, checkpoint, \
+                archives);
+        }
         if (ret == FIND_ERR_NONE) {
-            output_path_list(&path_list);
+            e_err = query_set_finish(query_set);
+            if (e_err == EXPR_ERR_OUTPUT) {
+                ret = FIND_ERR_OUTPUT;
+            }
+            else if (e_err != EXPR_ERR_NONE) {
+                ret = FIND_ERR_FINISH;
+            }
+        }
+        if (ret == FIND_ERR_NONE && checkpoint != NULL) {
+            checkpoint_remove(checkpoint, query_set);
         }
-        fts_close(file_tree);
-        list_delete(&path_list);
+        if (walk.prefetch != NULL) {
+            prefetch_stop(walk.prefetch);
+        }
+        walk_close(&walk);
     }
     return ret;
 }
 
 /**
- * Descends the file tree, evaluating each file with expression and adding
- *   every file that evaluates to true to path_list.
- * Returns FIND_ERR_NONE on success and FIND_ERR_MALLOC or FIND_ERR_FTS_READ if
- *   malloc or fts_read failed respectively.
+ * Loads the checkpoint at resume into walk and query_set, then enters each
+ *   directory on walk's stack in ignore, from the root down, as the walk that
+ *   saved it had.
+ * Returns FIND_ERR_NONE on success, FIND_ERR_CHECKPOINT if the checkpoint
+ *   can't be loaded and FIND_ERR_IGNORE if reading an ignore file fails.
  */
-find_err descend_tree(FTS *file_tree, expression_t *expression, list *path_list) {
+find_err resume_tree(walk_t *walk, query_set_t *query_set, ignore_t *ignore, \
+        char *resume) {
+    find_err ret = FIND_ERR_NONE;
+
+    if (checkpoint_load(resume, walk, query_set) < 0) {
+        ret = FIND_ERR_CHECKPOINT;
+    }
+    for (int i = 0; i < walk->frame_c && ret == FIND_ERR_NONE; i++) {
+        if (ignore_enter(ignore, walk_frame_entry(walk, i)) < 0) {
+            ret = FIND_ERR_IGNORE;
+        }
+    }
+    return ret;
+}
+
+/**
+ * Descends the file tree, evaluating each file with every query in query_set.
+ *   Each query adds the files it matches to its own output. Ignored files are
+ *   not evaluated, and ignored directories are skipped before they are read.
+ *   ignore's stack of layers follows the traversal, so the patterns of each
+ *   directory entered apply until it is left again. The traversal ends early
+ *   once a query asks to stop, leaving any directories not yet read unread.
+ *   A progress report that has come due is made before each entry is
+ *   handled.
+ *   If checkpoint is not NULL, one is saved before reading on whenever it is
+ *   due and the walk is between directory listings.
+ *   If archives is true, the members of each tar archive evaluated are
+ *   evaluated right after it.
+ * Returns FIND_ERR_NONE on success and FIND_ERR_MALLOC, FIND_ERR_OUTPUT,
+ *   FIND_ERR_IGNORE, FIND_ERR_CHECKPOINT, FIND_ERR_TAR or FIND_ERR_FTS_READ
+ *   if malloc, writing an output, reading an ignore file, saving a
+ *   checkpoint, reading an archive or reading the tree failed respectively.
+ */
+find_err descend_tree(walk_t *walk, query_set_t *query_set, ignore_t *ignore, \
+        checkpoint_t *checkpoint, bool archives) {
+    struct timespec start;
     FTSENT *entry = NULL;
-    node *n = NULL;
+    output_err o_err = OUTPUT_ERR_NONE;
     find_err ret = FIND_ERR_NONE;
 
     errno = 0;
-    entry = fts_read(file_tree);
-    while (entry != NULL && ret == FIND_ERR_NONE) {
-        if (entry->fts_info != FTS_DP && 
-                expression_evaluate(expression, entry)) {
-            n = list_create_node(entry->fts_path);
-            if (n == NULL) {
-                ret = FIND_ERR_MALLOC;
+    stats_begin(&start);
+    entry = walk_read(walk);
+    stats_end(STATS_WALK, &start);
+    while (entry != NULL && ret == FIND_ERR_NONE && \
+            !query_set->state_args.quit) {
+        if (entry->fts_info != FTS_DP) {
+            find_stats.entries++;
+        }
+        if (find_progress.due) {
+            progress_report(walk, entry);
+        }
+        if (entry->fts_info == FTS_DP) {
+            TRACE2(find, dir_leave, entry->fts_path, entry->fts_level);
+            ignore_leave(ignore, entry);
+        }
+        else if (ignore_match(ignore, entry)) {
+            if (entry->fts_info == FTS_D) {
+                walk_skip(walk, entry);
+            }
+        }
+        else {
+            stats_begin(&start);
+            o_err = query_set_evaluate(query_set, entry);
+            stats_end(STATS_EVAL, &start);
+            if (entry->fts_info == FTS_D) {
+                TRACE2(find, dir_enter, entry->fts_path, entry->fts_level);
+                find_stats.dirs++;
+            }
+            if (o_err == OUTPUT_ERR_NONE && entry->fts_info == FTS_D && \
+                    ignore_enter(ignore, entry) < 0) {
+                ret = FIND_ERR_IGNORE;
+            }
+            else if (o_err == OUTPUT_ERR_NONE && archives && \
+                    !query_set->state_args.quit && tar_is_archive(entry)) {
+                ret = descend_archive(entry, query_set);
+            }
+        }
+        if (o_err == OUTPUT_ERR_WRITE) {
+            ret = FIND_ERR_OUTPUT;
+        }
+        else if (o_err != OUTPUT_ERR_NONE) {
+            ret = FIND_ERR_MALLOC;
+        }
+        else if (ret == FIND_ERR_NONE && !query_set->state_args.quit) {
+            if (checkpoint != NULL && walk_can_save(walk) && \
+                    checkpoint_due(checkpoint) && \
+                    checkpoint_save(checkpoint, walk, query_set) < 0) {
+                ret = FIND_ERR_CHECKPOINT;
             }
             else {
-                list_insert_ordered(path_list, n);
                 errno = 0;
-                entry = fts_read(file_tree);
+                stats_begin(&start);
+                entry = walk_read(walk);
+                stats_end(STATS_WALK, &start);
             }
         }
-        else {
-            errno = 0;
-            entry = fts_read(file_tree);
-        }
     }
     if (entry == NULL && errno) {
         ret = FIND_ERR_FTS_READ;
@@ -129,13 +440,271 @@ find_err descend_tree(FTS *file_tree, expression_t *expression, list *path_list)
 }
 
 /**
- * Simple output of path_list to stdout.
+ * Evaluates every query of query_set against each member of the archive
+ *   entry, in archive order, until a query asks to stop. Members are not
+ *   subject to ignore patterns. An archive that can't be opened is left as
+ *   just a file, as an unreadable directory is.
+ * Returns FIND_ERR_NONE on success, FIND_ERR_TAR if reading the archive
+ *   fails, and FIND_ERR_MALLOC or FIND_ERR_OUTPUT if evaluating fails.
+ */
+find_err descend_archive(FTSENT *entry, query_set_t *query_set) {
+    struct timespec start;
+    tar_t tar;
+    FTSENT *member = NULL;
+    output_err o_err = OUTPUT_ERR_NONE;
+    find_err ret = FIND_ERR_NONE;
+
+    if (tar_open(&tar, entry) < 0) {
+        if (errno == ENOMEM) {
+            ret = FIND_ERR_MALLOC;
+        }
+    }
+    else {
+        member = tar_read(&tar);
+        while (member != NULL && o_err == OUTPUT_ERR_NONE && \
+                !query_set->state_args.quit) {
+            find_stats.entries++;
+            stats_begin(&start);
+            o_err = query_set_evaluate(query_set, member);
+            stats_end(STATS_EVAL, &start);
+            if (o_err == OUTPUT_ERR_NONE && !query_set->state_args.quit) {
+                member = tar_read(&tar);
+            }
+        }
+        if (o_err == OUTPUT_ERR_WRITE) {
+            ret = FIND_ERR_OUTPUT;
+        }
+        else if (o_err != OUTPUT_ERR_NONE || (member == NULL && \
+                errno == ENOMEM)) {
+            ret = FIND_ERR_MALLOC;
+        }
+        else if (member == NULL && errno) {
+            ret = FIND_ERR_TAR;
+        }
+        tar_close(&tar);
+    }
+    return ret;
+}
+
+/**
+ * Checks argv for options and sets option flags. Parsing stops at the first
+ *   argument that isn't an option.
+ * Returns the index of the first argument after the options on success, and
+ *   -1 if an invalid option was found.
+ */
+int get_options(const int argc, char **argv) {
+    char *end = NULL;
+    long window = 0;
+    int opt = 0, ret = 0;
+
+    while (opt != -1 && ret != -1) {
+        opt = getopt_long_only(argc, argv, OPTION_STRING, long_options, NULL);
+        switch (opt) {
+        case 'q':
+            option_query_file = optarg;
+            break;
+        case 'b':
+            option_no_exec_builtins = true;
+            break;
+        case 'u':
+            option_unsorted = true;
+            break;
+        case 's':
+            option_stream_dirs = true;
+            break;
+        case 'n':
+            option_inode_order = true;
+            break;
+        case 'f':
+            option_prefetch = true;
+            break;
+        case 'm':
+            if (get_size(optarg, &option_sort_memory) < 0) {
+                ret = -1;
+            }
+            break;
+        case 'i':
+            option_ignore_file = optarg;
+            break;
+        case 'g':
+            option_gitignore = true;
+            break;
+        case 'c':
+            option_checkpoint = optarg;
+            break;
+        case 'r':
+            option_resume = optarg;
+            break;
+        case 'k':
+            option_checkpoint_interval = strtol(optarg, &end, 10);
+            if (end == optarg || *end != '\0' || \
+                    option_checkpoint_interval < 0) {
+                ret = -1;
+            }
+            break;
+        case 'S':
+            option_stats = true;
+            if (optarg != NULL && strcmp(optarg, STATS_JSON) == 0) {
+                option_stats_json = true;
+            }
+            else if (optarg != NULL) {
+                ret = -1;
+            }
+            break;
+        case 'D':
+            option_daemon = optarg;
+            break;
+        case 't':
+            option_tar = true;
+            break;
+        case 'p':
+            if (get_positive(optarg, &option_progress) < 0) {
+                ret = -1;
+            }
+            break;
+        case 'o':
+            if (get_positive(optarg, &option_io_rate) < 0) {
+                ret = -1;
+            }
+            break;
+        case 'l':
+            if (get_positive(optarg, &option_io_latency) < 0) {
+                ret = -1;
+            }
+            break;
+        case 'w':
+            errno = 0;
+            window = strtol(optarg, &end, 10);
+            if (errno || end == optarg || *end != '\0' || window <= 0 || \
+                    window > INT_MAX) {
+                ret = -1;
+            }
+            else {
+                option_coproc_window = window;
+            }
+            break;
+        case '?':
+            ret = -1;
+        }
+    }
+    if (ret == 0) {
+        ret = optind;
+    }
+    return ret;
+}
+
+/**
+ * Parses arg as a number of bytes into size. The number may be followed by
+ *   one of SIZE_UNITS, each multiplying it by another 1024.
+ * Returns 0 on success and -1 if arg is not a valid size.
+ */
+int get_size(char *arg, size_t *size) {
+    char *end = NULL, *unit = NULL;
+    int ret = 0;
+
+    errno = 0;
+    *size = strtoull(arg, &end, 10);
+    if (errno || end == arg || *arg == '-') {
+        ret = -1;
+    }
+    else if (*end != '\0') {
+        unit = strchr(SIZE_UNITS, toupper(*end));
+        if (unit == NULL || *unit == '\0' || end[1] != '\0') {
+            ret = -1;
+        }
+        else {
+            *size <<= 10 * (unit - SIZE_UNITS + 1);
+        }
+    }
+    return ret;
+}
+
+/**
+ * Parses arg as a number greater than 0 into value.
+ * Returns 0 on success and -1 if arg is not a valid positive number.
  */
-void output_path_list(list *path_list) {
-    node *curr = *path_list;
-    while (curr != NULL) {
-        printf("%s\n", curr->data.path);
-        curr = curr->next;
+int get_positive(char *arg, double *value) {
+    char *end = NULL;
+    int ret = 0;
+
+    errno = 0;
+    *value = strtod(arg, &end);
+    if (errno || end == arg || *end != '\0' || !(*value > 0)) {
+        ret = -1;
+    }
+    return ret;
+}
+
+/**
+ * Prints the counters of find_stats, the time spent in each phase and, for
+ *   every kind of primary in query_set, how many files it was evaluated
+ *   against and how many it was true for, summed across queries. Primaries
+ *   sharing another's result aren't evaluated themselves and count nothing.
+ *   The same is printed as a JSON object if json is true.
+ */
+void print_stats(query_set_t *query_set, bool json) {
+    unsigned long evals[PRIMARY_NUM] = {0}, trues[PRIMARY_NUM] = {0};
+    primary_node *curr = NULL;
+    const char *sep = "";
+
+    for (int i = 0; i < query_set->query_c; i++) {
+        curr = query_set->queries[i].expression.head;
+        while (curr != NULL) {
+            evals[curr->primary] += curr->eval_c;
+            trues[curr->primary] += curr->true_c;
+            curr = curr->next;
+        }
+    }
+    if (json) {
+        fprintf(stderr, "{\"entries\": %lu, \"directories\": %lu, " \
+            "\"stat_calls\": %lu, \"prefetch_queued\": %lu, " \
+            "\"prefetched\": %lu, \"matches\": %lu, " \
+            "\"exec_children\": %lu, " \
+            "\"sort_comparisons\": %llu, \"bytes_written\": %llu, " \
+            "\"seconds\": {\"total\": %.6f", find_stats.entries, \
+            find_stats.dirs, find_stats.stat_calls, \
+            find_stats.prefetch_queued, find_stats.prefetched, \
+            find_stats.matches, \
+            find_stats.exec_c, \
+            find_stats.compares, find_stats.bytes, stats_total_ns() / 1e9);
+        for (int i = 0; i < STATS_PHASE_NUM; i++) {
+            fprintf(stderr, ", \"%s\": %.6f", stats_phase_map[i], \
+                find_stats.phase_ns[i] / 1e9);
+        }
+        fprintf(stderr, "}, \"primaries\": {");
+        for (int i = 0; i < PRIMARY_NUM; i++) {
+            if (evals[i] > 0) {
+                fprintf(stderr, "%s\"%s\": {\"evaluations\": %lu, " \
+                    "\"true\": %lu}", sep, primary_str_map[i], evals[i], \
+                    trues[i]);
+                sep = ", ";
+            }
+        }
+        fprintf(stderr, "}}\n");
+    }
+    else {
+        fprintf(stderr, "entries           %lu\ndirectories       %lu\n" \
+            "stat calls        %lu\nprefetch queued   %lu\n" \
+            "prefetched dirs   %lu\nmatches           %lu\n" \
+            "exec children     %lu\n" \
+            "sort comparisons  %llu\nbytes written     %llu\n" \
+            "total time        %.6fs\n", find_stats.entries, \
+            find_stats.dirs, find_stats.stat_calls, \
+            find_stats.prefetch_queued, find_stats.prefetched, \
+            find_stats.matches, \
+            find_stats.exec_c, \
+            find_stats.compares, find_stats.bytes, stats_total_ns() / 1e9);
+        for (int i = 0; i < STATS_PHASE_NUM; i++) {
+            fprintf(stderr, "%-8s time     %.6fs\n", stats_phase_map[i], \
+                find_stats.phase_ns[i] / 1e9);
+        }
+        for (int i = 0; i < PRIMARY_NUM; i++) {
+            if (evals[i] > 0) {
+                fprintf(stderr, "%-17s %lu evaluated, %lu true (%.1f%%)\n", \
+                    primary_str_map[i], evals[i], trues[i], \
+                    100.0 * trues[i] / evals[i]);
+            }
+        }
     }
 }
 
@@ -162,6 +731,14 @@ void expression_perror(expr_err err, char *pname) {
     case EXPR_ERR_NO_ARG:
         fprintf(stderr, "%s: primary missing an argument\n", pname);
         break;
+    case EXPR_ERR_FINISH:
+        break;
+    case EXPR_ERR_OUTPUT:
+        perror(pname);
+        break;
+    case EXPR_ERR_INPUT:
+        perror(pname);
+        break;
     }
 }
 
@@ -178,5 +755,25 @@ void find_perror(find_err err, char *pname) {
         perror(pname);
     case FIND_ERR_FTS_READ:
         perror(pname);
+        break;
+    case FIND_ERR_FINISH:
+        fprintf(stderr, "%s: could not complete the expression's actions\n", \
+            pname);
+        break;
+    case FIND_ERR_OUTPUT:
+        perror(pname);
+        break;
+    case FIND_ERR_IGNORE:
+        perror(pname);
+        break;
+    case FIND_ERR_PROGRESS:
+        perror(pname);
+        break;
+    case FIND_ERR_TAR:
+        fprintf(stderr, "%s: tar: %s\n", pname, strerror(errno));
+        break;
+    case FIND_ERR_CHECKPOINT:
+        fprintf(stderr, "%s: checkpoint: %s\n", pname, strerror(errno));
+        break;
     }
 }
\ No newline at end of file
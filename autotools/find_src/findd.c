@@ -0,0 +1,92 @@
+/**
+ * findd program. Keeps the metadata of a file tree in memory, fed by inotify,
+ *   and answers find --daemon queries about it over a UNIX socket, so
+ *   repeated searches of a large tree don't walk it again. The tree is read
+ *   once at startup. Changes are applied as their events arrive and again
+ *   before each query, so a query sees every change made before it was sent.
+ *   Queries are answered one at a time, in the order they connect.
+ */
+#include <stdio.h>
+#include <signal.h>
+#include <poll.h>
+#include "cache.h"
+#include "daemon.h"
+
+// Set by a signal asking the daemon to exit
+static volatile sig_atomic_t findd_stop = 0;
+
+// Sets findd_stop.
+void findd_signal(int sig);
+
+/**
+ * Caches the tree at argv[1] and serves queries on a socket at argv[2] until
+ *   SIGINT or SIGTERM, then removes the socket. Events are read whenever
+ *   they arrive, even with no query to answer, so the kernel's queue doesn't
+ *   overflow while the daemon is idle.
+ * Returns 0 on success, 1 on error.
+ */
+int main(int argc, char **argv) {
+    struct sigaction action;
+    struct pollfd fds[2];
+    cache_t cache;
+    int client = -1, ret = 0;
+
+    memset(&action, 0, sizeof(struct sigaction));
+    action.sa_handler = findd_signal;
+    sigemptyset(&(action.sa_mask));
+    if (argc != 3) {
+        printf("%s: invalid arguments\n", argv[0]);
+        printf("Usage: %s root socket\n", argv[0]);
+        ret = 1;
+    }
+    else if (cache_open(&cache, argv[1]) < 0) {
+        perror(argv[0]);
+        ret = 1;
+    }
+    else {
+        signal(SIGPIPE, SIG_IGN);
+        sigaction(SIGINT, &action, NULL);
+        sigaction(SIGTERM, &action, NULL);
+        fds[0].fd = daemon_listen(argv[2]);
+        fds[0].events = POLLIN;
+        fds[1].fd = cache.inotify_fd;
+        fds[1].events = POLLIN;
+        if (fds[0].fd < 0 || chdir("/") < 0) {
+            perror(argv[0]);
+            ret = 1;
+        }
+        while (ret == 0 && !findd_stop) {
+            errno = 0;
+            if (poll(fds, 2, -1) < 0) {
+                if (errno != EINTR) {
+                    perror(argv[0]);
+                    ret = 1;
+                }
+            }
+            else if ((fds[1].revents & POLLIN) && cache_update(&cache) < 0) {
+                perror(argv[0]);
+                ret = 1;
+            }
+            else if ((fds[0].revents & POLLIN) && \
+                    (client = accept(fds[0].fd, NULL, NULL)) >= 0 && \
+                    daemon_serve(&cache, client) < 0) {
+                perror(argv[0]);
+                ret = 1;
+            }
+        }
+        if (fds[0].fd >= 0) {
+            close(fds[0].fd);
+            unlink(argv[2]);
+        }
+        cache_close(&cache);
+    }
+    return ret;
+}
+
+/**
+ * Asks the daemon to exit once it is done with the query in progress.
+ */
+void findd_signal(int sig) {
+    (void)sig;
+    findd_stop = 1;
+}
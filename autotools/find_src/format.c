@@ -0,0 +1,261 @@
+/**
+ * Compiled formats for the -printf action. The format string is parsed once,
+ *   when the expression is created, into a list of ops, each either copying a
+ *   run of literal text or rendering one field of a file: its path, basename,
+ *   size, modification time, inode number or mode string. Evaluating a file
+ *   then only walks the ops, rendering each straight into the output's buffer
+ *   with hand-written integer formatting, so printing metadata costs little
+ *   more than printing the path.
+ * Supported directives are %p, %f, %s, %T@, %i, %M and %%, and the escapes
+ *   \n, \t, \0 and \\. Any other directive is an error. Any other escape is
+ *   copied as is. Nothing is printed after the format, so it should end in \n
+ *   or \0 to separate files.
+ */
+#include "format.h"
+
+// Number of characters reserved by each op_type, not counting paths
+static const size_t format_op_len[] = {0, 0, 0, FORMAT_INT_MAX, \
+    1 + FORMAT_INT_MAX + 1 + FORMAT_FRAC_DIGITS, FORMAT_INT_MAX, \
+    MODE_STR_LEN};
+
+/**
+ * Parses format_str into format's ops. Escapes are resolved into a copy of
+ *   format_str that literal ops point into, so adjacent text and escapes
+ *   become a single literal op.
+ * Returns 0 on success, -1 if format_str has an unknown or unterminated
+ *   directive or if memory allocation fails.
+ */
+int format_create(format_t *format, char *format_str) {
+    size_t len = strlen(format_str);
+    char *read = format_str, *write = NULL, *lit = NULL;
+    format_op_type type = FORMAT_LITERAL;
+    int ret = 0;
+
+    format->op_c = 0;
+    format->fixed_len = 0;
+    format->path_c = 0;
+    format->out = NULL;
+    errno = 0;
+    format->ops = malloc(sizeof(format_op) * (len + 1));
+    format->lits = malloc(len + 1);
+    if (format->ops == NULL || format->lits == NULL) {
+        ret = -1;
+    }
+    write = format->lits;
+    lit = write;
+    while (ret == 0 && *read != '\0') {
+        if (*read == FORMAT_ESCAPE && read[1] != '\0') {
+            switch (read[1]) {
+            case 'n':
+                *(write++) = '\n';
+                break;
+            case 't':
+                *(write++) = '\t';
+                break;
+            case '0':
+                *(write++) = '\0';
+                break;
+            case FORMAT_ESCAPE:
+                *(write++) = FORMAT_ESCAPE;
+                break;
+            default:
+                *(write++) = read[0];
+                *(write++) = read[1];
+                break;
+            }
+            read += 2;
+        }
+        else if (*read == FORMAT_DIRECTIVE) {
+            read++;
+            // A directive cut short by the end of format_str is unknown, and
+            //   ends the loop before read is used again
+            switch (*(read++)) {
+            case FORMAT_DIRECTIVE:
+                *(write++) = FORMAT_DIRECTIVE;
+                type = FORMAT_LITERAL;
+                break;
+            case 'p':
+                type = FORMAT_PATH;
+                break;
+            case 'f':
+                type = FORMAT_BASENAME;
+                break;
+            case 's':
+                type = FORMAT_SIZE;
+                break;
+            case 'i':
+                type = FORMAT_INODE;
+                break;
+            case 'M':
+                type = FORMAT_MODE;
+                break;
+            case 'T':
+                if (*(read++) == '@') {
+                    type = FORMAT_MTIME;
+                }
+                else {
+                    ret = -1;
+                }
+                break;
+            default:
+                ret = -1;
+                break;
+            }
+            if (ret == 0 && type != FORMAT_LITERAL) {
+                if (write > lit) {
+                    format_add_op(format, FORMAT_LITERAL, lit, write - lit);
+                }
+                format_add_op(format, type, NULL, 0);
+                lit = write;
+            }
+        }
+        else {
+            *(write++) = *(read++);
+        }
+    }
+    if (ret == 0 && write > lit) {
+        format_add_op(format, FORMAT_LITERAL, lit, write - lit);
+    }
+    if (ret < 0) {
+        format_delete(format);
+    }
+    return ret;
+}
+
+/**
+ * Appends an op of type to format, keeping count of how long its output can
+ *   be. format->ops always has room, as no format has more ops than it has
+ *   characters.
+ */
+void format_add_op(format_t *format, format_op_type type, char *lit, \
+        size_t lit_len) {
+    format_op *op = &(format->ops[format->op_c++]);
+
+    op->type = type;
+    op->lit = lit;
+    op->lit_len = lit_len;
+    format->fixed_len += type == FORMAT_LITERAL ? lit_len : \
+        format_op_len[type];
+    if (type == FORMAT_PATH || type == FORMAT_BASENAME) {
+        format->path_c++;
+    }
+}
+
+/**
+ * Renders every op of format for entry directly into space reserved in
+ *   format's output, and adds the result under entry's path. Failures are
+ *   recorded in the output, as evaluation has no way to report them.
+ * Always returns true.
+ */
+bool format_evaluate(format_t *format, FTSENT *entry) {
+    struct stat *f_stat = entry->fts_statp;
+    size_t path_len = entry->fts_pathlen;
+    char *start = NULL, *write = NULL;
+    format_op *op = NULL;
+
+    start = output_reserve(format->out, format->fixed_len + \
+        format->path_c * path_len);
+    if (start != NULL) {
+        write = start;
+        for (int i = 0; i < format->op_c; i++) {
+            op = &(format->ops[i]);
+            switch (op->type) {
+            case FORMAT_LITERAL:
+                memcpy(write, op->lit, op->lit_len);
+                write += op->lit_len;
+                break;
+            case FORMAT_PATH:
+                memcpy(write, entry->fts_path, path_len);
+                write += path_len;
+                break;
+            case FORMAT_BASENAME:
+                write = format_basename(write, entry);
+                break;
+            case FORMAT_SIZE:
+                write = format_uint(write, f_stat->st_size);
+                break;
+            case FORMAT_MTIME:
+                if (f_stat->st_mtim.tv_sec < 0) {
+                    *(write++) = '-';
+                    write = format_uint(write, -f_stat->st_mtim.tv_sec);
+                }
+                else {
+                    write = format_uint(write, f_stat->st_mtim.tv_sec);
+                }
+                *(write++) = '.';
+                for (long div = 100000000; div > 0; div /= 10) {
+                    *(write++) = '0' + (f_stat->st_mtim.tv_nsec / div) % 10;
+                }
+                for (int j = 9; j < FORMAT_FRAC_DIGITS; j++) {
+                    *(write++) = '0';
+                }
+                break;
+            case FORMAT_INODE:
+                write = format_uint(write, f_stat->st_ino);
+                break;
+            case FORMAT_MODE:
+                parse_mode_str(write, f_stat->st_mode);
+                write += MODE_STR_LEN - 1;
+                break;
+            }
+        }
+        output_commit(format->out, entry->fts_path, write - start);
+    }
+    return true;
+}
+
+/**
+ * Frees the ops and literal text of format.
+ */
+void format_delete(format_t *format) {
+    free(format->ops);
+    free(format->lits);
+    format->ops = NULL;
+    format->lits = NULL;
+    format->op_c = 0;
+}
+
+/**
+ * Writes the decimal digits of val to dest, without a terminating '\0'.
+ * Returns the position in dest after the last digit.
+ */
+char* format_uint(char *dest, unsigned long long val) {
+    char digits[FORMAT_INT_MAX];
+    int i = FORMAT_INT_MAX;
+
+    do {
+        digits[--i] = '0' + val % 10;
+        val /= 10;
+    } while (val > 0);
+    memcpy(dest, digits + i, FORMAT_INT_MAX - i);
+    return dest + FORMAT_INT_MAX - i;
+}
+
+/**
+ * Writes the last component of entry's path to dest. Below the root that is
+ *   the name fts gives it. For the root it is the part of the path after the
+ *   last '/', ignoring trailing ones, or "/" if there is nothing else.
+ * Returns the position in dest after the name.
+ */
+char* format_basename(char *dest, FTSENT *entry) {
+    char *start = entry->fts_path;
+    size_t len = entry->fts_pathlen, i = 0;
+
+    if (entry->fts_level > FTS_ROOTLEVEL) {
+        start = entry->fts_name;
+        len = entry->fts_namelen;
+    }
+    else {
+        while (len > 1 && start[len - 1] == '/') {
+            len--;
+        }
+        i = len - 1;
+        while (i > 0 && start[i - 1] != '/') {
+            i--;
+        }
+        start += i;
+        len -= i;
+    }
+    memcpy(dest, start, len);
+    return dest + len;
+}
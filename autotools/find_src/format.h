@@ -0,0 +1,75 @@
+#ifndef __FORMAT_H
+#define __FORMAT_H
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <fts.h>
+#include "output.h"
+#include "../common_src/long_fmt.h"
+
+// Starts a directive and an escape sequence in a -printf format
+#define FORMAT_DIRECTIVE '%'
+#define FORMAT_ESCAPE '\\'
+// Most characters an unsigned 64-bit integer takes to print
+#define FORMAT_INT_MAX 20
+// Digits printed after the decimal point of a %T@ time
+#define FORMAT_FRAC_DIGITS 10
+
+typedef enum format_op_type format_op_type;
+typedef struct format_op format_op;
+typedef struct format_s format_t;
+
+// Each piece of output a format can produce
+enum format_op_type {
+    FORMAT_LITERAL  = 0,
+    FORMAT_PATH     = 1,
+    FORMAT_BASENAME = 2,
+    FORMAT_SIZE     = 3,
+    FORMAT_MTIME    = 4,
+    FORMAT_INODE    = 5,
+    FORMAT_MODE     = 6
+};
+
+// A single step of a compiled format. Only FORMAT_LITERAL uses lit, which
+//   points into the format's own copy of its literal text.
+struct format_op {
+    format_op_type type;
+    char *lit;
+    size_t lit_len;
+};
+
+// A -printf format compiled into the ops that render it, along with the output
+//   it renders into. out is only set once the expression is part of a query
+//   set.
+struct format_s {
+    format_op *ops;
+    int op_c;
+    char *lits;
+
+    // Longest the ops can render excluding paths, and the number of ops that
+    //   copy all or part of the path.
+    size_t fixed_len;
+    int path_c;
+
+    struct output_s *out;
+};
+
+// Compiles format_str into format. format must already be allocated.
+int format_create(format_t *format, char *format_str);
+
+// Renders format for entry into format's output.
+bool format_evaluate(format_t *format, FTSENT *entry);
+
+// Frees the memory held by format.
+void format_delete(format_t *format);
+
+// Helpers for format_create and format_evaluate
+void format_add_op(format_t *format, format_op_type type, char *lit, \
+    size_t lit_len);
+char* format_uint(char *dest, unsigned long long val);
+char* format_basename(char *dest, FTSENT *entry);
+
+#endif /* __FORMAT_H */
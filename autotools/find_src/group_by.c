@@ -0,0 +1,354 @@
+/**
+ * Aggregation of matched files for the -group-by primary. Instead of printing
+ *   every matching path, each match is folded into a row of a hash table keyed
+ *   by the requested dimensions (file type, owner, extension and age bucket),
+ *   accumulating the number of files and their total size. Only the finished
+ *   table is printed, which keeps the output a few rows long no matter how
+ *   many files were matched.
+ */
+#include "group_by.h"
+#include "expression_prim_eval.h"
+
+const char *const group_key_str_map[] = {"type", "uid", "ext", "age"};
+
+// Upper bound, in days, of each age bucket and the label printed for it. A
+//   file falls in the first bucket whose bound is not less than its age. The
+//   final label is for everything older than the last bound.
+static const time_t age_bucket_bound[] = {1, 7, 30, 90, 365};
+static const char *const age_bucket_str[] = {"0-1d", "1-7d", "7-30d", \
+    "30-90d", "90-365d", "365d+"};
+static const int age_bucket_c = 5;
+
+static int group_row_order(const void *r1, const void *r2);
+
+/**
+ * Parses key_str as a GROUP_BY_KEY_SEP separated list of key names and sets up
+ *   an empty table for them. Each key may only be given once.
+ * Returns 0 on success, -1 if a key is unknown, repeated, or if memory
+ *   allocation fails.
+ */
+int group_by_create(group_by_t *group_by, char *key_str) {
+    char *start = key_str, *end = NULL;
+    size_t len;
+    group_key key;
+    int ret = 0;
+
+    group_by->key_c = 0;
+    group_by->rows = NULL;
+    group_by->slot_c = 0;
+    group_by->row_c = 0;
+    group_by->err = false;
+
+    while (start != NULL && ret == 0) {
+        end = strchr(start, GROUP_BY_KEY_SEP);
+        len = end == NULL ? strlen(start) : (size_t)(end - start);
+
+        key = 0;
+        while (key < GROUP_KEY_NUM && \
+                (strlen(group_key_str_map[key]) != len || \
+                strncmp(start, group_key_str_map[key], len) != 0)) {
+            key++;
+        }
+        if (key == GROUP_KEY_NUM || group_by->key_c == GROUP_BY_KEY_MAX) {
+            ret = -1;
+        }
+        else {
+            for (int i = 0; i < group_by->key_c; i++) {
+                if (group_by->keys[i] == key) {
+                    ret = -1;
+                }
+            }
+            group_by->keys[group_by->key_c++] = key;
+        }
+        start = end == NULL ? NULL : end + 1;
+    }
+
+    if (ret == 0) {
+        errno = 0;
+        group_by->rows = calloc(GROUP_BY_INIT_SLOTS, sizeof(group_row));
+        if (group_by->rows == NULL) {
+            ret = -1;
+        }
+        else {
+            group_by->slot_c = GROUP_BY_INIT_SLOTS;
+        }
+    }
+    return ret;
+}
+
+/**
+ * Finds the row whose key values match entry, inserting a new one if none
+ *   exists, and adds entry's size to it. The table is grown before it gets
+ *   too full for linear probing to stay cheap.
+ * Returns 0 on success and -1 if memory allocation fails, which is also
+ *   recorded in group_by so it can be reported once the table is output.
+ */
+int group_by_add(group_by_t *group_by, FTSENT *entry, time_t start_time_day) {
+    group_row key;
+    group_row *row = NULL;
+    size_t i;
+    int ret = 0;
+
+    if ((group_by->row_c + 1) * 10 > group_by->slot_c * 7) {
+        ret = group_by_grow(group_by);
+    }
+    if (ret == 0) {
+        group_row_fill(group_by, &key, entry, start_time_day);
+
+        i = group_row_hash(&key) & (group_by->slot_c - 1);
+        while (group_by->rows[i].used && \
+                !group_row_equal(&(group_by->rows[i]), &key)) {
+            i = (i + 1) & (group_by->slot_c - 1);
+        }
+        row = &(group_by->rows[i]);
+
+        if (!row->used) {
+            *row = key;
+            if (key.ext != NULL) {
+                errno = 0;
+                row->ext = strdup(key.ext);
+                if (row->ext == NULL) {
+                    row->used = false;
+                    ret = -1;
+                }
+            }
+            if (ret == 0) {
+                group_by->row_c++;
+            }
+        }
+        if (ret == 0) {
+            row->count++;
+            row->bytes += entry->fts_statp->st_size;
+        }
+    }
+    if (ret < 0) {
+        group_by->err = true;
+    }
+    return ret;
+}
+
+/**
+ * Fills the key fields of row that group_by is keyed on with the values of
+ *   entry. Fields that are not keys are zeroed. The extension is borrowed from
+ *   entry and must be copied if row is kept.
+ */
+void group_row_fill(group_by_t *group_by, group_row *row, FTSENT *entry, \
+        time_t start_time_day) {
+    memset(row, 0, sizeof(group_row));
+    row->used = true;
+    for (int i = 0; i < group_by->key_c; i++) {
+        switch (group_by->keys[i]) {
+        case GROUP_KEY_TYPE:
+            row->type = get_type_char(entry->fts_statp->st_mode);
+            break;
+        case GROUP_KEY_UID:
+            row->uid = entry->fts_statp->st_uid;
+            break;
+        case GROUP_KEY_EXT:
+            row->ext = (char*)get_ext(entry->fts_name);
+            break;
+        case GROUP_KEY_AGE:
+            row->age = get_age_bucket( \
+                entry->fts_statp->st_mtim.tv_sec / SEC_PER_DAY, \
+                start_time_day);
+            break;
+        case GROUP_KEY_NUM:
+            abort();
+        }
+    }
+}
+
+/**
+ * FNV-1a hash over the key fields of row.
+ */
+unsigned long group_row_hash(group_row *row) {
+    unsigned long hash = 2166136261UL;
+    const char *ext = row->ext == NULL ? "" : row->ext;
+
+    hash = (hash ^ (unsigned char)row->type) * 16777619UL;
+    hash = (hash ^ (unsigned long)row->uid) * 16777619UL;
+    hash = (hash ^ (unsigned long)row->age) * 16777619UL;
+    while (*ext != '\0') {
+        hash = (hash ^ (unsigned char)*ext) * 16777619UL;
+        ext++;
+    }
+    return hash;
+}
+
+/**
+ * Returns true if r1 and r2 have the same key values, false otherwise.
+ */
+bool group_row_equal(group_row *r1, group_row *r2) {
+    return r1->type == r2->type && r1->uid == r2->uid && r1->age == r2->age && \
+        (r1->ext == r2->ext || (r1->ext != NULL && r2->ext != NULL && \
+        strcmp(r1->ext, r2->ext) == 0));
+}
+
+/**
+ * Doubles the number of slots in group_by and rehashes every row into them.
+ * Returns 0 on success and -1 if memory allocation fails, in which case the
+ *   table is left untouched.
+ */
+int group_by_grow(group_by_t *group_by) {
+    group_row *rows = NULL;
+    size_t slot_c = group_by->slot_c * 2, j;
+    int ret = 0;
+
+    errno = 0;
+    rows = calloc(slot_c, sizeof(group_row));
+    if (rows == NULL) {
+        ret = -1;
+    }
+    else {
+        for (size_t i = 0; i < group_by->slot_c; i++) {
+            if (group_by->rows[i].used) {
+                j = group_row_hash(&(group_by->rows[i])) & (slot_c - 1);
+                while (rows[j].used) {
+                    j = (j + 1) & (slot_c - 1);
+                }
+                rows[j] = group_by->rows[i];
+            }
+        }
+        free(group_by->rows);
+        group_by->rows = rows;
+        group_by->slot_c = slot_c;
+    }
+    return ret;
+}
+
+/**
+ * Prints a header naming each key followed by one tab separated line per row,
+ *   ordered by the key values in the order the keys were given. Each line ends
+ *   with the row's file count and total size in bytes.
+ * Returns 0 on success and -1 if memory allocation fails now or failed while
+ *   the table was being filled, or if out could not be flushed.
+ */
+int group_by_output(group_by_t *group_by, FILE *out) {
+    group_ref *sorted = NULL;
+    group_row *row = NULL;
+    size_t j = 0;
+    int ret = 0;
+
+    errno = 0;
+    sorted = malloc(sizeof(group_ref) * (group_by->row_c + 1));
+    if (sorted == NULL || group_by->err) {
+        free(sorted);
+        ret = -1;
+    }
+    else {
+        for (size_t i = 0; i < group_by->slot_c; i++) {
+            if (group_by->rows[i].used) {
+                sorted[j].row = &(group_by->rows[i]);
+                sorted[j++].group_by = group_by;
+            }
+        }
+        assert(j == group_by->row_c);
+        qsort(sorted, j, sizeof(group_ref), group_row_order);
+
+        for (int k = 0; k < group_by->key_c; k++) {
+            fprintf(out, "%s\t", group_key_str_map[group_by->keys[k]]);
+        }
+        fprintf(out, "count\tsize\n");
+        for (size_t i = 0; i < j; i++) {
+            row = sorted[i].row;
+            for (int k = 0; k < group_by->key_c; k++) {
+                switch (group_by->keys[k]) {
+                case GROUP_KEY_TYPE:
+                    fprintf(out, "%c\t", row->type);
+                    break;
+                case GROUP_KEY_UID:
+                    fprintf(out, "%lu\t", (unsigned long)row->uid);
+                    break;
+                case GROUP_KEY_EXT:
+                    fprintf(out, "%s\t", row->ext);
+                    break;
+                case GROUP_KEY_AGE:
+                    fprintf(out, "%s\t", age_bucket_str[row->age]);
+                    break;
+                case GROUP_KEY_NUM:
+                    abort();
+                }
+            }
+            fprintf(out, "%llu\t%llu\n", row->count, row->bytes);
+        }
+        free(sorted);
+        if (fflush(out) == EOF) {
+            ret = -1;
+        }
+    }
+    return ret;
+}
+
+/**
+ * Orders the rows r1 and r2 refer to by the keys of their table, in the order
+ *   they were given.
+ */
+static int group_row_order(const void *r1, const void *r2) {
+    const group_row *row1 = ((const group_ref*)r1)->row;
+    const group_row *row2 = ((const group_ref*)r2)->row;
+    const group_by_t *group_by = ((const group_ref*)r1)->group_by;
+    int ret = 0;
+
+    for (int k = 0; ret == 0 && k < group_by->key_c; k++) {
+        switch (group_by->keys[k]) {
+        case GROUP_KEY_TYPE:
+            ret = (row1->type > row2->type) - (row1->type < row2->type);
+            break;
+        case GROUP_KEY_UID:
+            ret = (row1->uid > row2->uid) - (row1->uid < row2->uid);
+            break;
+        case GROUP_KEY_EXT:
+            ret = strcmp(row1->ext, row2->ext);
+            break;
+        case GROUP_KEY_AGE:
+            ret = row1->age - row2->age;
+            break;
+        case GROUP_KEY_NUM:
+            abort();
+        }
+    }
+    return ret;
+}
+
+/**
+ * Frees every row and the table itself.
+ */
+void group_by_delete(group_by_t *group_by) {
+    for (size_t i = 0; i < group_by->slot_c; i++) {
+        if (group_by->rows[i].used) {
+            free(group_by->rows[i].ext);
+        }
+    }
+    free(group_by->rows);
+    group_by->rows = NULL;
+    group_by->slot_c = 0;
+    group_by->row_c = 0;
+}
+
+/**
+ * Returns the part of f_name after its last '.', or the empty string if there
+ *   is none. A leading '.' marks a hidden file rather than an extension.
+ */
+const char* get_ext(const char *f_name) {
+    const char *dot = strrchr(f_name, '.');
+    const char *ret = "";
+
+    if (dot != NULL && dot != f_name) {
+        ret = dot + 1;
+    }
+    return ret;
+}
+
+/**
+ * Returns the index into age_bucket_str of the bucket for a file last modified
+ *   on day, where age is measured the same way as the -mtime primary.
+ */
+int get_age_bucket(time_t day, time_t start_time_day) {
+    time_t age = start_time_day - day;
+    int i = 0;
+
+    while (i < age_bucket_c && age > age_bucket_bound[i]) {
+        i++;
+    }
+    return i;
+}
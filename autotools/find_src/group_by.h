@@ -0,0 +1,97 @@
+#ifndef __GROUP_BY_H
+#define __GROUP_BY_H
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <assert.h>
+#include <fts.h>
+
+// Separator between keys in a -group-by argument
+#define GROUP_BY_KEY_SEP ','
+// Maximum number of keys in a single -group-by argument
+#define GROUP_BY_KEY_MAX 4
+// Initial number of slots in the aggregation table. Must be a power of two.
+#define GROUP_BY_INIT_SLOTS 64
+
+typedef enum group_key group_key;
+typedef struct group_row group_row;
+typedef struct group_by_s group_by_t;
+typedef struct group_ref_s group_ref;
+
+// Dimensions an entry can be grouped by
+enum group_key {
+    GROUP_KEY_TYPE = 0,
+    GROUP_KEY_UID  = 1,
+    GROUP_KEY_EXT  = 2,
+    GROUP_KEY_AGE  = 3,
+    GROUP_KEY_NUM  = 4
+};
+
+// Maps any group_key to its string representation.
+extern const char *const group_key_str_map[];
+
+// One row of the aggregation table. Only the fields named by the table's keys
+//   are meaningful, the rest are left zeroed so rows compare equal on them.
+struct group_row {
+    char type;
+    uid_t uid;
+    int age;
+    char *ext;
+
+    unsigned long long count;
+    unsigned long long bytes;
+    bool used;
+};
+
+// An open-addressed hash table of rows keyed by the requested dimensions.
+struct group_by_s {
+    group_key keys[GROUP_BY_KEY_MAX];
+    int key_c;
+
+    group_row *rows;
+    size_t slot_c;
+    size_t row_c;
+
+    // Set if a row could not be added, as evaluation has no way to report it.
+    bool err;
+};
+
+// A row being sorted for output, along with the table whose keys order it,
+//   as qsort gives no other way of passing them to the comparison function.
+struct group_ref_s {
+    group_row *row;
+    group_by_t *group_by;
+};
+
+// Creates a group_by table from a comma separated list of key names.
+//   group_by must already be allocated.
+int group_by_create(group_by_t *group_by, char *key_str);
+
+// Adds entry to the row matching its key values. start_time_day is the day
+//   the program started, as computed by get_prog_state.
+int group_by_add(group_by_t *group_by, FTSENT *entry, time_t start_time_day);
+
+// Prints every row of group_by to out, ordered by key values.
+int group_by_output(group_by_t *group_by, FILE *out);
+
+// Frees all memory held by group_by.
+void group_by_delete(group_by_t *group_by);
+
+// Helpers for group_by_add
+void group_row_fill(group_by_t *group_by, group_row *row, FTSENT *entry, \
+    time_t start_time_day);
+unsigned long group_row_hash(group_row *row);
+bool group_row_equal(group_row *r1, group_row *r2);
+int group_by_grow(group_by_t *group_by);
+
+// Gets the extension of f_name, or the empty string if it has none.
+const char* get_ext(const char *f_name);
+
+// Gets the index of the age bucket that a file modified on day falls in.
+int get_age_bucket(time_t day, time_t start_time_day);
+
+#endif /* __GROUP_BY_H */
@@ -0,0 +1,397 @@
+/**
+ * Ignore files for the traversal, in the format of .gitignore. Their patterns
+ *   are compiled into layers kept on a stack that follows the traversal: an
+ *   --ignore-file is pushed before it starts, and with --gitignore each
+ *   directory's IGNORE_GITIGNORE is pushed when the directory is entered and
+ *   popped when it is left. Matching a file checks the layers from the top, so
+ *   deeper ignore files override shallower ones, and within a layer the last
+ *   matching pattern decides.
+ * An ignored file is never evaluated, and an ignored directory is skipped
+ *   before fts reads it, so nothing below it costs anything. As with git, a
+ *   file inside an ignored directory can't be re-included.
+ * Each pattern is compiled into the cheapest way of matching it: a plain
+ *   name is compared as a string, a '*' followed by a plain suffix compares
+ *   the end of the name, and only the rest are globbed. Globs support '*', '?',
+ *   bracket expressions, '\' escapes and '**' matching any number of
+ *   directories.
+ */
+#include "ignore.h"
+
+/**
+ * Initializes ignore with no layers.
+ */
+void ignore_create(ignore_t *ignore, bool gitignore) {
+    ignore->layers = NULL;
+    ignore->layer_c = 0;
+    ignore->layer_max = 0;
+    ignore->gitignore = gitignore;
+}
+
+/**
+ * Pushes a layer for the file at path and compiles each of its lines into a
+ *   pattern of the layer. Blank lines and lines starting with IGNORE_COMMENT
+ *   are skipped. A file without any patterns leaves no layer behind.
+ * Returns 0 on success and -1 if the file could not be read or memory
+ *   allocation fails, with errno set.
+ */
+int ignore_add_file(ignore_t *ignore, char *path, size_t base_len, int level) {
+    FILE *file = NULL;
+    char *line = NULL;
+    size_t line_len = 0;
+    int ret = 0;
+
+    errno = 0;
+    file = fopen(path, "r");
+    if (file == NULL) {
+        ret = -1;
+    }
+    else {
+        ret = ignore_push(ignore, base_len, level);
+        errno = 0;
+        while (ret == 0 && getline(&line, &line_len, file) != -1) {
+            ret = ignore_compile(&(ignore->layers[ignore->layer_c - 1]), \
+                line);
+            errno = 0;
+        }
+        if (ret == 0 && ferror(file)) {
+            ret = -1;
+        }
+        if (ret == 0 && ignore->layers[ignore->layer_c - 1].pat_c == 0) {
+            free(ignore->layers[ignore->layer_c - 1].pats);
+            ignore->layer_c--;
+        }
+        free(line);
+        fclose(file);
+    }
+    return ret;
+}
+
+/**
+ * Pushes the layer of the IGNORE_GITIGNORE inside the directory entry, if
+ *   ignore honors them. Its patterns are relative to entry's path.
+ * Returns 0 on success, including when there is no such file or the
+ *   directory can't be searched, and -1 if it could not be read or memory
+ *   allocation fails.
+ */
+int ignore_enter(ignore_t *ignore, FTSENT *entry) {
+    char *path = NULL;
+    size_t base_len = entry->fts_pathlen;
+    int ret = 0;
+
+    if (ignore->gitignore) {
+        if (base_len > 0 && entry->fts_path[base_len - 1] == '/') {
+            base_len--;
+        }
+        errno = 0;
+        path = malloc(base_len + sizeof(IGNORE_GITIGNORE) + 1);
+        if (path == NULL) {
+            ret = -1;
+        }
+        else {
+            memcpy(path, entry->fts_path, base_len);
+            path[base_len] = '/';
+            memcpy(path + base_len + 1, IGNORE_GITIGNORE, \
+                sizeof(IGNORE_GITIGNORE));
+            ret = ignore_add_file(ignore, path, base_len, entry->fts_level);
+            if (ret < 0 && (errno == ENOENT || errno == ENOTDIR || \
+                    errno == EACCES)) {
+                ret = 0;
+            }
+            free(path);
+        }
+    }
+    return ret;
+}
+
+/**
+ * Pops every layer pushed when the directory entry was entered.
+ */
+void ignore_leave(ignore_t *ignore, FTSENT *entry) {
+    ignore_layer *top = NULL;
+
+    while (ignore->layer_c > 0 && \
+            (top = &(ignore->layers[ignore->layer_c - 1]))->level == \
+            entry->fts_level) {
+        for (int i = 0; i < top->pat_c; i++) {
+            free(top->pats[i].pat);
+        }
+        free(top->pats);
+        ignore->layer_c--;
+    }
+}
+
+/**
+ * Checks the patterns of every layer against entry, from the last pattern of
+ *   the top layer down, until one matches. The root is never ignored.
+ * Returns true if the first pattern to match ignores entry, false if it
+ *   re-includes it or no pattern matches.
+ */
+bool ignore_match(ignore_t *ignore, FTSENT *entry) {
+    ignore_layer *layer = NULL;
+    bool ret = false, found = false;
+
+    if (entry->fts_level > FTS_ROOTLEVEL) {
+        for (int i = ignore->layer_c - 1; i >= 0 && !found; i--) {
+            layer = &(ignore->layers[i]);
+            for (int j = layer->pat_c - 1; j >= 0 && !found; j--) {
+                found = ignore_pat_match(&(layer->pats[j]), entry, \
+                    layer->base_len);
+                ret = found && !layer->pats[j].negate;
+            }
+        }
+    }
+    return ret;
+}
+
+/**
+ * Frees every layer of ignore, leaving it empty.
+ */
+void ignore_delete(ignore_t *ignore) {
+    for (int i = 0; i < ignore->layer_c; i++) {
+        for (int j = 0; j < ignore->layers[i].pat_c; j++) {
+            free(ignore->layers[i].pats[j].pat);
+        }
+        free(ignore->layers[i].pats);
+    }
+    free(ignore->layers);
+    ignore->layers = NULL;
+    ignore->layer_c = 0;
+    ignore->layer_max = 0;
+}
+
+/**
+ * Pushes an empty layer onto ignore, growing the stack if it is full.
+ * Returns 0 on success and -1 if memory allocation fails.
+ */
+int ignore_push(ignore_t *ignore, size_t base_len, int level) {
+    ignore_layer *layers = NULL;
+    int layer_max = ignore->layer_max == 0 ? IGNORE_INIT_MAX : \
+        ignore->layer_max * 2;
+    int ret = 0;
+
+    if (ignore->layer_c == ignore->layer_max) {
+        errno = 0;
+        layers = realloc(ignore->layers, sizeof(ignore_layer) * layer_max);
+        if (layers == NULL) {
+            ret = -1;
+        }
+        else {
+            ignore->layers = layers;
+            ignore->layer_max = layer_max;
+        }
+    }
+    if (ret == 0) {
+        ignore->layers[ignore->layer_c].pats = NULL;
+        ignore->layers[ignore->layer_c].pat_c = 0;
+        ignore->layers[ignore->layer_c].pat_max = 0;
+        ignore->layers[ignore->layer_c].base_len = base_len;
+        ignore->layers[ignore->layer_c].level = level;
+        ignore->layer_c++;
+    }
+    return ret;
+}
+
+/**
+ * Compiles line into a pattern appended to layer, unless it is blank or a
+ *   comment. The line's newline and unescaped trailing spaces are dropped.
+ * Returns 0 on success and -1 if memory allocation fails.
+ */
+int ignore_compile(ignore_layer *layer, char *line) {
+    ignore_pat *pats = NULL, *pat = NULL;
+    size_t len = strlen(line);
+    int pat_max = layer->pat_max == 0 ? IGNORE_INIT_MAX : layer->pat_max * 2;
+    bool negate = false, dir_only = false;
+    int ret = 0;
+
+    while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r')) {
+        len--;
+    }
+    while (len > 0 && line[len - 1] == ' ' && \
+            (len < 2 || line[len - 2] != IGNORE_ESCAPE)) {
+        len--;
+    }
+    if (len > 0 && line[0] == IGNORE_NEGATE) {
+        negate = true;
+        line++;
+        len--;
+    }
+    if (len > 0 && line[len - 1] == '/') {
+        dir_only = true;
+        len--;
+    }
+    line[len] = '\0';
+    if (len > 0 && line[0] != IGNORE_COMMENT && !(len == 1 && *line == '/')) {
+        if (layer->pat_c == layer->pat_max) {
+            errno = 0;
+            pats = realloc(layer->pats, sizeof(ignore_pat) * pat_max);
+            if (pats == NULL) {
+                ret = -1;
+            }
+            else {
+                layer->pats = pats;
+                layer->pat_max = pat_max;
+            }
+        }
+        if (ret == 0) {
+            pat = &(layer->pats[layer->pat_c]);
+            pat->negate = negate;
+            pat->dir_only = dir_only;
+            pat->anchored = strchr(line, '/') != NULL;
+            if (line[0] == '/') {
+                line++;
+                len--;
+            }
+            pat->kind = IGNORE_GLOB;
+            if (strpbrk(line, "*?[\\") == NULL) {
+                pat->kind = IGNORE_LITERAL;
+            }
+            else if (line[0] == '*' && !pat->anchored && \
+                    strpbrk(line + 1, "*?[\\") == NULL) {
+                pat->kind = IGNORE_SUFFIX;
+            }
+            pat->len = len;
+            errno = 0;
+            pat->pat = strdup(line);
+            if (pat->pat == NULL) {
+                ret = -1;
+            }
+            else {
+                layer->pat_c++;
+            }
+        }
+    }
+    return ret;
+}
+
+/**
+ * Matches pat against entry. An anchored pattern is matched against entry's
+ *   path relative to the layer's directory, the first base_len bytes of the
+ *   path, and any other against entry's name.
+ * Returns true if pat matches entry, false otherwise.
+ */
+bool ignore_pat_match(ignore_pat *pat, FTSENT *entry, size_t base_len) {
+    char *str = entry->fts_name;
+    size_t len = entry->fts_namelen;
+    bool ret = false;
+
+    if (pat->anchored) {
+        str = entry->fts_path + base_len + 1;
+        len = entry->fts_pathlen - base_len - 1;
+    }
+    if (!pat->dir_only || entry->fts_info == FTS_D) {
+        switch (pat->kind) {
+        case IGNORE_LITERAL:
+            ret = len == pat->len && memcmp(str, pat->pat, len) == 0;
+            break;
+        case IGNORE_SUFFIX:
+            ret = len >= pat->len - 1 && memcmp(str + len - (pat->len - 1), \
+                pat->pat + 1, pat->len - 1) == 0;
+            break;
+        case IGNORE_GLOB:
+            ret = glob_match(pat->pat, pat->pat, str);
+            break;
+        }
+    }
+    return ret;
+}
+
+/**
+ * Matches str against the glob pat, which starts at pat_start. '*' and '?'
+ *   match any run of characters and any one character within a path
+ *   component. A '**' making up a whole component matches any number of
+ *   components, or everything if it ends pat.
+ * Returns true if all of str matches all of pat, false otherwise.
+ */
+bool glob_match(const char *pat, const char *pat_start, const char *str) {
+    bool ret = false, done = false;
+
+    while (!done) {
+        if (*pat == '\0') {
+            ret = *str == '\0';
+            done = true;
+        }
+        else if (pat[0] == '*' && pat[1] == '*' && \
+                (pat == pat_start || pat[-1] == '/') && \
+                (pat[2] == '/' || pat[2] == '\0')) {
+            ret = pat[2] == '\0' || glob_match(pat + 3, pat_start, str);
+            while (!ret && (str = strchr(str, '/')) != NULL) {
+                str++;
+                ret = glob_match(pat + 3, pat_start, str);
+            }
+            done = true;
+        }
+        else if (*pat == '*') {
+            pat++;
+            ret = glob_match(pat, pat_start, str);
+            while (!ret && *str != '\0' && *str != '/') {
+                str++;
+                ret = glob_match(pat, pat_start, str);
+            }
+            done = true;
+        }
+        else if (*str == '\0' || (*str == '/' && *pat != '/')) {
+            done = true;
+        }
+        else if (*pat == '?') {
+            pat++;
+            str++;
+        }
+        else if (*pat == '[') {
+            if (glob_bracket(&pat, *str)) {
+                str++;
+            }
+            else {
+                done = true;
+            }
+        }
+        else {
+            if (*pat == IGNORE_ESCAPE && pat[1] != '\0') {
+                pat++;
+            }
+            if (*pat == *str) {
+                pat++;
+                str++;
+            }
+            else {
+                done = true;
+            }
+        }
+    }
+    return ret;
+}
+
+/**
+ * Matches c against the bracket expression pat points at, moving pat past
+ *   it. A leading '!' or '^' negates it, a ']' first in it is literal and a
+ *   '-' between two characters is a range. An unclosed '[' is matched as a
+ *   literal character.
+ * Returns true if c matches, false otherwise.
+ */
+bool glob_bracket(const char **pat, char c) {
+    const char *read = *pat + 1;
+    bool negate = false, found = false;
+
+    if (*read == '!' || *read == '^') {
+        negate = true;
+        read++;
+    }
+    do {
+        if (read[1] == '-' && read[2] != ']' && read[2] != '\0') {
+            found = found || (c >= read[0] && c <= read[2]);
+            read += 3;
+        }
+        else {
+            found = found || c == *read;
+            read++;
+        }
+    } while (*read != ']' && *read != '\0');
+    if (*read == '\0') {
+        found = c == '[';
+        *pat += 1;
+    }
+    else {
+        found = found != negate;
+        *pat = read + 1;
+    }
+    return found;
+}
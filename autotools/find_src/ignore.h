@@ -0,0 +1,98 @@
+#ifndef __IGNORE_H
+#define __IGNORE_H
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <fts.h>
+
+// Name of the per-directory ignore files honored with --gitignore
+#define IGNORE_GITIGNORE ".gitignore"
+// Starts a comment, negates a pattern and escapes a character in an ignore file
+#define IGNORE_COMMENT '#'
+#define IGNORE_NEGATE '!'
+#define IGNORE_ESCAPE '\\'
+// Level of layers that are never popped, like those from --ignore-file
+#define IGNORE_LEVEL_ALL (FTS_ROOTLEVEL - 1)
+// Initial number of patterns a layer and layers a stack have room for
+#define IGNORE_INIT_MAX 8
+
+typedef enum ignore_kind ignore_kind;
+typedef struct ignore_pat ignore_pat;
+typedef struct ignore_layer ignore_layer;
+typedef struct ignore_s ignore_t;
+
+// How a pattern is matched, from cheapest to most expensive. Patterns without
+//   wildcards are compared as strings, patterns that are a '*' followed by
+//   plain text compare the end of the name, and anything else is globbed.
+enum ignore_kind {
+    IGNORE_LITERAL = 0,
+    IGNORE_SUFFIX  = 1,
+    IGNORE_GLOB    = 2
+};
+
+// A single compiled pattern. A pattern containing a '/' before its end is
+//   anchored, matching paths relative to its layer's directory, while any
+//   other matches the name of a file at any depth below it. A pattern ending
+//   in '/' only matches directories, and a negated one re-includes what an
+//   earlier pattern ignored.
+struct ignore_pat {
+    char *pat;
+    size_t len;
+    ignore_kind kind;
+    bool negate;
+    bool dir_only;
+    bool anchored;
+};
+
+// The patterns of one ignore file, which apply below the directory whose path
+//   is the first base_len bytes of every path they are matched against. A
+//   layer is popped once the traversal leaves the directory at level.
+struct ignore_layer {
+    ignore_pat *pats;
+    int pat_c;
+    int pat_max;
+    size_t base_len;
+    int level;
+};
+
+// A stack of layers, the most deeply nested directory's on top. Patterns of
+//   deeper layers, and later patterns within a layer, take precedence.
+struct ignore_s {
+    ignore_layer *layers;
+    int layer_c;
+    int layer_max;
+    bool gitignore;
+};
+
+// Initializes an empty ignore stack. If gitignore is true, IGNORE_GITIGNORE
+//   files are read from each directory entered.
+void ignore_create(ignore_t *ignore, bool gitignore);
+
+// Pushes a layer with the patterns in the file at path, applying to files
+//   below the directory whose path is the first base_len bytes of theirs,
+//   until the traversal leaves the directory at level.
+int ignore_add_file(ignore_t *ignore, char *path, size_t base_len, int level);
+
+// Pushes the layer of entry's IGNORE_GITIGNORE, if honored and it exists.
+//   entry must be a directory being entered that was not ignored.
+int ignore_enter(ignore_t *ignore, FTSENT *entry);
+
+// Pops the layers of the directory entry that the traversal is leaving.
+void ignore_leave(ignore_t *ignore, FTSENT *entry);
+
+// Determines if entry is ignored by the patterns on the stack.
+bool ignore_match(ignore_t *ignore, FTSENT *entry);
+
+// Frees every layer of ignore.
+void ignore_delete(ignore_t *ignore);
+
+// Helpers for the functions above
+int ignore_push(ignore_t *ignore, size_t base_len, int level);
+int ignore_compile(ignore_layer *layer, char *line);
+bool ignore_pat_match(ignore_pat *pat, FTSENT *entry, size_t base_len);
+bool glob_match(const char *pat, const char *pat_start, const char *str);
+bool glob_bracket(const char **pat, char c);
+
+#endif /* __IGNORE_H */
@@ -0,0 +1,163 @@
+/**
+ * The expression engine and traversal of find as a library, so a program can
+ *   evaluate queries in-process instead of running find and parsing what it
+ *   prints. Expressions are compiled from the same arguments find takes and
+ *   evaluated against every file of a single walk, as a query set. A query
+ *   without actions has its matches handed to the caller, along with their
+ *   stat structs, either pulled one at a time with libfind_next or pushed to
+ *   a callback by libfind_run. Actions do what they do in find, so -fprint
+ *   still writes its file and -exec still runs its command.
+ * Every traversal keeps its own state: its walk, its queries, and the
+ *   outputs and buffers they use, so several can be open at once and used on
+ *   separate threads, each by one thread at a time. The counters of --stats
+ *   are kept per thread, so traversals on one thread add to the same ones.
+ *   No signal handler is installed.
+ * find is not a client of this API. It drives the same query set and walk
+ *   with a loop of its own, which also handles what the API doesn't expose:
+ *   fts walks, ignore files, checkpoints, throttling, progress reports and
+ *   archives.
+ */
+#include "libfind.h"
+#include "query.h"
+#include "walk.h"
+
+// A traversal and the queries evaluated against it. entry is the file being
+//   evaluated, and query_i the next query to evaluate it with, so a file
+//   matched by several queries is handed over once for each.
+struct libfind_s {
+    query_set_t query_set;
+    walk_t walk;
+    FTSENT *entry;
+    int query_i;
+    bool done;
+};
+
+/**
+ * Allocates finder, adds a query for each expression of expr_argv to its
+ *   query set and opens its walk.
+ * Returns LIBFIND_ERR_NONE on success, LIBFIND_ERR_MALLOC if memory
+ *   allocation fails, LIBFIND_ERR_EXPR if an expression is invalid and
+ *   LIBFIND_ERR_WALK if root can't be walked.
+ */
+libfind_err libfind_open(libfind_t **finder, char *root, char **expr_argv, \
+        int flags) {
+    expr_err e_err = EXPR_ERR_NONE;
+    libfind_err ret = LIBFIND_ERR_NONE;
+
+    errno = 0;
+    *finder = malloc(sizeof(libfind_t));
+    if (*finder == NULL) {
+        ret = LIBFIND_ERR_MALLOC;
+    }
+    else {
+        (*finder)->entry = NULL;
+        (*finder)->query_i = 0;
+        (*finder)->done = false;
+        e_err = query_set_create(&((*finder)->query_set), false, 0, false);
+        if (e_err == EXPR_ERR_NONE) {
+            e_err = query_set_add(&((*finder)->query_set), expr_argv, NULL);
+        }
+        if (e_err == EXPR_ERR_MALLOC) {
+            ret = LIBFIND_ERR_MALLOC;
+        }
+        else if (e_err != EXPR_ERR_NONE) {
+            ret = LIBFIND_ERR_EXPR;
+        }
+        else if (walk_open(&((*finder)->walk), root, \
+                (flags & (LIBFIND_STREAM_DIRS | LIBFIND_INODE_ORDER)) != 0, \
+                NULL) < 0) {
+            ret = LIBFIND_ERR_WALK;
+        }
+        else {
+            (*finder)->walk.inode_order = (flags & LIBFIND_INODE_ORDER) != 0;
+        }
+        if (ret != LIBFIND_ERR_NONE) {
+            query_set_delete(&((*finder)->query_set));
+            free(*finder);
+            *finder = NULL;
+        }
+    }
+    return ret;
+}
+
+/**
+ * Evaluates the queries of finder against its files in turn until one
+ *   matches a file, reading the next file once every query has been
+ *   evaluated against the last. Directories are only evaluated on the way
+ *   down. Once the walk is over, or a query asked to stop it, the query set
+ *   is finished, which writes out the outputs of its actions.
+ * Returns LIBFIND_ERR_NONE on success, LIBFIND_ERR_WALK if reading the tree
+ *   fails and LIBFIND_ERR_FINISH if finishing the queries fails.
+ */
+libfind_err libfind_next(libfind_t *finder, libfind_match *match) {
+    query_set_t *set = &(finder->query_set);
+    query_t *query = NULL;
+    libfind_err ret = LIBFIND_ERR_NONE;
+
+    match->path = NULL;
+    while (!finder->done && match->path == NULL) {
+        if (finder->entry == NULL || finder->query_i >= set->query_c) {
+            errno = 0;
+            finder->entry = set->state_args.quit ? NULL : \
+                walk_read(&(finder->walk));
+            finder->query_i = 0;
+            set->entry_id++;
+            if (finder->entry == NULL) {
+                finder->done = true;
+                if (errno) {
+                    ret = LIBFIND_ERR_WALK;
+                }
+                else if (query_set_finish(set) != EXPR_ERR_NONE) {
+                    ret = LIBFIND_ERR_FINISH;
+                }
+            }
+            else if (finder->entry->fts_info == FTS_DP) {
+                finder->query_i = set->query_c;
+            }
+        }
+        else {
+            query = &(set->queries[finder->query_i]);
+            if (expression_evaluate(&(query->expression), finder->entry, \
+                    set->entry_id) && query->expression.print) {
+                match->path = finder->entry->fts_path;
+                match->st = finder->entry->fts_info == FTS_NS ? NULL : \
+                    finder->entry->fts_statp;
+                match->level = finder->entry->fts_level;
+                match->query = finder->query_i;
+            }
+            finder->query_i++;
+            if (set->state_args.quit) {
+                finder->query_i = set->query_c;
+            }
+        }
+    }
+    return ret;
+}
+
+/**
+ * Pulls every match of finder with libfind_next and passes it to callback,
+ *   stopping early if callback returns false.
+ * Returns LIBFIND_ERR_NONE on success and the error of libfind_next
+ *   otherwise.
+ */
+libfind_err libfind_run(libfind_t *finder, libfind_callback callback, \
+        void *data) {
+    libfind_match match;
+    bool more = true;
+    libfind_err ret = LIBFIND_ERR_NONE;
+
+    while (more && ret == LIBFIND_ERR_NONE) {
+        ret = libfind_next(finder, &match);
+        more = match.path != NULL && callback(&match, data);
+    }
+    return ret;
+}
+
+/**
+ * Closes finder's walk, deletes its queries and frees it.
+ */
+void libfind_close(libfind_t *finder) {
+    walk_close(&(finder->walk));
+    query_set_delete(&(finder->query_set));
+    free(finder);
+}
@@ -0,0 +1,56 @@
+#ifndef __LIBFIND_H
+#define __LIBFIND_H
+#include <stdbool.h>
+#include <sys/stat.h>
+
+// Flags of libfind_open. LIBFIND_STREAM_DIRS streams directories rather than
+//   reading them whole, as --stream-dirs does. LIBFIND_INODE_ORDER also stats
+//   the files of each chunk in inode order, as --inode-order does.
+#define LIBFIND_STREAM_DIRS 0x1
+#define LIBFIND_INODE_ORDER 0x2
+
+typedef struct libfind_s libfind_t;
+typedef struct libfind_match_s libfind_match;
+typedef bool (*libfind_callback)(libfind_match *match, void *data);
+
+// Error defines
+typedef enum libfind_err libfind_err;
+enum libfind_err {
+    LIBFIND_ERR_NONE   = 0,
+    LIBFIND_ERR_MALLOC = 1,
+    LIBFIND_ERR_EXPR   = 2,
+    LIBFIND_ERR_WALK   = 3,
+    LIBFIND_ERR_FINISH = 4
+};
+
+// A file matched by a query: its path, its stat struct, NULL if it couldn't
+//   be stat'd, its depth below the root and the index of the query that
+//   matched it. Valid until the next match is asked for.
+struct libfind_match_s {
+    const char *path;
+    const struct stat *st;
+    int level;
+    int query;
+};
+
+// Compiles the EXPRESSION_SEP separated expressions of the NULL-terminated
+//   expr_argv into queries and opens a traversal of the tree at root for
+//   them. root and expr_argv must be valid until finder is closed.
+//   Allocation of finder is done here. Separate finders may be used on
+//   separate threads at once.
+libfind_err libfind_open(libfind_t **finder, char *root, char **expr_argv, \
+    int flags);
+
+// Pulls the next match of finder into match. match's path is NULL once the
+//   traversal is over.
+libfind_err libfind_next(libfind_t *finder, libfind_match *match);
+
+// Calls callback with every remaining match of finder and data, until it
+//   returns false or the traversal is over.
+libfind_err libfind_run(libfind_t *finder, libfind_callback callback, \
+    void *data);
+
+// Ends the traversal and frees finder.
+void libfind_close(libfind_t *finder);
+
+#endif /* __LIBFIND_H */
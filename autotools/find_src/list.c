@@ -1,53 +1,215 @@
 /**
  * Implementation of an increasing-order linked list for holding path names. 
  *   The increasing-order property is ensured by creating nodes through 
- *   list_create_node and adding them with list_insert_ordered.
+ *   list_create_node and adding them with list_insert_ordered, or by adding
+ *   them in any order and sorting the whole list with list_sort.
+ * Nodes are carved from an arena rather than allocated one by one, and all
+ *   freed together when the list is deleted. A node holds only its file's
+ *   name and the directory it is in. Directories are stored once, each as
+ *   its own name and its parent, so the long prefixes shared by the paths of
+ *   a deep tree aren't repeated. As paths arrive in traversal order, the
+ *   arena keeps the directories of the last one, and a path only adds the
+ *   directories it doesn't share with it. Whole paths are rebuilt only to be
+ *   compared or written out.
  */
 #include "list.h"
 
 /**
- * Creates a node with the given data. path is copied into two strings, one
- *   being an all-lowercase variant for sorting.
- * Returns The new node on success, NULL otherwise.
+ * Initializes arena with no memory, no directories and no paths rebuilt for
+ *   comparisons.
  */
-node* list_create_node(char *path) {
-    node *n;
-    list_err ret = LIST_ERR_NONE; 
+void list_arena_create(list_arena *arena) {
+    arena_create(&(arena->mem));
+    arena->dir_path = NULL;
+    arena->dir_len = 0;
+    arena->dir_path_max = 0;
+    arena->dirs = NULL;
+    arena->dir_c = 0;
+    arena->dir_max = 0;
+    for (int side = 0; side < 2; side++) {
+        arena->order_paths[side] = NULL;
+        arena->order_path_max[side] = 0;
+        arena->order_dirs[side] = NULL;
+        arena->order_dir_len[side] = 0;
+    }
+}
+
+/**
+ * Frees everything carved from arena at once and forgets its directories.
+ *   Paths node_order built for them are forgotten too, as their memory may be
+ *   carved again.
+ */
+void list_arena_reset(list_arena *arena) {
+    arena_reset(&(arena->mem));
+    arena->dir_len = 0;
+    arena->dir_c = 0;
+    arena->order_dirs[0] = NULL;
+    arena->order_dirs[1] = NULL;
+}
+
+/**
+ * Frees all of arena's memory, its stack of directories and the paths it
+ *   rebuilt for comparisons.
+ */
+void list_arena_delete(list_arena *arena) {
+    list_arena_reset(arena);
+    arena_delete(&(arena->mem));
+    free(arena->dir_path);
+    free(arena->dirs);
+    free(arena->order_paths[0]);
+    free(arena->order_paths[1]);
+    list_arena_create(arena);
+}
 
+/**
+ * Gets the directory whose path is the first len bytes of path. The
+ *   directories arena shares with the last one asked for, those whose whole
+ *   name is the same in both paths, are reused, and one is carved for each
+ *   name after them.
+ * Returns the directory on success and NULL if memory allocation fails.
+ */
+list_dir* list_arena_dir(list_arena *arena, char *path, size_t len) {
+    list_dir *ret = NULL, *dir = NULL, **dirs = NULL;
+    char *dir_path = NULL, *end = NULL;
+    size_t same = 0, start = 0, dir_len = 0, path_max = arena->dir_path_max;
+    bool done = false;
+
+    while (same < len && same < arena->dir_len && \
+            path[same] == arena->dir_path[same]) {
+        same++;
+    }
+    while (arena->dir_c > 0 && \
+            ((dir_len = arena->dirs[arena->dir_c - 1]->len) > same || \
+            (dir_len < len && path[dir_len] != '/'))) {
+        arena->dir_c--;
+    }
+    arena->dir_len = same;
+    if (arena->dir_c > 0) {
+        ret = arena->dirs[arena->dir_c - 1];
+        start = ret->len + 1;
+        done = ret->len == len;
+    }
     errno = 0;
-    n = malloc(sizeof(node));
-    if (n != NULL) {
-        ret = node_set_data(n, path);
-        if (ret == LIST_ERR_MALLOC) {
-            free(n);
-            n = NULL;
+    if (!done && len + 1 > path_max) {
+        path_max = path_max == 0 ? LIST_PATH_INIT_MAX : path_max;
+        while (len + 1 > path_max) {
+            path_max *= 2;
+        }
+        dir_path = realloc(arena->dir_path, path_max);
+        if (dir_path == NULL) {
+            ret = NULL;
+            done = true;
+        }
+        else {
+            arena->dir_path = dir_path;
+            arena->dir_path_max = path_max;
         }
     }
-    return n;
+    while (!done) {
+        end = memchr(path + start, '/', len - start);
+        if (end == NULL) {
+            end = path + len;
+        }
+        if (arena->dir_c == arena->dir_max) {
+            dirs = realloc(arena->dirs, sizeof(list_dir*) * \
+                (arena->dir_max == 0 ? LIST_DIRS_INIT_MAX : \
+                arena->dir_max * 2));
+            if (dirs != NULL) {
+                arena->dirs = dirs;
+                arena->dir_max = arena->dir_max == 0 ? LIST_DIRS_INIT_MAX : \
+                    arena->dir_max * 2;
+            }
+        }
+        dir = arena->dir_c < arena->dir_max ? arena_alloc(&(arena->mem), \
+            sizeof(list_dir) + (end - path - start) + 1) : NULL;
+        if (dir == NULL) {
+            ret = NULL;
+            done = true;
+        }
+        else {
+            dir->parent = ret;
+            dir->len = end - path;
+            dir->name_len = end - path - start;
+            memcpy(dir->name, path + start, dir->name_len);
+            dir->name[dir->name_len] = '\0';
+            arena->dirs[arena->dir_c++] = dir;
+            ret = dir;
+            start = dir->len + 1;
+            if (dir->len == len) {
+                memcpy(arena->dir_path + same, path + same, len - same);
+                arena->dir_len = len;
+                done = true;
+            }
+        }
+    }
+    return ret;
 }
 
 /**
- * Fills n's data field, handling allocation and copying of path into
- *   data.path and data.path_lower.
- * Returns LIST_ERR_NONE on success, LIST_ERR_MALLOC if malloc fails.
+ * Creates a node for path in arena. A path with a '/' is split after the
+ *   last one into the directory it is in, which is shared with other nodes,
+ *   and its name, which is copied right after the node. One without is kept
+ *   whole as the name.
+ * Returns The new node on success, NULL otherwise.
  */
-list_err node_set_data(node *n, char *path) {
-    list_err ret = LIST_ERR_NONE;
+node* list_create_node(list_arena *arena, char *path) {
+    char *name = strrchr(path, '/');
+    list_dir *dir = NULL;
+    node *n = NULL;
+    size_t name_len = 0;
 
-    errno = 0;
-    n->data.path = malloc(strlen(path) + 1);
-    if (n->data.path == NULL && errno) {
-        ret = LIST_ERR_MALLOC;
+    name = name != NULL ? name + 1 : path;
+    name_len = strlen(name);
+    if (name == path || \
+            (dir = list_arena_dir(arena, path, name - path - 1)) != NULL) {
+        n = arena_alloc(&(arena->mem), sizeof(node) + name_len + 1);
     }
-    else {
-        strncpy(n->data.path, path, strlen(path) + 1);
+    if (n != NULL) {
+        n->data.dir = dir;
+        n->data.name = (char*)(n + 1);
+        memcpy(n->data.name, name, name_len + 1);
+        n->data.tag = NULL;
+        n->data.term = '\n';
+        n->data.record = NULL;
+        n->data.record_len = 0;
+        n->next = NULL;
+    }
+    return n;
+}
+
+/**
+ * Rebuilds the path of n into buf from the end, its name after each
+ *   directory's from the innermost out, joined by '/'. buf is grown if it
+ *   can't hold the path.
+ * Returns 0 on success and -1 if memory allocation fails.
+ */
+int node_path(node *n, char **buf, size_t *buf_max, size_t *len) {
+    list_dir *dir = n->data.dir;
+    char *path = NULL;
+    size_t name_len = strlen(n->data.name), max = *buf_max;
+    int ret = 0;
 
-        ret = lower_string_cpy(&(n->data.path_lower), path);
-        if (ret == LIST_ERR_MALLOC) {
-            free(n->data.path);
+    *len = (dir != NULL ? dir->len + 1 : 0) + name_len;
+    if (*len + 1 > max) {
+        max = max == 0 ? LIST_PATH_INIT_MAX : max;
+        while (*len + 1 > max) {
+            max *= 2;
+        }
+        errno = 0;
+        path = realloc(*buf, max);
+        if (path == NULL) {
+            ret = -1;
         }
         else {
-            n->next = NULL;
+            *buf = path;
+            *buf_max = max;
+        }
+    }
+    if (ret == 0) {
+        memcpy(*buf + *len - name_len, n->data.name, name_len + 1);
+        for (; dir != NULL; dir = dir->parent) {
+            (*buf)[dir->len] = '/';
+            memcpy(*buf + dir->len - dir->name_len, dir->name, dir->name_len);
         }
     }
     return ret;
@@ -60,7 +222,7 @@ list_err node_set_data(node *n, char *path) {
  *   exists in the list, though in that case the duplicate entry still will be
  *   stored.
  */
-list_err list_insert_ordered(list *l, node *n) {
+list_err list_insert_ordered(list *l, node *n, list_arena *arena) {
     node *curr = NULL;
     list_err ret = LIST_ERR_NONE; 
     int ord = 0;
@@ -70,16 +232,16 @@ list_err list_insert_ordered(list *l, node *n) {
         *l = n;
         ret = LIST_ERR_NONE;
     }
-    else if (node_order(n, *l) < 0) {
+    else if (node_order(n, *l, arena) < 0) {
         n->next = *l;
         *l = n;
     }
     else {
         curr = *l;
-        ord = node_order(n, curr->next);
+        ord = node_order(n, curr->next, arena);
         while (ord > 0) {
             curr = curr->next;
-            ord = node_order(n, curr->next);
+            ord = node_order(n, curr->next, arena);
         }
         if (ord == 0) {
             ret = LIST_ERR_DUP_ENTRY;
@@ -91,38 +253,87 @@ list_err list_insert_ordered(list *l, node *n) {
 }
 
 /**
- * Deletes all nodes of l and points l to NULL.
+ * Sorts l with a bottom-up merge sort, merging sorted sublists of doubling
+ *   length kept in bins, where bin i holds a sublist of 2^i nodes. This takes
+ *   O(n log n) comparisons and no memory beyond the bins, where inserting each
+ *   node in order would take O(n^2). Bins always hold nodes that came earlier
+ *   in l, so merges keep equal nodes in their original order.
  */
-void list_delete(list *l) {
+void list_sort(list *l, list_arena *arena) {
+    node *bins[sizeof(size_t) * 8] = {NULL};
     node *curr = NULL, *next = NULL;
+    int bin_c = 0, i = 0;
 
     assert(l != NULL);
     curr = *l;
     while (curr != NULL) {
         next = curr->next;
-        node_delete(curr);
+        curr->next = NULL;
+        for (i = 0; i < bin_c && bins[i] != NULL; i++) {
+            curr = list_merge(bins[i], curr, arena);
+            bins[i] = NULL;
+        }
+        if (i == bin_c) {
+            bin_c++;
+        }
+        bins[i] = curr;
         curr = next;
     }
-    *l = NULL;
+    for (i = 0; i < bin_c; i++) {
+        curr = list_merge(bins[i], curr, arena);
+    }
+    *l = curr;
+}
+
+/**
+ * Merges the sorted lists l1 and l2, taking from l1 first when nodes are
+ *   equal.
+ * Returns the head of the merged list.
+ */
+node* list_merge(node *l1, node *l2, list_arena *arena) {
+    node head, *tail = &head;
+
+    while (l1 != NULL && l2 != NULL) {
+        if (node_order(l1, l2, arena) <= 0) {
+            tail->next = l1;
+            l1 = l1->next;
+        }
+        else {
+            tail->next = l2;
+            l2 = l2->next;
+        }
+        tail = tail->next;
+    }
+    tail->next = l1 != NULL ? l1 : l2;
+    return head.next;
 }
 
 /**
- * Deletes n and all its entries.
+ * Drops every node of l by resetting arena, which they were all created in,
+ *   and points l to NULL.
  */
-void node_delete(node *n) {
-    free(n->data.path);
-    free(n->data.path_lower);
-    free(n);
+void list_delete(list *l, list_arena *arena) {
+    assert(l != NULL);
+    list_arena_reset(arena);
+    *l = NULL;
 }
 
 /**
  * Compares order between two nodes. NULL is defined to have greater order 
  *   than any other node so the increasing-order list invariant is preserved
- *   in all cases.
+ *   in all cases. Paths are compared ignoring case first, then as they are.
+ *   Nodes in the same directory share everything up to their names, so only
+ *   the names are compared. Otherwise both paths are rebuilt in arena's
+ *   buffers, unless one can't be, in which case only the names are compared.
+ * find never sets a locale, so comparing bytes orders paths as strcoll
+ *   would.
  * Returns >0 if n1 > n2, <0 if n1 < n2, and 0 if n1 == n2.
  */
-int node_order(node *n1, node *n2) {
+int node_order(node *n1, node *n2, list_arena *arena) {
+    char *path1 = NULL, *path2 = NULL;
     int ret = 0;
+
+    find_stats.compares++;
     if (n1 == NULL || n2 == NULL) {
         if (n1 == NULL) {
             ret++;
@@ -132,30 +343,65 @@ int node_order(node *n1, node *n2) {
         }
     }
     else {
-        ret = strcoll(n1->data.path_lower, n2->data.path_lower);
+        path1 = n1->data.name;
+        path2 = n2->data.name;
+        if (n1->data.dir != n2->data.dir && \
+                node_order_path(n1, arena, 0, &path1) == 0) {
+            if (node_order_path(n2, arena, 1, &path2) < 0) {
+                path1 = n1->data.name;
+            }
+        }
+        ret = compare_lower(path1, path2);
         if (ret == 0) {
-            ret = strcoll(n1->data.path, n2->data.path);
+            ret = strcmp(path1, path2);
         }
     }
     return ret;
 }
 
 /**
- * Puts a lowercase copy of src into the string pointed at by dest.
- * Returns LIST_ERR_NONE on success, LIST_ERR_MALLOC if malloc fails.
+ * Rebuilds the path of n into arena's buffer for side of a comparison. If the
+ *   buffer already holds the path of n's directory, only the name is copied.
+ * Returns 0 on success, with path pointing to the buffer, and -1 if memory
+ *   allocation fails.
  */
-list_err lower_string_cpy(char** dest, char *src) {
-    list_err ret = LIST_ERR_NONE;
+int node_order_path(node *n, list_arena *arena, int side, char **path) {
+    list_dir *dir = n->data.dir;
+    size_t len = 0, name_len = 0;
+    int ret = 0;
 
-    errno = 0;
-    *dest = malloc(strlen(src) + 1);
-    if (*dest == NULL && errno) {
-        ret = LIST_ERR_MALLOC;
+    if (dir != NULL && dir == arena->order_dirs[side] && \
+            arena->order_dir_len[side] + (name_len = strlen(n->data.name)) + \
+            1 < arena->order_path_max[side]) {
+        memcpy(arena->order_paths[side] + arena->order_dir_len[side], \
+            n->data.name, name_len + 1);
+    }
+    else if (node_path(n, &(arena->order_paths[side]), \
+            &(arena->order_path_max[side]), &len) < 0) {
+        arena->order_dirs[side] = NULL;
+        ret = -1;
     }
     else {
-        for (int i = 0; i < strlen(src) + 1; i++) {
-            (*dest)[i] = tolower(src[i]);
-        }
+        arena->order_dirs[side] = dir;
+        arena->order_dir_len[side] = dir != NULL ? dir->len + 1 : 0;
+    }
+    if (ret == 0) {
+        *path = arena->order_paths[side];
     }
     return ret;
 }
+
+/**
+ * Compares s1 and s2 as if both were lowercase.
+ * Returns >0 if s1 > s2, <0 if s1 < s2, and 0 if they are equal.
+ */
+int compare_lower(const char *s1, const char *s2) {
+    const unsigned char *c1 = (const unsigned char*)s1;
+    const unsigned char *c2 = (const unsigned char*)s2;
+
+    while (*c1 != '\0' && tolower(*c1) == tolower(*c2)) {
+        c1++;
+        c2++;
+    }
+    return tolower(*c1) - tolower(*c2);
+}
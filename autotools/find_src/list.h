@@ -6,13 +6,40 @@
 #include <stdlib.h>
 #include <errno.h>
 #include <assert.h>
+#include <stdbool.h>
+#include "stats.h"
+#include "../common_src/arena.h"
+
+// Initial bytes of a path being built, and directories on an arena's stack
+#define LIST_PATH_INIT_MAX 256
+#define LIST_DIRS_INIT_MAX 16
 
 typedef struct node_s node;
 typedef node* list;
+typedef struct list_dir_s list_dir;
+typedef struct list_arena_s list_arena;
+
+// A directory some listed paths are in, stored once for all of them as its
+//   name and the directory it is in, NULL at the top. len is the length of
+//   its whole path.
+struct list_dir_s {
+    list_dir *parent;
+    size_t len;
+    size_t name_len;
+    char name[];
+};
 
 struct data_s {
-    char *path;
-    char *path_lower;
+    // The path is name in dir, or just name if dir is NULL.
+    list_dir *dir;
+    char *name;
+    // Printed before path if not NULL. Not owned by the list.
+    const char *tag;
+    // Printed after path.
+    char term;
+    // If not NULL, printed instead of the tag, path and term.
+    char *record;
+    size_t record_len;
 };
 
 struct node_s {
@@ -20,6 +47,27 @@ struct node_s {
     node *next;
 };
 
+// Memory for the nodes, names and records of a list, carved from mem and
+//   freed all at once. The directories of the last path added are kept as a
+//   stack, with their path, so a path in the same directory, or one below it,
+//   only adds what is new. order_paths are the paths node_order rebuilds for
+//   each side of a comparison, and order_dirs the directory each was last
+//   built for, so nodes in the same directory only copy their name.
+struct list_arena_s {
+    arena_t mem;
+    char *dir_path;
+    size_t dir_len;
+    size_t dir_path_max;
+    list_dir **dirs;
+    int dir_c;
+    int dir_max;
+
+    char *order_paths[2];
+    size_t order_path_max[2];
+    list_dir *order_dirs[2];
+    size_t order_dir_len[2];
+};
+
 // Error defines
 typedef enum list_err list_err;
 enum list_err {
@@ -28,31 +76,52 @@ enum list_err {
     LIST_ERR_DUP_ENTRY = 2
 };
 
-// Creates a new node with data specified by f_name and f_stat. The user must
-//   ensure f_stat is a valid reference for the entire life of the list.
-node* list_create_node(char *path);
+// Initializes an empty arena. arena must already be allocated.
+void list_arena_create(list_arena *arena);
 
-// Sets the given data in n.
-list_err node_set_data(node *n, char *path);
+// Frees everything carved from arena at once, keeping its first chunk.
+void list_arena_reset(list_arena *arena);
 
-// Inserts n into l while preserving increasing order of l.
+// Frees all of arena's memory.
+void list_arena_delete(list_arena *arena);
+
+// Helper for list_create_node
+list_dir* list_arena_dir(list_arena *arena, char *path, size_t len);
+
+// Creates a new node for path in arena, storing only the parts of its
+//   directory's path that the arena doesn't have yet.
+node* list_create_node(list_arena *arena, char *path);
+
+// Builds the whole path of n into buf, growing it as needed, and sets len to
+//   its length.
+int node_path(node *n, char **buf, size_t *buf_max, size_t *len);
+
+// Inserts n into l while preserving increasing order of l. n must have been
+//   created in arena, like every node of l.
 // If adding the first element of an empty list, that list must be initialized
 //   and point at NULL.
 // If nodes are added to l by any other means than this function, then 
 //   list_insert_ordered has undefined behavior.
-list_err list_insert_ordered(list *l, node *n);
+list_err list_insert_ordered(list *l, node *n, list_arena *arena);
+
+// Sorts l, whose nodes were created in arena, into increasing order. Nodes
+//   that are equal keep their order in l.
+void list_sort(list *l, list_arena *arena);
 
-// Deletes l and points it to NULL. The user must not be holding any references
-//   to data internal to this list after it is deleted.
-void list_delete(list *l);
+// Helper for list_sort
+node* list_merge(node *l1, node *l2, list_arena *arena);
 
-// Deletes n and all its entries.
-void node_delete(node *n);
+// Deletes l, resetting the arena its nodes were created in, and points it to
+//   NULL. The user must not be holding any references to data internal to
+//   this list after it is deleted.
+void list_delete(list *l, list_arena *arena);
 
-// Determines order between two nodes.
-int node_order(node *n1, node *n2);
+// Determines order between two nodes, rebuilding their paths in arena's
+//   buffers when they aren't in the same directory.
+int node_order(node *n1, node *n2, list_arena *arena);
 
-// Puts a lowercase copy of src into the string pointed at by dest.
-list_err lower_string_cpy(char** dest, char *src);
+// Helpers for node_order
+int node_order_path(node *n, list_arena *arena, int side, char **path);
+int compare_lower(const char *s1, const char *s2);
 
-#endif /* __LIST_H */
\ No newline at end of file
+#endif /* __LIST_H */
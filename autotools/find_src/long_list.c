@@ -0,0 +1,113 @@
+/**
+ * The -ls action, which prints each file it reaches in the long format of ls,
+ *   preceded by its inode number and size in kilobyte blocks like ls -lis:
+ *     inode blocks mode links user group size date path [-> target]
+ * The mode string, date and owner names are formatted by the same code as
+ *   ls -l, with the owner names and dates cached across files. Each line is
+ *   rendered straight into the output's buffer, with no allocation per file.
+ */
+#include "long_list.h"
+
+/**
+ * Initializes long_list with empty caches and no output.
+ */
+void long_list_create(long_list_t *long_list) {
+    long_fmt_init(&(long_list->fmt));
+    long_list->out = NULL;
+}
+
+/**
+ * Renders the -ls line of entry into space reserved in long_list's output, and
+ *   adds it under entry's path. The target of a symbolic link is read straight
+ *   into the line, from the archive's header for a member of a tar archive,
+ *   whose entry points to the archive with fts_pointer. Failures are recorded in the output, as evaluation has no
+ *   way to report them.
+ * Always returns true.
+ */
+bool long_list_evaluate(long_list_t *long_list, FTSENT *entry) {
+    struct stat *f_stat = entry->fts_statp;
+    const char *usr = NULL, *grp = NULL, *mtim = NULL;
+    size_t usr_len = 0, grp_len = 0;
+    char *start = NULL, *write = NULL;
+    ssize_t link_len = 0;
+
+    usr = long_fmt_usr(&(long_list->fmt), f_stat->st_uid, &usr_len);
+    grp = long_fmt_grp(&(long_list->fmt), f_stat->st_gid, &grp_len);
+    mtim = long_fmt_mtim(&(long_list->fmt), f_stat->st_mtime);
+    start = output_reserve(long_list->out, 4 * FORMAT_INT_MAX + \
+        MODE_STR_LEN + usr_len + grp_len + 2 * LONG_LIST_NAME_WIDTH + \
+        DATE_STR_LEN + entry->fts_pathlen + sizeof(LONG_LIST_LINK_SEP) + \
+        PATH_MAX + 8);
+    if (start != NULL) {
+        write = long_list_uint(start, f_stat->st_ino, LONG_LIST_INO_WIDTH);
+        *(write++) = ' ';
+        write = long_list_uint(write, (f_stat->st_blocks * \
+            LONG_LIST_STAT_BLOCK + LONG_LIST_BLOCK - 1) / LONG_LIST_BLOCK, \
+            LONG_LIST_BLOCKS_WIDTH);
+        *(write++) = ' ';
+        parse_mode_str(write, f_stat->st_mode);
+        write += MODE_STR_LEN - 1;
+        *(write++) = ' ';
+        write = long_list_uint(write, f_stat->st_nlink, \
+            LONG_LIST_NLINK_WIDTH);
+        *(write++) = ' ';
+        write = long_list_name(write, usr, usr_len, LONG_LIST_NAME_WIDTH);
+        *(write++) = ' ';
+        write = long_list_name(write, grp, grp_len, LONG_LIST_NAME_WIDTH);
+        *(write++) = ' ';
+        write = long_list_uint(write, f_stat->st_size, LONG_LIST_SIZE_WIDTH);
+        *(write++) = ' ';
+        if (mtim != NULL) {
+            write = long_list_name(write, mtim, DATE_STR_LEN - 1, 0);
+            *(write++) = ' ';
+        }
+        memcpy(write, entry->fts_path, entry->fts_pathlen);
+        write += entry->fts_pathlen;
+        if (S_ISLNK(f_stat->st_mode)) {
+            memcpy(write, LONG_LIST_LINK_SEP, sizeof(LONG_LIST_LINK_SEP) - 1);
+            if (entry->fts_pointer != NULL) {
+                link_len = tar_readlink(entry->fts_pointer, write + \
+                    sizeof(LONG_LIST_LINK_SEP) - 1, PATH_MAX);
+            }
+            else {
+                link_len = readlink(entry->fts_path, write + \
+                    sizeof(LONG_LIST_LINK_SEP) - 1, PATH_MAX);
+            }
+            if (link_len > 0) {
+                write += sizeof(LONG_LIST_LINK_SEP) - 1 + link_len;
+            }
+        }
+        *(write++) = '\n';
+        output_commit(long_list->out, entry->fts_path, write - start);
+    }
+    return true;
+}
+
+/**
+ * Writes val to dest in decimal, right-aligned in a field of width.
+ * Returns the position in dest after the field.
+ */
+char* long_list_uint(char *dest, unsigned long long val, int width) {
+    char digits[FORMAT_INT_MAX];
+    int len = format_uint(digits, val) - digits;
+
+    while (len < width--) {
+        *(dest++) = ' ';
+    }
+    memcpy(dest, digits, len);
+    return dest + len;
+}
+
+/**
+ * Writes the len characters of name to dest, left-aligned in a field of width.
+ * Returns the position in dest after the field.
+ */
+char* long_list_name(char *dest, const char *name, size_t len, int width) {
+    memcpy(dest, name, len);
+    dest += len;
+    while ((int)len < width) {
+        *(dest++) = ' ';
+        len++;
+    }
+    return dest;
+}
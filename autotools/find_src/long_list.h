@@ -0,0 +1,47 @@
+#ifndef __LONG_LIST_H
+#define __LONG_LIST_H
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <fts.h>
+#include "output.h"
+#include "format.h"
+#include "tar.h"
+#include "../common_src/long_fmt.h"
+
+// Minimum widths of the fields of a -ls line. Fields are padded to these
+//   rather than to the widest value, as lines are written as files are found.
+#define LONG_LIST_INO_WIDTH 9
+#define LONG_LIST_BLOCKS_WIDTH 6
+#define LONG_LIST_NLINK_WIDTH 3
+#define LONG_LIST_NAME_WIDTH 8
+#define LONG_LIST_SIZE_WIDTH 8
+// Separates a symbolic link from its target
+#define LONG_LIST_LINK_SEP " -> "
+// Size of the blocks counted by st_blocks, and of those printed
+#define LONG_LIST_STAT_BLOCK 512
+#define LONG_LIST_BLOCK 1024
+
+typedef struct long_list_s long_list_t;
+
+// The state of a -ls action: the output its lines are rendered into and the
+//   caches used to render them. out is only set once the expression is part
+//   of a query set.
+struct long_list_s {
+    long_fmt_t fmt;
+    struct output_s *out;
+};
+
+// Initializes long_list. long_list must already be allocated.
+void long_list_create(long_list_t *long_list);
+
+// Renders a -ls line for entry into long_list's output.
+bool long_list_evaluate(long_list_t *long_list, FTSENT *entry);
+
+// Helpers for long_list_evaluate
+char* long_list_uint(char *dest, unsigned long long val, int width);
+char* long_list_name(char *dest, const char *name, size_t len, int width);
+
+#endif /* __LONG_LIST_H */
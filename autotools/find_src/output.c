@@ -0,0 +1,964 @@
+/**
+ * Outputs for matched paths. Every query writes to one of these, either stdout
+ *   or a file named by -fprint. Queries naming the same file share a single
+ *   output. Paths are collected in an increasing-order list and only written
+ *   once the file tree has been fully traversed, unless the output streams, in
+ *   which case they are written in the order they are found. Instead of a
+ *   path, an entry can be a record rendered by the caller, such as a -printf
+ *   line, which is still ordered by its file's path. Paths are kept in the
+ *   order they are found and sorted once, when they are written.
+ * Given a memory budget, a sorted output spills its paths to a temporary file
+ *   as a sorted run whenever they reach it, and when flushed merges the runs
+ *   with the paths still in memory, smallest first, straight into its buffer.
+ *   At most OUTPUT_MERGE_MAX runs are kept, so when another is needed they
+ *   are first all merged into one. Ties go to the earlier run, so equal paths
+ *   are written in the order they were found, as when nothing is spilled.
+ * For a checkpoint, everything a sorted output holds is merged into one run
+ *   that is kept under the checkpoint's path instead of being unlinked, so a
+ *   restarted find can pick the run back up. Only one kept run is live at a
+ *   time, and once merged away it is only removed when a newer checkpoint no
+ *   longer names it.
+ * Either way, records are copied into one large buffer and written with a
+ *   single write(2) once it fills, instead of going through stdio for every
+ *   path. A record too large for the buffer is written together with it by
+ *   writev(2). A streaming output also writes its buffer once the oldest record
+ *   in it has waited OUTPUT_DEADLINE_MS, so a slow traversal still shows its
+ *   matches promptly.
+ */
+#include "output.h"
+#include "../common_src/trace.h"
+
+/**
+ * Allocates out and its buffer and opens path for writing, truncating it
+ *   unless out streams and append is true. If path is NULL the output is
+ *   stdout instead. No runs are allocated until sort_memory is first reached.
+ * Returns OUTPUT_ERR_NONE on success, OUTPUT_ERR_MALLOC if memory allocation
+ *   fails and OUTPUT_ERR_OPEN if path can't be opened.
+ */
+output_err output_open(output_t **out, char *path, bool stream, \
+        size_t sort_memory, bool append) {
+    output_err ret = OUTPUT_ERR_NONE;
+
+    errno = 0;
+    *out = malloc(sizeof(output_t));
+    if (*out == NULL) {
+        ret = OUTPUT_ERR_MALLOC;
+    }
+    else {
+        (*out)->path = path;
+        (*out)->path_list = NULL;
+        (*out)->path_last = NULL;
+        list_arena_create(&((*out)->arena));
+        (*out)->list_bytes = 0;
+        (*out)->sort_memory = sort_memory;
+        (*out)->runs = NULL;
+        (*out)->run_c = 0;
+        (*out)->run_prefix = NULL;
+        (*out)->dead = NULL;
+        (*out)->stream = stream;
+        (*out)->buf_len = 0;
+        (*out)->buf_max = OUTPUT_BUF_SIZE;
+        (*out)->path_buf = NULL;
+        (*out)->path_buf_max = 0;
+        (*out)->err = OUTPUT_ERR_NONE;
+        (*out)->next = NULL;
+        errno = 0;
+        (*out)->buf = malloc(OUTPUT_BUF_SIZE);
+        if ((*out)->buf == NULL) {
+            ret = OUTPUT_ERR_MALLOC;
+        }
+        else if (path == NULL) {
+            (*out)->fd = STDOUT_FILENO;
+        }
+        else {
+            errno = 0;
+            (*out)->fd = open(path, O_WRONLY | O_CREAT | \
+                (stream && append ? O_APPEND : O_TRUNC), 0666);
+            if ((*out)->fd < 0) {
+                ret = OUTPUT_ERR_OPEN;
+            }
+        }
+        if (ret != OUTPUT_ERR_NONE) {
+            free((*out)->buf);
+            free(*out);
+            *out = NULL;
+        }
+    }
+    return ret;
+}
+
+/**
+ * Adds path to out, to be printed after tag if it is not NULL and ended with
+ *   term. A streaming output copies it straight into its buffer, otherwise a
+ *   copy is kept in out's list of paths, which may spill it. Failure is also
+ *   recorded in out so callers that can't report it can leave it to
+ *   output_flush.
+ * Returns OUTPUT_ERR_NONE on success, OUTPUT_ERR_MALLOC if memory allocation
+ *   fails and OUTPUT_ERR_WRITE if writing the buffer or spilling fails.
+ */
+output_err output_add(output_t *out, char *path, const char *tag, char term) {
+    node *n = NULL;
+    output_err ret = OUTPUT_ERR_NONE;
+
+    if (out->stream) {
+        ret = output_append(out, tag, path, term);
+        if (ret == OUTPUT_ERR_NONE) {
+            ret = output_poll(out);
+        }
+    }
+    else {
+        n = list_create_node(&(out->arena), path);
+        if (n == NULL) {
+            ret = OUTPUT_ERR_MALLOC;
+        }
+        else {
+            n->data.tag = tag;
+            n->data.term = term;
+            ret = output_keep(out, n);
+        }
+    }
+    if (ret != OUTPUT_ERR_NONE && out->err == OUTPUT_ERR_NONE) {
+        out->err = ret;
+    }
+    return ret;
+}
+
+/**
+ * Makes room for a record of up to max bytes, for callers that render records
+ *   themselves. A streaming output gives the unused end of its buffer,
+ *   writing the buffer first if there isn't enough left, so records are
+ *   rendered in place. Otherwise the buffer is empty until out is flushed, so
+ *   its start is used as scratch space. The buffer is grown if max is larger
+ *   than it.
+ * Returns where to write the record, or NULL if memory allocation fails, in
+ *   which case the failure is also recorded in out.
+ */
+char* output_reserve(output_t *out, size_t max) {
+    char *buf = NULL, *ret = NULL;
+
+    if (out->stream && out->buf_len + max > out->buf_max) {
+        output_write_buf(out);
+    }
+    if (max > out->buf_max) {
+        errno = 0;
+        buf = realloc(out->buf, max);
+        if (buf == NULL) {
+            if (out->err == OUTPUT_ERR_NONE) {
+                out->err = OUTPUT_ERR_MALLOC;
+            }
+        }
+        else {
+            out->buf = buf;
+            out->buf_max = max;
+        }
+    }
+    if (max <= out->buf_max) {
+        ret = out->buf + (out->stream ? out->buf_len : 0);
+    }
+    return ret;
+}
+
+/**
+ * Adds the len bytes written to the room given by output_reserve as a record
+ *   of out. A streaming output only has to count them as part of its buffer.
+ *   Otherwise they are copied into a new entry in out's list, to be ordered by
+ *   path, carved from out's arena along with it. Failure is also recorded in
+ *   out.
+ * Returns OUTPUT_ERR_NONE on success, OUTPUT_ERR_MALLOC if memory allocation
+ *   fails and OUTPUT_ERR_WRITE if writing the buffer or spilling fails.
+ */
+output_err output_commit(output_t *out, char *path, size_t len) {
+    node *n = NULL;
+    output_err ret = OUTPUT_ERR_NONE;
+
+    if (out->stream) {
+        if (out->buf_len == 0) {
+            clock_gettime(CLOCK_MONOTONIC, &(out->buf_since));
+        }
+        out->buf_len += len;
+        ret = output_poll(out);
+    }
+    else {
+        n = list_create_node(&(out->arena), path);
+        if (n == NULL || \
+                (n->data.record = arena_alloc(&(out->arena.mem), len + 1)) \
+                == NULL) {
+            ret = OUTPUT_ERR_MALLOC;
+        }
+        else {
+            memcpy(n->data.record, out->buf, len);
+            n->data.record_len = len;
+            ret = output_keep(out, n);
+        }
+    }
+    if (ret != OUTPUT_ERR_NONE && out->err == OUTPUT_ERR_NONE) {
+        out->err = ret;
+    }
+    return ret;
+}
+
+/**
+ * Writes the buffer of a streaming output if it has held a record for at
+ *   least OUTPUT_DEADLINE_MS. The time is only read if there is something
+ *   buffered.
+ * Returns OUTPUT_ERR_NONE on success and OUTPUT_ERR_WRITE if writing fails.
+ */
+output_err output_poll(output_t *out) {
+    struct timespec now;
+    long waited = 0;
+    output_err ret = OUTPUT_ERR_NONE;
+
+    if (out->stream && out->buf_len > 0 && \
+            clock_gettime(CLOCK_MONOTONIC, &now) == 0) {
+        waited = (now.tv_sec - out->buf_since.tv_sec) * MSEC_PER_SEC + \
+            (now.tv_nsec - out->buf_since.tv_nsec) / NSEC_PER_MSEC;
+        if (waited >= OUTPUT_DEADLINE_MS) {
+            ret = output_write_buf(out);
+        }
+    }
+    return ret;
+}
+
+/**
+ * Writes the buffer of out and of every output after it in its list that
+ *   streams, whatever their deadlines, so a process started next writes after
+ *   the paths already found.
+ * Returns OUTPUT_ERR_NONE on success and the first error writing a buffer
+ *   otherwise.
+ */
+output_err output_drain(output_t *out) {
+    output_err ret = OUTPUT_ERR_NONE;
+
+    for (output_t *curr = out; curr != NULL; curr = curr->next) {
+        if (curr->stream && output_write_buf(curr) != OUTPUT_ERR_NONE && \
+                ret == OUTPUT_ERR_NONE) {
+            ret = OUTPUT_ERR_WRITE;
+        }
+    }
+    return ret;
+}
+
+/**
+ * Sorts out's list and writes every path in it to its file, merging it with
+ *   any spilled runs, and empties the list. Then writes whatever is left in
+ *   out's buffer. Tagged paths are preceded by their tag and OUTPUT_TAG_SEP.
+ * Returns OUTPUT_ERR_NONE on success, the recorded error if a path was dropped
+ *   or a write failed while paths were added, and OUTPUT_ERR_WRITE if writing
+ *   or reading back a run fails now.
+ */
+output_err output_flush(output_t *out) {
+    struct timespec start;
+    node *curr = NULL;
+    output_err ret = OUTPUT_ERR_NONE;
+
+    TRACE1(find, sort_start, out->list_bytes);
+    stats_begin(&start);
+    list_sort(&(out->path_list), &(out->arena));
+    stats_end(STATS_SORT, &start);
+    TRACE0(find, sort_done);
+    if (out->run_c > 0) {
+        ret = output_merge(out, NULL);
+    }
+    curr = out->path_list;
+    while (curr != NULL && ret == OUTPUT_ERR_NONE) {
+        ret = output_append_node(out, curr);
+        curr = curr->next;
+    }
+    if (ret == OUTPUT_ERR_NONE) {
+        ret = output_write_buf(out);
+    }
+    if (ret == OUTPUT_ERR_NONE) {
+        ret = out->err;
+    }
+    list_delete(&(out->path_list), &(out->arena));
+    out->path_last = NULL;
+    out->list_bytes = 0;
+    return ret;
+}
+
+/**
+ * Writes what out holds so a restarted find can take it back, followed by the
+ *   number of runs out holds and the path of each, '\0'-terminated. A
+ *   streaming output writes its buffer out, as its paths are only appended
+ *   to its file. A sorting output with paths in its list or in unlinked runs
+ *   spills them all into one run kept at a path starting with prefix, which
+ *   is left as its only run.
+ * Returns OUTPUT_ERR_NONE on success, OUTPUT_ERR_MALLOC if memory allocation
+ *   fails and OUTPUT_ERR_WRITE if writing out, spilling or writing to file
+ *   fails.
+ */
+output_err output_checkpoint(output_t *out, char *prefix, FILE *file) {
+    bool unlinked = false;
+    output_err ret = OUTPUT_ERR_NONE;
+
+    out->run_prefix = prefix;
+    for (int i = 0; i < out->run_c; i++) {
+        if (out->runs[i].path == NULL) {
+            unlinked = true;
+        }
+    }
+    if (out->stream) {
+        ret = output_write_buf(out);
+    }
+    else if (out->path_list != NULL || unlinked) {
+        ret = output_spill(out, true);
+    }
+    if (ret == OUTPUT_ERR_NONE) {
+        fprintf(file, "%d\n", out->run_c);
+        for (int i = 0; i < out->run_c; i++) {
+            fputs(out->runs[i].path, file);
+            fputc('\0', file);
+        }
+        if (ferror(file)) {
+            ret = OUTPUT_ERR_WRITE;
+        }
+    }
+    return ret;
+}
+
+/**
+ * Reopens the runs named in file by output_checkpoint as runs of out, reading
+ *   the first record of each.
+ * Returns OUTPUT_ERR_NONE on success, OUTPUT_ERR_MALLOC if memory allocation
+ *   fails and OUTPUT_ERR_OPEN if file is invalid or a run can't be read.
+ */
+output_err output_restore(output_t *out, FILE *file) {
+    output_run *run = NULL;
+    char *line = NULL;
+    size_t line_max = 0;
+    int run_c = 0;
+    output_err ret = OUTPUT_ERR_NONE;
+
+    errno = 0;
+    if (getline(&line, &line_max, file) < 0 || \
+            sscanf(line, "%d", &run_c) != 1 || run_c < 0 || \
+            run_c > OUTPUT_MERGE_MAX) {
+        ret = OUTPUT_ERR_OPEN;
+    }
+    else if (run_c > 0 && out->runs == NULL) {
+        errno = 0;
+        out->runs = malloc(sizeof(output_run) * (OUTPUT_MERGE_MAX + 1));
+        if (out->runs == NULL) {
+            ret = OUTPUT_ERR_MALLOC;
+        }
+    }
+    for (int i = 0; i < run_c && ret == OUTPUT_ERR_NONE; i++) {
+        run = &(out->runs[out->run_c]);
+        run->head = NULL;
+        run->buf = NULL;
+        run->buf_max = 0;
+        errno = 0;
+        if (getdelim(&line, &line_max, '\0', file) < 0) {
+            ret = OUTPUT_ERR_OPEN;
+        }
+        else if ((run->path = strdup(line)) == NULL) {
+            ret = OUTPUT_ERR_MALLOC;
+        }
+        else if ((run->file = fopen(line, "r")) == NULL || \
+                run_next(run) < 0) {
+            if (run->file != NULL) {
+                fclose(run->file);
+            }
+            free(run->path);
+            free(run->buf);
+            ret = OUTPUT_ERR_OPEN;
+        }
+        else {
+            out->run_c++;
+        }
+    }
+    free(line);
+    return ret;
+}
+
+/**
+ * Unlinks and forgets the kept run of out merged away since the last
+ *   checkpoint, if any.
+ */
+void output_forget(output_t *out) {
+    if (out->dead != NULL) {
+        unlink(out->dead);
+        free(out->dead);
+        out->dead = NULL;
+    }
+}
+
+/**
+ * Reads the runs named in file by output_checkpoint for a single output and
+ *   unlinks each that no output in the list starting at outputs holds, for a
+ *   checkpoint that was never put in place.
+ * Returns OUTPUT_ERR_NONE on success and OUTPUT_ERR_OPEN if file ends or is
+ *   invalid before every run is read.
+ */
+output_err output_discard(output_t *outputs, FILE *file) {
+    char *line = NULL;
+    size_t line_max = 0;
+    bool held = false;
+    int run_c = 0;
+    output_err ret = OUTPUT_ERR_NONE;
+
+    errno = 0;
+    if (getline(&line, &line_max, file) < 0 || \
+            sscanf(line, "%d", &run_c) != 1 || run_c < 0) {
+        ret = OUTPUT_ERR_OPEN;
+    }
+    for (int i = 0; i < run_c && ret == OUTPUT_ERR_NONE; i++) {
+        if (getdelim(&line, &line_max, '\0', file) < 0) {
+            ret = OUTPUT_ERR_OPEN;
+        }
+        else {
+            held = false;
+            for (output_t *curr = outputs; curr != NULL && !held; \
+                    curr = curr->next) {
+                for (int j = 0; j < curr->run_c && !held; j++) {
+                    held = curr->runs[j].path != NULL && \
+                        strcmp(curr->runs[j].path, line) == 0;
+                }
+            }
+            if (!held) {
+                unlink(line);
+            }
+        }
+    }
+    free(line);
+    return ret;
+}
+
+/**
+ * Closes out's file if it isn't stdout, deletes any paths and runs it still
+ *   holds and frees out. Anything still buffered is discarded. Kept runs are
+ *   closed but not unlinked, as a checkpoint may still name them.
+ */
+void output_close(output_t *out) {
+    if (out->path != NULL) {
+        close(out->fd);
+    }
+    for (int i = 0; i < out->run_c; i++) {
+        fclose(out->runs[i].file);
+        free(out->runs[i].path);
+        free(out->runs[i].buf);
+    }
+    free(out->runs);
+    free(out->dead);
+    list_arena_delete(&(out->arena));
+    free(out->path_buf);
+    free(out->buf);
+    free(out);
+}
+
+/**
+ * Appends n to the end of out's list. If this brings the list to out's memory
+ *   budget, the list is spilled.
+ * Returns OUTPUT_ERR_NONE on success and the error from output_spill if
+ *   spilling fails.
+ */
+output_err output_keep(output_t *out, node *n) {
+    output_err ret = OUTPUT_ERR_NONE;
+
+    if (out->path_last == NULL) {
+        out->path_list = n;
+    }
+    else {
+        out->path_last->next = n;
+    }
+    out->path_last = n;
+    out->list_bytes = out->arena.mem.bytes;
+    if (out->sort_memory > 0 && out->list_bytes >= out->sort_memory) {
+        ret = output_spill(out, false);
+    }
+    return ret;
+}
+
+/**
+ * Copies the record made of tag and OUTPUT_TAG_SEP if tag is not NULL, path
+ *   and term into out's buffer, writing the buffer first if the record
+ *   doesn't fit. A record larger than the whole buffer is written along with
+ *   the buffer without being copied.
+ * Returns OUTPUT_ERR_NONE on success and OUTPUT_ERR_WRITE if writing fails.
+ */
+output_err output_append(output_t *out, const char *tag, char *path, \
+        char term) {
+    char sep = OUTPUT_TAG_SEP;
+    struct iovec iov[5];
+    size_t tag_len = tag != NULL ? strlen(tag) : 0, path_len = strlen(path);
+    size_t len = path_len + 1 + (tag != NULL ? tag_len + 1 : 0);
+    char *write = NULL;
+    int iov_c = 0;
+    output_err ret = OUTPUT_ERR_NONE;
+
+    if (out->buf_len + len > out->buf_max) {
+        if (len >= out->buf_max) {
+            iov[iov_c].iov_base = out->buf;
+            iov[iov_c++].iov_len = out->buf_len;
+            if (tag != NULL) {
+                iov[iov_c].iov_base = (char*)tag;
+                iov[iov_c++].iov_len = tag_len;
+                iov[iov_c].iov_base = &sep;
+                iov[iov_c++].iov_len = 1;
+            }
+            iov[iov_c].iov_base = path;
+            iov[iov_c++].iov_len = path_len;
+            iov[iov_c].iov_base = &term;
+            iov[iov_c++].iov_len = 1;
+            ret = output_writev(out, iov, iov_c);
+            out->buf_len = 0;
+            len = 0;
+        }
+        else {
+            ret = output_write_buf(out);
+        }
+    }
+    if (ret == OUTPUT_ERR_NONE && len > 0) {
+        if (out->buf_len == 0) {
+            clock_gettime(CLOCK_MONOTONIC, &(out->buf_since));
+        }
+        write = out->buf + out->buf_len;
+        if (tag != NULL) {
+            memcpy(write, tag, tag_len);
+            write += tag_len;
+            *(write++) = sep;
+        }
+        memcpy(write, path, path_len);
+        write += path_len;
+        *write = term;
+        out->buf_len += len;
+    }
+    return ret;
+}
+
+/**
+ * Copies n's record, or its tag, path and term if it has none, into out's
+ *   buffer. The path is rebuilt in out's path buffer first.
+ * Returns OUTPUT_ERR_NONE on success, OUTPUT_ERR_MALLOC if the path can't be
+ *   rebuilt and OUTPUT_ERR_WRITE if writing fails.
+ */
+output_err output_append_node(output_t *out, node *n) {
+    size_t len = 0;
+    output_err ret = OUTPUT_ERR_NONE;
+
+    if (n->data.record != NULL) {
+        ret = output_append_record(out, n->data.record, n->data.record_len);
+    }
+    else if (node_path(n, &(out->path_buf), &(out->path_buf_max), &len) < 0) {
+        ret = OUTPUT_ERR_MALLOC;
+    }
+    else {
+        ret = output_append(out, n->data.tag, out->path_buf, n->data.term);
+    }
+    return ret;
+}
+
+/**
+ * Copies the len bytes of record into out's buffer, writing the buffer first
+ *   if they don't fit. A record larger than the whole buffer is written along
+ *   with the buffer without being copied.
+ * Returns OUTPUT_ERR_NONE on success and OUTPUT_ERR_WRITE if writing fails.
+ */
+output_err output_append_record(output_t *out, char *record, size_t len) {
+    struct iovec iov[2];
+    output_err ret = OUTPUT_ERR_NONE;
+
+    if (out->buf_len + len > out->buf_max) {
+        if (len >= out->buf_max) {
+            iov[0].iov_base = out->buf;
+            iov[0].iov_len = out->buf_len;
+            iov[1].iov_base = record;
+            iov[1].iov_len = len;
+            ret = output_writev(out, iov, 2);
+            out->buf_len = 0;
+            len = 0;
+        }
+        else {
+            ret = output_write_buf(out);
+        }
+    }
+    if (ret == OUTPUT_ERR_NONE && len > 0) {
+        memcpy(out->buf + out->buf_len, record, len);
+        out->buf_len += len;
+    }
+    return ret;
+}
+
+/**
+ * Writes out's buffer to its file and empties it.
+ * Returns OUTPUT_ERR_NONE on success and OUTPUT_ERR_WRITE if writing fails.
+ */
+output_err output_write_buf(output_t *out) {
+    struct iovec iov;
+    output_err ret = OUTPUT_ERR_NONE;
+
+    if (out->buf_len > 0) {
+        iov.iov_base = out->buf;
+        iov.iov_len = out->buf_len;
+        ret = output_writev(out, &iov, 1);
+        out->buf_len = 0;
+    }
+    return ret;
+}
+
+/**
+ * Writes all iov_c buffers of iov to out's file in order, continuing after
+ *   partial writes and interruptions. iov is modified as it is written.
+ * Returns OUTPUT_ERR_NONE on success and OUTPUT_ERR_WRITE if writing fails,
+ *   which is also recorded in out.
+ */
+output_err output_writev(output_t *out, struct iovec *iov, int iov_c) {
+    struct timespec start;
+    ssize_t n = 0;
+    output_err ret = OUTPUT_ERR_NONE;
+
+    stats_begin(&start);
+    while (iov_c > 0 && ret == OUTPUT_ERR_NONE) {
+        errno = 0;
+        n = writev(out->fd, iov, iov_c);
+        TRACE2(find, output_write, out->fd, (long)n);
+        if (n < 0 && errno != EINTR) {
+            ret = OUTPUT_ERR_WRITE;
+        }
+        else if (n > 0) {
+            find_stats.bytes += n;
+        }
+        while (n > 0 || (iov_c > 0 && iov->iov_len == 0)) {
+            if ((size_t)n >= iov->iov_len) {
+                n -= iov->iov_len;
+                iov++;
+                iov_c--;
+            }
+            else {
+                iov->iov_base = (char*)iov->iov_base + n;
+                iov->iov_len -= n;
+                n = 0;
+            }
+        }
+    }
+    stats_end(STATS_OUTPUT, &start);
+    if (ret != OUTPUT_ERR_NONE && out->err == OUTPUT_ERR_NONE) {
+        out->err = ret;
+    }
+    return ret;
+}
+
+/**
+ * Sorts out's list and writes it to a new temporary file as a run, emptying
+ *   the list. If out already has OUTPUT_MERGE_MAX runs, they are merged along
+ *   with the list into the new run instead, leaving it the only one. If keep
+ *   is true they are merged either way, and the run is kept at a path
+ *   starting with out's run_prefix. The run is then rewound and its first
+ *   record read back.
+ * Returns OUTPUT_ERR_NONE on success, OUTPUT_ERR_MALLOC if memory allocation
+ *   fails and OUTPUT_ERR_WRITE if the run could not be written or read.
+ */
+output_err output_spill(output_t *out, bool keep) {
+    struct timespec start;
+    output_run *run = NULL;
+    FILE *file = NULL;
+    char *path = NULL;
+    node *curr = NULL;
+    output_err ret = OUTPUT_ERR_NONE;
+
+    if (out->runs == NULL) {
+        errno = 0;
+        out->runs = malloc(sizeof(output_run) * (OUTPUT_MERGE_MAX + 1));
+        if (out->runs == NULL) {
+            ret = OUTPUT_ERR_MALLOC;
+        }
+    }
+    if (ret == OUTPUT_ERR_NONE) {
+        file = output_spill_file(keep ? out->run_prefix : NULL, &path);
+        if (file == NULL) {
+            ret = OUTPUT_ERR_WRITE;
+        }
+    }
+    if (ret == OUTPUT_ERR_NONE) {
+        TRACE1(find, sort_start, out->list_bytes);
+        stats_begin(&start);
+        list_sort(&(out->path_list), &(out->arena));
+        stats_end(STATS_SORT, &start);
+        TRACE0(find, sort_done);
+        if (keep || out->run_c == OUTPUT_MERGE_MAX) {
+            ret = output_merge(out, file);
+        }
+        curr = out->path_list;
+        while (curr != NULL && ret == OUTPUT_ERR_NONE) {
+            if (run_write_node(out, file, curr) < 0) {
+                ret = OUTPUT_ERR_WRITE;
+            }
+            curr = curr->next;
+        }
+        list_delete(&(out->path_list), &(out->arena));
+        out->path_last = NULL;
+        out->list_bytes = 0;
+
+        errno = 0;
+        if (ret == OUTPUT_ERR_NONE && (fflush(file) != 0 || \
+                (keep && fsync(fileno(file)) < 0) || \
+                fseek(file, 0, SEEK_SET) != 0)) {
+            ret = OUTPUT_ERR_WRITE;
+        }
+        if (ret == OUTPUT_ERR_NONE) {
+            run = &(out->runs[out->run_c]);
+            run->file = file;
+            run->path = path;
+            run->head = NULL;
+            run->buf = NULL;
+            run->buf_max = 0;
+            if (run_next(run) < 0) {
+                free(run->buf);
+                ret = OUTPUT_ERR_WRITE;
+            }
+            else {
+                out->run_c++;
+            }
+        }
+        if (ret != OUTPUT_ERR_NONE) {
+            fclose(file);
+            if (path != NULL) {
+                unlink(path);
+                free(path);
+            }
+        }
+    }
+    return ret;
+}
+
+/**
+ * Merges every run of out, along with its list if it isn't empty, writing
+ *   their records in increasing order to dest, or to out's buffer if dest is
+ *   NULL. The smallest head of the runs is found with a binary heap of their
+ *   indices, the list taking the index after the last run. Every run is
+ *   closed afterwards and the list is emptied, even if merging fails. A kept
+ *   run becomes out's dead run, replacing any earlier one.
+ * Returns OUTPUT_ERR_NONE on success and OUTPUT_ERR_WRITE if writing or
+ *   reading a run fails.
+ */
+output_err output_merge(output_t *out, FILE *dest) {
+    output_run *runs = out->runs, *run = NULL;
+    int heap[OUTPUT_MERGE_MAX + 1];
+    int run_c = out->run_c, heap_c = 0;
+    output_err ret = OUTPUT_ERR_NONE;
+
+    if (out->path_list != NULL) {
+        runs[run_c].file = NULL;
+        runs[run_c].head = out->path_list;
+        run_c++;
+    }
+    for (int i = 0; i < run_c; i++) {
+        if (runs[i].head != NULL) {
+            heap[heap_c++] = i;
+        }
+    }
+    for (int i = heap_c / 2 - 1; i >= 0; i--) {
+        heap_sift_down(out, heap, heap_c, i);
+    }
+    while (heap_c > 0 && ret == OUTPUT_ERR_NONE) {
+        run = &(runs[heap[0]]);
+        if (dest != NULL) {
+            if (run_write_node(out, dest, run->head) < 0) {
+                ret = OUTPUT_ERR_WRITE;
+            }
+        }
+        else {
+            ret = output_append_node(out, run->head);
+        }
+        if (ret == OUTPUT_ERR_NONE && run_next(run) < 0) {
+            ret = OUTPUT_ERR_WRITE;
+        }
+        if (run->head == NULL) {
+            heap[0] = heap[--heap_c];
+        }
+        heap_sift_down(out, heap, heap_c, 0);
+    }
+
+    for (int i = 0; i < out->run_c; i++) {
+        free(runs[i].buf);
+        fclose(runs[i].file);
+        if (runs[i].path != NULL) {
+            output_forget(out);
+            out->dead = runs[i].path;
+        }
+    }
+    out->run_c = 0;
+    list_delete(&(out->path_list), &(out->arena));
+    out->path_last = NULL;
+    out->list_bytes = 0;
+    if (ret != OUTPUT_ERR_NONE && out->err == OUTPUT_ERR_NONE) {
+        out->err = ret;
+    }
+    return ret;
+}
+
+/**
+ * Creates a temporary file for a run in $TMPDIR, or OUTPUT_SPILL_DIR if it
+ *   isn't set, and unlinks it right away so it is removed once closed, even
+ *   if find is killed. If prefix is not NULL the file is instead created at
+ *   prefix followed by OUTPUT_RUN_SUFFIX and kept, and its path is set in
+ *   path, which is set to NULL otherwise.
+ * Returns the file opened for reading and writing, or NULL on failure.
+ */
+FILE* output_spill_file(char *prefix, char **path) {
+    char *dir = getenv("TMPDIR");
+    FILE *ret = NULL;
+    int fd = -1;
+
+    if (dir == NULL || *dir == '\0') {
+        dir = OUTPUT_SPILL_DIR;
+    }
+    errno = 0;
+    *path = malloc(prefix != NULL ? \
+        strlen(prefix) + sizeof(OUTPUT_RUN_SUFFIX) : \
+        strlen(dir) + sizeof(OUTPUT_SPILL_NAME) + 1);
+    if (*path != NULL) {
+        if (prefix != NULL) {
+            sprintf(*path, "%s%s", prefix, OUTPUT_RUN_SUFFIX);
+        }
+        else {
+            sprintf(*path, "%s/%s", dir, OUTPUT_SPILL_NAME);
+        }
+        fd = mkstemp(*path);
+        if (fd >= 0) {
+            ret = fdopen(fd, "w+");
+            if (ret == NULL) {
+                close(fd);
+            }
+            if (ret == NULL || prefix == NULL) {
+                unlink(*path);
+            }
+        }
+        if (ret == NULL || prefix == NULL) {
+            free(*path);
+            *path = NULL;
+        }
+    }
+    return ret;
+}
+
+/**
+ * Writes n to file in the format of a run, its path rebuilt in out's path
+ *   buffer. Paths without a record are rendered into one, so every record
+ *   read back is written as it is.
+ * Returns 0 on success and -1 if rebuilding the path or writing fails.
+ */
+int run_write_node(output_t *out, FILE *file, node *n) {
+    size_t lens[2] = {0, n->data.record_len};
+    int ret = 0;
+
+    errno = 0;
+    if (node_path(n, &(out->path_buf), &(out->path_buf_max), &(lens[0])) < 0) {
+        ret = -1;
+    }
+    else if (n->data.record == NULL) {
+        lens[1] = lens[0] + 1 + \
+            (n->data.tag != NULL ? strlen(n->data.tag) + 1 : 0);
+    }
+    if (ret == 0 && (fwrite(lens, sizeof(size_t), 2, file) != 2 || \
+            fwrite(out->path_buf, 1, lens[0] + 1, file) != lens[0] + 1)) {
+        ret = -1;
+    }
+    else if (ret == 0 && n->data.record != NULL) {
+        if (fwrite(n->data.record, 1, lens[1], file) != lens[1]) {
+            ret = -1;
+        }
+    }
+    else if (ret == 0 && ((n->data.tag != NULL && \
+            (fputs(n->data.tag, file) == EOF || \
+            fputc(OUTPUT_TAG_SEP, file) == EOF)) || \
+            fwrite(out->path_buf, 1, lens[0], file) != lens[0] || \
+            fputc(n->data.term, file) == EOF)) {
+        ret = -1;
+    }
+    return ret;
+}
+
+/**
+ * Moves run on to its next record. The list run just steps to the next node,
+ *   which stays owned by the list, while a spilled run reads the next record
+ *   from its file into its own node, growing its buffer if the record
+ *   doesn't fit. run's head is NULL once it has none left.
+ * Returns 0 on success and -1 if the record could not be read or memory
+ *   allocation fails.
+ */
+int run_next(output_run *run) {
+    size_t lens[2], max = run->buf_max;
+    char *buf = NULL;
+    int ret = 0;
+
+    if (run->file == NULL) {
+        run->head = run->head->next;
+    }
+    else {
+        run->head = NULL;
+        errno = 0;
+        if (fread(lens, sizeof(size_t), 2, run->file) != 2) {
+            ret = ferror(run->file) ? -1 : 0;
+        }
+        else {
+            max = max == 0 ? LIST_PATH_INIT_MAX : max;
+            while (lens[0] + lens[1] + 2 > max) {
+                max *= 2;
+            }
+            if (max > run->buf_max) {
+                buf = realloc(run->buf, max);
+                if (buf == NULL) {
+                    ret = -1;
+                }
+                else {
+                    run->buf = buf;
+                    run->buf_max = max;
+                }
+            }
+            if (ret == 0 && (fread(run->buf, 1, lens[0] + 1, run->file) != \
+                    lens[0] + 1 || fread(run->buf + lens[0] + 1, 1, lens[1], \
+                    run->file) != lens[1])) {
+                ret = -1;
+            }
+            if (ret == 0) {
+                run->record_node.data.dir = NULL;
+                run->record_node.data.name = run->buf;
+                run->record_node.data.tag = NULL;
+                run->record_node.data.term = OUTPUT_TERM;
+                run->record_node.data.record = run->buf + lens[0] + 1;
+                run->record_node.data.record_len = lens[1];
+                run->record_node.next = NULL;
+                run->head = &(run->record_node);
+            }
+        }
+    }
+    return ret;
+}
+
+/**
+ * Compares the heads of out's runs i and j, the earlier run coming first when
+ *   they are equal.
+ * Returns true if run i's head comes before run j's, false otherwise.
+ */
+bool run_less(output_t *out, int i, int j) {
+    int ord = node_order(out->runs[i].head, out->runs[j].head, &(out->arena));
+
+    return ord < 0 || (ord == 0 && i < j);
+}
+
+/**
+ * Moves the index of one of out's runs at position i of heap down until
+ *   neither of its children's runs have a smaller head.
+ */
+void heap_sift_down(output_t *out, int *heap, int heap_c, int i) {
+    int least = i, swap = 0;
+    bool done = false;
+
+    while (!done) {
+        for (int child = 2 * i + 1; child <= 2 * i + 2; child++) {
+            if (child < heap_c && run_less(out, heap[child], heap[least])) {
+                least = child;
+            }
+        }
+        if (least == i) {
+            done = true;
+        }
+        else {
+            swap = heap[i];
+            heap[i] = heap[least];
+            heap[least] = swap;
+            i = least;
+        }
+    }
+}
@@ -0,0 +1,175 @@
+#ifndef __OUTPUT_H
+#define __OUTPUT_H
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/uio.h>
+#include "list.h"
+
+// Separates a path's tag from the path when printed
+#define OUTPUT_TAG_SEP '\t'
+// Terminators of printed paths, the second for -print0
+#define OUTPUT_TERM '\n'
+#define OUTPUT_TERM0 '\0'
+// Size of the buffer records are gathered in before being written
+#define OUTPUT_BUF_SIZE (1 << 18)
+// Longest a streaming output may hold a record before writing it
+#define OUTPUT_DEADLINE_MS 100
+#define NSEC_PER_MSEC 1000000L
+#define MSEC_PER_SEC 1000L
+// Name of the temporary files sorted runs are spilled to, in $TMPDIR or
+//   OUTPUT_SPILL_DIR
+#define OUTPUT_SPILL_NAME "find.XXXXXX"
+#define OUTPUT_SPILL_DIR "/tmp"
+// Most runs merged at once, bounding the files held open
+#define OUTPUT_MERGE_MAX 64
+// Suffix of the runs a checkpoint keeps, after the checkpoint's path
+#define OUTPUT_RUN_SUFFIX ".XXXXXX"
+
+typedef struct output_s output_t;
+typedef struct output_run_s output_run;
+
+// Error defines
+typedef enum output_err output_err;
+enum output_err {
+    OUTPUT_ERR_NONE   = 0,
+    OUTPUT_ERR_MALLOC = 1,
+    OUTPUT_ERR_OPEN   = 2,
+    OUTPUT_ERR_WRITE  = 3
+};
+
+// A sorted run of records spilled to an unlinked temporary file. Each record
+//   is stored as its path's length and its own length, followed by the path,
+//   '\0'-terminated, and then the record.
+struct output_run_s {
+    FILE *file;
+    // Path of a run kept for a checkpoint, NULL if the file is unlinked.
+    char *path;
+    // The run's smallest record not yet merged, NULL once it is exhausted.
+    //   For a spilled run it is read into record_node, its path and record
+    //   into buf, both reused for every record.
+    node *head;
+    node record_node;
+    char *buf;
+    size_t buf_max;
+};
+
+// A destination for matched paths. Paths are held until the output is
+//   flushed and then written in increasing order, unless the output streams,
+//   in which case they are written in the order they are added.
+struct output_s {
+    // Path of the file written to, NULL for stdout.
+    char *path;
+    int fd;
+
+    // Paths in the order they were added, sorted once they are written,
+    //   carved from arena. list_bytes counts the memory they hold. With a
+    //   sort_memory budget other than 0, they are spilled as a sorted run
+    //   whenever they reach it, and the runs are merged with what is left when
+    //   the output is flushed.
+    list path_list;
+    node *path_last;
+    list_arena arena;
+    size_t list_bytes;
+    size_t sort_memory;
+    output_run *runs;
+    int run_c;
+    // Prefix of the path of the run a checkpoint spills into, and the kept
+    //   run merged away since, which the last checkpoint still names.
+    char *run_prefix;
+    char *dead;
+
+    // Records waiting to be written with a single write(2). A streaming output
+    //   writes them once the buffer fills or the oldest has waited
+    //   OUTPUT_DEADLINE_MS, whichever comes first.
+    bool stream;
+    char *buf;
+    size_t buf_len;
+    size_t buf_max;
+    struct timespec buf_since;
+
+    // Whole path of the node being written, rebuilt from its directories.
+    char *path_buf;
+    size_t path_buf_max;
+
+    // First failure adding or writing a path, as evaluation has no way to
+    //   report it.
+    output_err err;
+
+    output_t *next;
+};
+
+// Opens an output writing to the file at path, or to stdout if path is NULL.
+//   If stream is true paths are written as they are added rather than sorted.
+//   Otherwise sorting holds at most about sort_memory bytes of paths in
+//   memory, or all of them if it is 0. If append is true a streaming output
+//   appends to the file instead of truncating it. Allocation of out is done
+//   here.
+output_err output_open(output_t **out, char *path, bool stream, \
+    size_t sort_memory, bool append);
+
+// Adds path to out, ending it with term. If tag is not NULL it is printed
+//   before path, and must be valid until out is flushed.
+output_err output_add(output_t *out, char *path, const char *tag, char term);
+
+// Reserves room for a record of at most max bytes in out, to be added by
+//   output_commit. Returns where the record should be written.
+char* output_reserve(output_t *out, size_t max);
+
+// Adds the len byte record written to the room reserved in out, ordered by
+//   path.
+output_err output_commit(output_t *out, char *path, size_t len);
+
+// Writes out's buffered records if a streaming output's deadline has passed.
+output_err output_poll(output_t *out);
+
+// Writes the buffered records of out and every streaming output after it.
+output_err output_drain(output_t *out);
+
+// Writes every path held by out to its file, in increasing order.
+output_err output_flush(output_t *out);
+
+// Writes the paths out holds to file, so output_restore can take them back
+//   after a restart: a streaming output is written out, and a sorting one is
+//   spilled into a single run at a path starting with prefix that is kept.
+output_err output_checkpoint(output_t *out, char *prefix, FILE *file);
+
+// Takes back the paths held by an output when output_checkpoint wrote file.
+output_err output_restore(output_t *out, FILE *file);
+
+// Removes the kept run merged away since the last checkpoint, once no
+//   checkpoint names it.
+void output_forget(output_t *out);
+
+// Removes the runs one output held when output_checkpoint wrote file, unless
+//   an output in the list starting at outputs still holds them.
+output_err output_discard(output_t *outputs, FILE *file);
+
+// Closes out's file unless it is stdout and frees out. Kept runs are left for
+//   the checkpoint naming them.
+void output_close(output_t *out);
+
+// Helpers for output_add and output_flush
+output_err output_keep(output_t *out, node *n);
+output_err output_append(output_t *out, const char *tag, char *path, \
+    char term);
+output_err output_append_node(output_t *out, node *n);
+output_err output_append_record(output_t *out, char *record, size_t len);
+output_err output_write_buf(output_t *out);
+output_err output_writev(output_t *out, struct iovec *iov, int iov_c);
+
+// Helpers for sorting with a memory budget
+output_err output_spill(output_t *out, bool keep);
+output_err output_merge(output_t *out, FILE *dest);
+FILE* output_spill_file(char *prefix, char **path);
+int run_write_node(output_t *out, FILE *file, node *n);
+int run_next(output_run *run);
+bool run_less(output_t *out, int i, int j);
+void heap_sift_down(output_t *out, int *heap, int heap_c, int i);
+
+#endif /* __OUTPUT_H */
@@ -0,0 +1,177 @@
+/**
+ * Prefetching of the directories a streaming walk is about to descend into.
+ *   The walk reads one directory at a time, and every read and stat call on a
+ *   cold cache blocks it while nothing else is in flight. Once it has read a
+ *   directory to the end it knows the subdirectories it will descend into
+ *   next, so it hands their paths to a helper thread, which reads each of
+ *   them and stats its files while the walk is busy evaluating. By the time
+ *   the walk gets there, the directory's blocks and its files' inodes are in
+ *   the dentry and inode caches and its own calls return without I/O.
+ * readahead and posix_fadvise only act on a file's page cache, which
+ *   directories on ext4 and XFS don't go through, so the helper warms the
+ *   caches by making the same calls the walk will.
+ * The paths are passed through a bounded ring with a single producer and a
+ *   single consumer, so neither side ever takes a lock: the walk only moves
+ *   tail and the helper only moves head. When the ring is full the walk drops
+ *   the path rather than wait, as prefetching is only ever a hint, and the
+ *   walk reads the directory itself. A semaphore counts the paths in the
+ *   ring, so the helper sleeps when it has nothing to read, and posting it
+ *   costs nothing while the helper is busy.
+ */
+#include "prefetch.h"
+#include "walk.h"
+
+/**
+ * Initializes prefetch with an empty ring and starts its helper thread.
+ * Returns 0 on success and -1 on failure, with errno set.
+ */
+int prefetch_start(prefetch_t *prefetch) {
+    int err = 0, ret = 0;
+
+    atomic_init(&(prefetch->stop), false);
+    atomic_init(&(prefetch->head), 0);
+    atomic_init(&(prefetch->tail), 0);
+    prefetch->pushed = 0;
+    prefetch->dropped = 0;
+    prefetch->done = 0;
+    errno = 0;
+    prefetch->buf = malloc(PREFETCH_BUF_SIZE);
+    if (prefetch->buf == NULL) {
+        ret = -1;
+    }
+    else if (sem_init(&(prefetch->ready), 0, 0) < 0) {
+        free(prefetch->buf);
+        ret = -1;
+    }
+    else if ((err = pthread_create(&(prefetch->thread), NULL, prefetch_run, \
+            prefetch)) != 0) {
+        sem_destroy(&(prefetch->ready));
+        free(prefetch->buf);
+        errno = err;
+        ret = -1;
+    }
+    return ret;
+}
+
+/**
+ * Copies the first len bytes of path into the ring's slot at tail and
+ *   publishes it by moving tail, waking the helper. The copy is freed by the
+ *   helper once it has read the directory.
+ * Returns true if the path was queued, and false if the ring was full or
+ *   memory allocation failed.
+ */
+bool prefetch_push(prefetch_t *prefetch, const char *path, size_t len) {
+    size_t tail = atomic_load_explicit(&(prefetch->tail), \
+        memory_order_relaxed);
+    size_t head = atomic_load_explicit(&(prefetch->head), \
+        memory_order_acquire);
+    char *copy = NULL;
+    bool ret = false;
+
+    if (tail - head < PREFETCH_QUEUE_SIZE && \
+            (copy = malloc(len + 1)) != NULL) {
+        memcpy(copy, path, len);
+        copy[len] = '\0';
+        prefetch->paths[tail & (PREFETCH_QUEUE_SIZE - 1)] = copy;
+        atomic_store_explicit(&(prefetch->tail), tail + 1, \
+            memory_order_release);
+        sem_post(&(prefetch->ready));
+        prefetch->pushed++;
+        ret = true;
+    }
+    else {
+        prefetch->dropped++;
+    }
+    return ret;
+}
+
+/**
+ * Tells the helper to stop, waking it if it is waiting, and joins it. Paths
+ *   it didn't get to are freed. The directories queued and those the helper
+ *   read are counted in find_stats.
+ */
+void prefetch_stop(prefetch_t *prefetch) {
+    char *path = NULL;
+
+    atomic_store(&(prefetch->stop), true);
+    sem_post(&(prefetch->ready));
+    pthread_join(prefetch->thread, NULL);
+    find_stats.prefetch_queued += prefetch->pushed;
+    find_stats.prefetched += prefetch->done;
+    while ((path = prefetch_pop(prefetch)) != NULL) {
+        free(path);
+    }
+    sem_destroy(&(prefetch->ready));
+    free(prefetch->buf);
+    prefetch->buf = NULL;
+}
+
+/**
+ * Body of the helper thread. Waits for a path to be pushed and prefetches it,
+ *   until told to stop.
+ * Returns NULL.
+ */
+void* prefetch_run(void *arg) {
+    prefetch_t *prefetch = arg;
+    char *path = NULL;
+
+    while (!atomic_load(&(prefetch->stop))) {
+        if (sem_wait(&(prefetch->ready)) == 0 && \
+                !atomic_load(&(prefetch->stop)) && \
+                (path = prefetch_pop(prefetch)) != NULL) {
+            prefetch_dir(prefetch, path);
+            free(path);
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Takes the path at the ring's head, moving head past it so its slot can be
+ *   reused. Must only be called by the helper, or once it has been joined.
+ * Returns the path, or NULL if the ring is empty.
+ */
+char* prefetch_pop(prefetch_t *prefetch) {
+    size_t head = atomic_load_explicit(&(prefetch->head), \
+        memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&(prefetch->tail), \
+        memory_order_acquire);
+    char *ret = NULL;
+
+    if (head != tail) {
+        ret = prefetch->paths[head & (PREFETCH_QUEUE_SIZE - 1)];
+        atomic_store_explicit(&(prefetch->head), head + 1, \
+            memory_order_release);
+    }
+    return ret;
+}
+
+/**
+ * Reads the directory at path to the end and stats each of its files, which
+ *   brings its blocks and its files' inodes into the caches. Errors are
+ *   ignored, as the walk will meet and report them itself. Stops early once
+ *   the helper is told to stop.
+ */
+void prefetch_dir(prefetch_t *prefetch, char *path) {
+    walk_dirent *dirent = NULL;
+    struct stat st;
+    long n = 0, pos = 0;
+    int fd = -1;
+
+    fd = open(path, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    if (fd >= 0) {
+        n = syscall(SYS_getdents64, fd, prefetch->buf, PREFETCH_BUF_SIZE);
+        while (n > 0 && !atomic_load(&(prefetch->stop))) {
+            for (pos = 0; pos < n; pos += dirent->d_reclen) {
+                dirent = (walk_dirent*)(prefetch->buf + pos);
+                if (strcmp(dirent->d_name, ".") != 0 && \
+                        strcmp(dirent->d_name, "..") != 0) {
+                    fstatat(fd, dirent->d_name, &st, AT_SYMLINK_NOFOLLOW);
+                }
+            }
+            n = syscall(SYS_getdents64, fd, prefetch->buf, PREFETCH_BUF_SIZE);
+        }
+        close(fd);
+        prefetch->done++;
+    }
+}
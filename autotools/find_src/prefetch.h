@@ -0,0 +1,62 @@
+#ifndef __PREFETCH_H
+#define __PREFETCH_H
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdatomic.h>
+
+// Directories waiting to be prefetched at most, a power of two
+#define PREFETCH_QUEUE_SIZE 256
+// Size of the chunks the helper reads directories in
+#define PREFETCH_BUF_SIZE (1 << 15)
+
+typedef struct prefetch_s prefetch_t;
+
+// A helper thread reading directories the walk will soon descend into, so
+//   their blocks and the inodes of their files are already cached when it
+//   does. Paths are handed over through a ring only the walk pushes to and
+//   only the helper pops from, so neither takes a lock. ready counts the
+//   paths pushed, and wakes the helper when it has nothing to do.
+struct prefetch_s {
+    pthread_t thread;
+    sem_t ready;
+    atomic_bool stop;
+
+    char *paths[PREFETCH_QUEUE_SIZE];
+    atomic_size_t head;
+    atomic_size_t tail;
+    char *buf;
+
+    // Directories pushed, dropped as the ring was full, and read by the
+    //   helper. Only the helper writes done, and it is read once stopped.
+    unsigned long pushed;
+    unsigned long dropped;
+    unsigned long done;
+};
+
+// Starts the helper thread of prefetch. prefetch must already be allocated.
+int prefetch_start(prefetch_t *prefetch);
+
+// Queues the directory at the first len bytes of path to be prefetched,
+//   unless the ring is full. Must only be called by the thread that started
+//   prefetch.
+bool prefetch_push(prefetch_t *prefetch, const char *path, size_t len);
+
+// Stops and joins the helper thread, dropping any directories still queued.
+void prefetch_stop(prefetch_t *prefetch);
+
+// Helpers for the helper thread
+void* prefetch_run(void *arg);
+char* prefetch_pop(prefetch_t *prefetch);
+void prefetch_dir(prefetch_t *prefetch, char *path);
+
+#endif /* __PREFETCH_H */
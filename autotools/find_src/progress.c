@@ -0,0 +1,88 @@
+/**
+ * Progress reports on a running traversal, so a long scan can be told apart
+ *   from a hung one. Sending find PROGRESS_SIGNAL, or every interval given to
+ *   --progress, prints a line to stderr with the entries seen and the rate
+ *   since the last report, the depth of the walk, the directories still to be
+ *   read, the matches so far and the path just read.
+ * The handlers only set a flag, which the traversal checks after every entry
+ *   and clears once it has reported, so the report is made from the
+ *   traversal itself where everything it reads is consistent, and no clock is
+ *   read and no lock or system call is made while nothing is due. The
+ *   handlers are installed with SA_RESTART so the system calls they interrupt
+ *   carry on.
+ * Signal handlers are process-wide, so this is part of the find program
+ *   rather than of libfind, which never installs any.
+ */
+#include "progress.h"
+
+progress_t find_progress;
+
+/**
+ * Installs progress_signal for PROGRESS_SIGNAL and, if interval is not 0, for
+ *   SIGALRM, with a timer raising it every interval seconds.
+ * Returns 0 on success and -1 on failure, with errno set.
+ */
+int progress_start(double interval) {
+    struct sigaction action;
+    struct itimerval timer;
+    int ret = 0;
+
+    find_progress.due = 0;
+    find_progress.last_entries = 0;
+    clock_gettime(CLOCK_MONOTONIC, &(find_progress.last));
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = progress_signal;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&(action.sa_mask));
+    errno = 0;
+    if (sigaction(PROGRESS_SIGNAL, &action, NULL) < 0) {
+        ret = -1;
+    }
+    else if (interval > 0) {
+        timer.it_interval.tv_sec = (time_t)interval;
+        timer.it_interval.tv_usec = (suseconds_t)((interval - \
+            timer.it_interval.tv_sec) * 1000000);
+        if (timer.it_interval.tv_sec == 0 && timer.it_interval.tv_usec == 0) {
+            timer.it_interval.tv_usec = 1;
+        }
+        timer.it_value = timer.it_interval;
+        if (sigaction(SIGALRM, &action, NULL) < 0 || \
+                setitimer(ITIMER_REAL, &timer, NULL) < 0) {
+            ret = -1;
+        }
+    }
+    return ret;
+}
+
+/**
+ * Prints a report to stderr and clears the flag. The rate is of the entries
+ *   seen since the last report. Directories pending are only known for a
+ *   streaming walk.
+ */
+void progress_report(walk_t *walk, FTSENT *entry) {
+    struct timespec now;
+    double sec = 0;
+    long pending = walk_pending(walk);
+
+    find_progress.due = 0;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    sec = (now.tv_sec - find_progress.last.tv_sec) + \
+        (now.tv_nsec - find_progress.last.tv_nsec) / 1e9;
+    fprintf(stderr, "find: %lu entries (%.0f/s), depth %d, ", \
+        find_stats.entries, sec > 0 ? (find_stats.entries - \
+        find_progress.last_entries) / sec : 0, entry->fts_level);
+    if (pending >= 0) {
+        fprintf(stderr, "%ld directories pending, ", pending);
+    }
+    fprintf(stderr, "%lu matches, %s\n", find_stats.matches, entry->fts_path);
+    find_progress.last = now;
+    find_progress.last_entries = find_stats.entries;
+}
+
+/**
+ * Marks a report as due.
+ */
+void progress_signal(int sig) {
+    (void)sig;
+    find_progress.due = 1;
+}
@@ -0,0 +1,41 @@
+#ifndef __PROGRESS_H
+#define __PROGRESS_H
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/time.h>
+#include <fts.h>
+#include "stats.h"
+#include "walk.h"
+
+// Signal asking find for a progress report
+#define PROGRESS_SIGNAL SIGUSR1
+
+typedef struct progress_s progress_t;
+
+// When the last report was made and how many entries had been seen by then,
+//   to give the rate since. due is set by the signal handlers and only ever
+//   read and cleared by the traversal.
+struct progress_s {
+    volatile sig_atomic_t due;
+    struct timespec last;
+    unsigned long last_entries;
+};
+
+// The progress of this run of find
+extern progress_t find_progress;
+
+// Has a report made on PROGRESS_SIGNAL, and every interval seconds if it is
+//   not 0.
+int progress_start(double interval);
+
+// Prints a report on the traversal, with entry the one last read.
+void progress_report(walk_t *walk, FTSENT *entry);
+
+// Handler of PROGRESS_SIGNAL and SIGALRM
+void progress_signal(int sig);
+
+#endif /* __PROGRESS_H */
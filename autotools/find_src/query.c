@@ -0,0 +1,503 @@
+/**
+ * A set of queries evaluated together in one traversal of a file tree. Each
+ *   query is an expression with its own output, so a single walk can answer
+ *   several questions about the same tree, reading each directory and getting
+ *   each file's stat struct once no matter how many queries look at it.
+ * Queries are separated by EXPRESSION_SEP on the command line, or can be read
+ *   one per line from a file, in which case each is tagged with its line
+ *   number so its matches can be told apart. Primaries that appear in more
+ *   than one query with equivalent args are only evaluated once per file, the
+ *   rest reusing the first one's result.
+ */
+#include "query.h"
+
+/**
+ * Initializes set with no queries. stdout is opened as the first output, so it
+ *   is always the first one written to. If stream is true every output of set
+ *   writes paths in the order they are found rather than sorted. Sorting
+ *   outputs spill paths past sort_memory bytes to temporary files, unless it
+ *   is 0. If append is true, streaming outputs append to their files, as when
+ *   resuming a traversal.
+ * Returns EXPR_ERR_NONE on success and any other expr_err on failure.
+ */
+expr_err query_set_create(query_set_t *set, bool stream, size_t sort_memory, \
+        bool append) {
+    expr_err ret = EXPR_ERR_NONE;
+
+    set->queries = NULL;
+    set->query_c = 0;
+    set->query_max = 0;
+    set->done_c = 0;
+    set->outputs = NULL;
+    arena_create(&(set->mem));
+    set->entry_id = 0;
+    set->stream = stream;
+    set->sort_memory = sort_memory;
+    set->append = append;
+
+    errno = 0;
+    if (get_prog_state(&(set->state_args)) < 0) {
+        ret = EXPR_ERR_STATE;
+    }
+    else if (query_set_get_output(set, NULL) == NULL) {
+        ret = EXPR_ERR_MALLOC;
+    }
+    else {
+        set->state_args.outputs = set->outputs;
+    }
+    return ret;
+}
+
+/**
+ * Parses expr_argv into a query for every expression separated by
+ *   EXPRESSION_SEP. Queries print to stdout unless they have an -fprint
+ *   action, and every -fprint naming the same file shares one output.
+ * If expr_argv is empty a single query that always evaluates to true is added.
+ *   Otherwise every expression must have at least one primary.
+ * Returns EXPR_ERR_NONE on success and any other expr_err on failure. Queries
+ *   added before the failure are kept and deleted along with set.
+ */
+expr_err query_set_add(query_set_t *set, char **expr_argv, char *tag) {
+    char **expr_argv_i = expr_argv;
+    query_t *query = NULL;
+    int first = set->query_c;
+    bool sep = false;
+    expr_err ret = EXPR_ERR_NONE;
+
+    do {
+        if (set->query_c > first) {
+            incr_argv_i(&expr_argv_i, 1);
+            sep = true;
+        }
+        if (set->query_c == set->query_max) {
+            ret = query_set_grow(set);
+        }
+        if (ret == EXPR_ERR_NONE) {
+            query = &(set->queries[set->query_c]);
+            ret = expression_create(&(query->expression), \
+                &(set->state_args), &(set->mem), &expr_argv_i);
+        }
+        if (ret == EXPR_ERR_NONE) {
+            set->query_c++;
+            query->tag = tag;
+            query->done = false;
+            if (query->expression.head == NULL && \
+                    (sep || expr_argv_i[0] != NULL)) {
+                ret = EXPR_ERR_PRIMARY;
+            }
+            else {
+                ret = query_set_bind_outputs(set, query);
+            }
+        }
+    } while (expr_argv_i[0] != NULL && ret == EXPR_ERR_NONE);
+
+    if (ret == EXPR_ERR_NONE) {
+        query_set_share_primaries(set, first);
+    }
+    return ret;
+}
+
+/**
+ * Reads the file at path and adds the queries on each of its lines to set,
+ *   tagged with the line's number. Args on a line are separated by whitespace
+ *   and may be quoted as split_args describes. Blank lines and lines starting
+ *   with QUERY_FILE_COMMENT are skipped.
+ * Every line is kept in memory for the life of set, since the expressions
+ *   parsed from it refer to its args.
+ * Returns EXPR_ERR_NONE on success, EXPR_ERR_INPUT if the file could not be
+ *   read and any other expr_err if a query could not be added.
+ */
+expr_err query_set_add_file(query_set_t *set, char *path) {
+    FILE *file = NULL;
+    char *line = NULL, *copy = NULL, *tag = NULL, **argv = NULL;
+    size_t line_max = 0;
+    ssize_t line_len = 0;
+    unsigned long line_num = 0;
+    expr_err ret = EXPR_ERR_NONE;
+
+    errno = 0;
+    file = fopen(path, "r");
+    if (file == NULL) {
+        ret = EXPR_ERR_INPUT;
+    }
+    else {
+        errno = 0;
+        while (ret == EXPR_ERR_NONE && \
+                (line_len = getline(&line, &line_max, file)) != -1) {
+            line_num++;
+            copy = arena_strndup(&(set->mem), line, line_len);
+            argv = copy != NULL ? split_args(copy, &(set->mem)) : NULL;
+            if (argv == NULL) {
+                ret = EXPR_ERR_MALLOC;
+            }
+            else if (argv[0] != NULL && argv[0][0] != QUERY_FILE_COMMENT) {
+                tag = arena_alloc(&(set->mem), QUERY_TAG_LEN);
+                if (tag == NULL) {
+                    ret = EXPR_ERR_MALLOC;
+                }
+                else {
+                    snprintf(tag, QUERY_TAG_LEN, "%lu", line_num);
+                    ret = query_set_add(set, argv, tag);
+                }
+            }
+            errno = 0;
+        }
+        if (ret == EXPR_ERR_NONE && ferror(file)) {
+            ret = EXPR_ERR_INPUT;
+        }
+        free(line);
+        fclose(file);
+    }
+    return ret;
+}
+
+/**
+ * Doubles the number of queries set has room for.
+ * Returns EXPR_ERR_NONE on success and EXPR_ERR_MALLOC if memory allocation
+ *   fails, in which case set is untouched.
+ */
+expr_err query_set_grow(query_set_t *set) {
+    query_t *queries = NULL;
+    int query_max = set->query_max == 0 ? QUERY_SET_INIT_MAX : \
+        set->query_max * 2;
+    expr_err ret = EXPR_ERR_NONE;
+
+    errno = 0;
+    queries = realloc(set->queries, sizeof(query_t) * query_max);
+    if (queries == NULL) {
+        ret = EXPR_ERR_MALLOC;
+    }
+    else {
+        set->queries = queries;
+        set->query_max = query_max;
+    }
+    return ret;
+}
+
+/**
+ * Splits line into args separated by whitespace, in place. Inside single
+ *   quotes every character is taken literally, and outside of them a backslash
+ *   takes the character after it literally, so args can contain whitespace.
+ *   The quotes and backslashes themselves are removed.
+ * Returns a NULL-terminated array of args pointing into line, carved from
+ *   arena, or NULL if memory allocation fails.
+ */
+char** split_args(char *line, arena_t *arena) {
+    char **argv = NULL;
+    char *read = line, *write = line, quote = '\0';
+    int argc = 0;
+
+    argv = arena_alloc(arena, sizeof(char*) * (strlen(line) / 2 + 2));
+    if (argv != NULL) {
+        while (*read != '\0') {
+            while (isspace((unsigned char)*read)) {
+                read++;
+            }
+            if (*read != '\0') {
+                argv[argc++] = write;
+                while (*read != '\0' && \
+                        (quote != '\0' || !isspace((unsigned char)*read))) {
+                    if (quote == '\0' && (*read == '\'' || *read == '"')) {
+                        quote = *read;
+                    }
+                    else if (quote != '\0' && *read == quote) {
+                        quote = '\0';
+                    }
+                    else if (*read == '\\' && quote != '\'' && \
+                            read[1] != '\0') {
+                        read++;
+                        *(write++) = *read;
+                    }
+                    else {
+                        *(write++) = *read;
+                    }
+                    read++;
+                }
+                if (*read != '\0') {
+                    read++;
+                }
+                *(write++) = '\0';
+            }
+        }
+        argv[argc] = NULL;
+    }
+    return argv;
+}
+
+/**
+ * Points query and each of its -fprint, -print, -print0, -printf and -ls
+ *   primaries at the output they print to. -print and -print0 print the
+ *   query's tag like the query itself would, while -printf and -ls print only
+ *   their own lines.
+ * An -exec-coproc that ends the query decides the query's result on its own,
+ *   so it is allowed to keep paths in flight and prints the query's matches
+ *   itself once their verdicts arrive.
+ * Returns EXPR_ERR_NONE on success, EXPR_ERR_OUTPUT if an output could not
+ *   be opened and EXPR_ERR_MALLOC if memory allocation failed.
+ */
+expr_err query_set_bind_outputs(query_set_t *set, query_t *query) {
+    primary_node *curr = query->expression.head;
+    expr_err ret = EXPR_ERR_NONE;
+
+    query->out = query_set_get_output(set, NULL);
+    while (curr != NULL && ret == EXPR_ERR_NONE) {
+        if (primary_arg_type_map[curr->primary] == FILE_ARG || \
+                primary_arg_type_map[curr->primary] == PRINT_ARG) {
+            curr->arg.fprint_arg->out = query_set_get_output(set, \
+                curr->arg.fprint_arg->path);
+            if (curr->arg.fprint_arg->out == NULL) {
+                ret = EXPR_ERR_OUTPUT;
+            }
+            else if (primary_arg_type_map[curr->primary] == PRINT_ARG) {
+                curr->arg.fprint_arg->tag = query->tag;
+            }
+        }
+        else if (curr->primary == PRINTF) {
+            curr->arg.format_arg->out = query->out;
+        }
+        else if (curr->primary == LS) {
+            curr->arg.long_list_arg->out = query->out;
+        }
+        else if (curr->primary == EXEC_COPROC && curr->next == NULL) {
+            if (coproc_set_window(curr->arg.coproc_arg, \
+                    set->state_args.coproc_window, \
+                    query->expression.print ? query->out : NULL, \
+                    query->tag) < 0) {
+                ret = EXPR_ERR_MALLOC;
+            }
+        }
+        curr = curr->next;
+    }
+    return ret;
+}
+
+/**
+ * Points every primary of the queries from index first onwards at the first
+ *   equivalent primary found in any query, so that a file is only evaluated
+ *   once by the primary for all of them.
+ */
+void query_set_share_primaries(query_set_t *set, int first) {
+    primary_node *curr = NULL, *other = NULL;
+    bool found = false;
+
+    for (int i = first; i < set->query_c; i++) {
+        curr = set->queries[i].expression.head;
+        while (curr != NULL) {
+            found = false;
+            for (int j = 0; j <= i && !found; j++) {
+                other = set->queries[j].expression.head;
+                while (other != curr && other != NULL && !found) {
+                    if (other->primary == curr->primary && \
+                            other->shared == NULL && \
+                            primary_arg_equal(curr->primary, &(curr->arg), \
+                            &(other->arg))) {
+                        curr->shared = other;
+                        found = true;
+                    }
+                    other = other->next;
+                }
+            }
+            curr = curr->next;
+        }
+    }
+}
+
+/**
+ * Finds the output of set writing to path, comparing paths by string, and
+ *   opens a new one if there is none.
+ * Returns the output on success and NULL if it could not be opened.
+ */
+output_t* query_set_get_output(query_set_t *set, char *path) {
+    output_t *curr = set->outputs, *prev = NULL;
+
+    while (curr != NULL && (curr->path != path && (curr->path == NULL || \
+            path == NULL || strcmp(curr->path, path) != 0))) {
+        prev = curr;
+        curr = curr->next;
+    }
+    if (curr == NULL && output_open(&curr, path, set->stream, \
+            set->sort_memory, set->append) == OUTPUT_ERR_NONE) {
+        if (prev == NULL) {
+            set->outputs = curr;
+        }
+        else {
+            prev->next = curr;
+        }
+    }
+    return curr;
+}
+
+/**
+ * Evaluates each query in set against entry, in order. Every query that isn't
+ *   done is evaluated, regardless of the results of the ones before it,
+ *   unless one has asked for the traversal to stop. A query is done once a
+ *   LIMIT in it has let through its last file, and the traversal is stopped
+ *   once every query is. Streaming outputs are then given the chance to write
+ *   out records that have waited past their deadline.
+ * Returns OUTPUT_ERR_NONE on success, OUTPUT_ERR_MALLOC if entry could not
+ *   be added to an output and OUTPUT_ERR_WRITE if a streaming output could not
+ *   be written.
+ */
+output_err query_set_evaluate(query_set_t *set, FTSENT *entry) {
+    output_t *curr = set->outputs;
+    query_t *query = NULL;
+    output_err ret = OUTPUT_ERR_NONE;
+
+    set->entry_id++;
+    for (int i = 0; i < set->query_c && ret == OUTPUT_ERR_NONE && \
+            !set->state_args.quit; i++) {
+        query = &(set->queries[i]);
+        if (!query->done) {
+            set->state_args.done = false;
+            if (expression_evaluate(&(query->expression), entry, \
+                    set->entry_id) && query->expression.print) {
+                ret = output_add(query->out, entry->fts_path, query->tag, \
+                    OUTPUT_TERM);
+                find_stats.matches++;
+            }
+            if (set->state_args.done) {
+                query->done = true;
+                set->done_c++;
+                if (set->done_c == set->query_c) {
+                    set->state_args.quit = true;
+                }
+            }
+        }
+    }
+    while (curr != NULL && ret == OUTPUT_ERR_NONE) {
+        ret = output_poll(curr);
+        curr = curr->next;
+    }
+    return ret;
+}
+
+/**
+ * Finishes every query's expression, then writes out every output of set.
+ *   Expressions go first as finishing them can still add to the outputs. Both
+ *   are done for all of them even if one fails.
+ * Returns EXPR_ERR_NONE on success, EXPR_ERR_FINISH if an expression could not
+ *   be finished and EXPR_ERR_OUTPUT if an output failed.
+ */
+expr_err query_set_finish(query_set_t *set) {
+    output_t *curr = set->outputs;
+    expr_err ret = EXPR_ERR_NONE;
+
+    for (int i = 0; i < set->query_c; i++) {
+        if (expression_finish(&(set->queries[i].expression)) != \
+                EXPR_ERR_NONE) {
+            ret = EXPR_ERR_FINISH;
+        }
+    }
+    while (curr != NULL) {
+        if (output_flush(curr) != OUTPUT_ERR_NONE && ret == EXPR_ERR_NONE) {
+            ret = EXPR_ERR_OUTPUT;
+        }
+        curr = curr->next;
+    }
+    return ret;
+}
+
+/**
+ * Writes the number of outputs of set to file, then checkpoints each of them
+ *   in order, which is the same for the same queries. Runs they keep are
+ *   named after prefix.
+ * Returns OUTPUT_ERR_NONE on success and the first error of an output
+ *   otherwise.
+ */
+output_err query_set_checkpoint(query_set_t *set, char *prefix, FILE *file) {
+    output_t *curr = set->outputs;
+    int out_c = 0;
+    output_err ret = OUTPUT_ERR_NONE;
+
+    while (curr != NULL) {
+        out_c++;
+        curr = curr->next;
+    }
+    fprintf(file, "%d\n", out_c);
+    curr = set->outputs;
+    while (curr != NULL && ret == OUTPUT_ERR_NONE) {
+        ret = output_checkpoint(curr, prefix, file);
+        curr = curr->next;
+    }
+    return ret;
+}
+
+/**
+ * Restores every output of set from what query_set_checkpoint wrote to file.
+ *   set must have been given the same queries, so it has the same outputs.
+ * Returns OUTPUT_ERR_NONE on success, OUTPUT_ERR_OPEN if file doesn't match
+ *   set's outputs and the first error of an output otherwise.
+ */
+output_err query_set_restore(query_set_t *set, FILE *file) {
+    output_t *curr = set->outputs;
+    int out_c = 0;
+    output_err ret = OUTPUT_ERR_NONE;
+
+    errno = 0;
+    if (fscanf(file, "%d", &out_c) != 1 || fgetc(file) != '\n') {
+        ret = OUTPUT_ERR_OPEN;
+    }
+    while (curr != NULL && ret == OUTPUT_ERR_NONE) {
+        ret = output_restore(curr, file);
+        out_c--;
+        curr = curr->next;
+    }
+    if (ret == OUTPUT_ERR_NONE && out_c != 0) {
+        ret = OUTPUT_ERR_OPEN;
+    }
+    return ret;
+}
+
+/**
+ * Removes the runs of set's outputs that no checkpoint names anymore.
+ */
+void query_set_forget(query_set_t *set) {
+    output_t *curr = set->outputs;
+
+    while (curr != NULL) {
+        output_forget(curr);
+        curr = curr->next;
+    }
+}
+
+/**
+ * Reads the outputs query_set_checkpoint wrote to file, as far as file goes,
+ *   and unlinks the runs each named that no output of set holds. file is
+ *   from a checkpoint cut short before it replaced the last one, so no
+ *   checkpoint in place names those runs.
+ */
+void query_set_discard(query_set_t *set, FILE *file) {
+    int out_c = 0;
+    output_err ret = OUTPUT_ERR_NONE;
+
+    errno = 0;
+    if (fscanf(file, "%d", &out_c) != 1 || fgetc(file) != '\n') {
+        ret = OUTPUT_ERR_OPEN;
+    }
+    for (int i = 0; i < out_c && ret == OUTPUT_ERR_NONE; i++) {
+        ret = output_discard(set->outputs, file);
+    }
+}
+
+/**
+ * Deletes every query's expression, closes every output and frees the
+ *   memory held by set, including any kept buffers.
+ */
+void query_set_delete(query_set_t *set) {
+    output_t *next = NULL, *curr = set->outputs;
+
+    for (int i = 0; i < set->query_c; i++) {
+        expression_delete(&(set->queries[i].expression));
+    }
+    while (curr != NULL) {
+        next = curr->next;
+        output_close(curr);
+        curr = next;
+    }
+    arena_delete(&(set->mem));
+    free(set->queries);
+    set->queries = NULL;
+    set->query_c = 0;
+    set->query_max = 0;
+    set->outputs = NULL;
+}
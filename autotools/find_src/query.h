@@ -0,0 +1,108 @@
+#ifndef __QUERY_H
+#define __QUERY_H
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <stdio.h>
+#include <ctype.h>
+#include "expression.h"
+#include "output.h"
+
+typedef struct query query_t;
+typedef struct query_set query_set_t;
+
+// Initial number of queries a set has room for
+#define QUERY_SET_INIT_MAX 8
+// Starts a comment in a query file
+#define QUERY_FILE_COMMENT '#'
+// Room needed for the tag of a query read from a file, strlen(ULONG_MAX)+1
+#define QUERY_TAG_LEN 21
+
+// An expression and the output its matches are printed to. If tag is not NULL
+//   it is printed before each of its matches. Once done is set by a LIMIT
+//   the query is no longer evaluated.
+struct query {
+    expression_t expression;
+    output_t *out;
+    char *tag;
+    bool done;
+};
+
+// Every query evaluated against each file of a single traversal, along with
+//   the state and outputs they share.
+struct query_set {
+    prog_state state_args;
+    query_t *queries;
+    int query_c;
+    int query_max;
+    // Number of queries that are done, the traversal stops once all are.
+    int done_c;
+    output_t *outputs;
+
+    // Memory backing the primaries of every query and the args of queries
+    //   read from a file, all freed when set is deleted.
+    arena_t mem;
+
+    // Id of the file most recently evaluated, for primaries sharing results.
+    unsigned long entry_id;
+
+    // Whether outputs write paths as they are found instead of sorting them,
+    //   and the memory each sorting output may hold paths in, 0 for no limit.
+    bool stream;
+    size_t sort_memory;
+    // Whether streaming outputs append to their files rather than truncate.
+    bool append;
+};
+
+// Initializes an empty query set whose outputs stream if stream is true, or
+//   otherwise sort in at most about sort_memory bytes each. Streaming outputs
+//   append to their files if append is true. set must already be allocated.
+expr_err query_set_create(query_set_t *set, bool stream, size_t sort_memory, \
+    bool append);
+
+// Adds a query for each EXPRESSION_SEP separated expression in expr_argv, each
+//   tagged with tag. expr_argv must be NULL-terminated, and it and tag must be
+//   valid for the life of set.
+expr_err query_set_add(query_set_t *set, char **expr_argv, char *tag);
+
+// Adds the queries on each line of the file at path, tagged with their line
+//   number.
+expr_err query_set_add_file(query_set_t *set, char *path);
+
+// Helpers for query_set_add and query_set_add_file
+expr_err query_set_grow(query_set_t *set);
+expr_err query_set_bind_outputs(query_set_t *set, query_t *query);
+void query_set_share_primaries(query_set_t *set, int first);
+char** split_args(char *line, arena_t *arena);
+
+// Gets the output writing to path, opening it if no query uses it yet. A NULL
+//   path is stdout.
+output_t* query_set_get_output(query_set_t *set, char *path);
+
+// Evaluates every query against entry, adding it to the output of each query
+//   that prints it, then writes out any streaming output whose deadline has
+//   passed.
+output_err query_set_evaluate(query_set_t *set, FTSENT *entry);
+
+// Flushes every output and finishes every query's expression.
+expr_err query_set_finish(query_set_t *set);
+
+// Writes what every output of set holds to file, to be restored after a
+//   restart with the same queries.
+output_err query_set_checkpoint(query_set_t *set, char *prefix, FILE *file);
+
+// Restores the outputs of set from file, as written by query_set_checkpoint.
+output_err query_set_restore(query_set_t *set, FILE *file);
+
+// Removes runs that were kept for a checkpoint no longer in use.
+void query_set_forget(query_set_t *set);
+
+// Removes the runs named in file by a query_set_checkpoint that was never
+//   put in place, unless set still holds them.
+void query_set_discard(query_set_t *set, FILE *file);
+
+// Deletes every query and closes every output.
+void query_set_delete(query_set_t *set);
+
+#endif /* __QUERY_H */
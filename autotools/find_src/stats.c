@@ -0,0 +1,70 @@
+/**
+ * Instrumentation for --stats. The modules doing the work count what they do
+ *   in find_stats as they go: entries and directories walked, stat calls,
+ *   directories queued for prefetching and prefetched, -exec children
+ *   started, comparisons made sorting and bytes written. Phases are timed by
+ *   bracketing them with stats_begin and stats_end, which only read the clock
+ *   once stats are enabled, so a run without --stats pays for nothing but a
+ *   few increments. Per-primary counts are kept in the
+ *   expressions themselves.
+ * Each thread has its own counters, so libfind traversals run on different
+ *   threads neither race on them nor count each other's work.
+ */
+#include "stats.h"
+
+_Thread_local stats_t find_stats;
+
+const char *const stats_phase_map[] = {
+    "walk",
+    "evaluate",
+    "exec",
+    "sort",
+    "output",
+    "stat"
+};
+
+/**
+ * Enables timing and starts the clock of the run.
+ */
+void stats_enable(void) {
+    find_stats.enabled = true;
+    clock_gettime(CLOCK_MONOTONIC, &(find_stats.start));
+}
+
+/**
+ * Reads the clock into start if stats are enabled.
+ */
+void stats_begin(struct timespec *start) {
+    if (find_stats.enabled) {
+        clock_gettime(CLOCK_MONOTONIC, start);
+    }
+}
+
+/**
+ * Adds the nanoseconds since start to phase if stats are enabled.
+ */
+void stats_end(stats_phase phase, struct timespec *start) {
+    struct timespec end;
+
+    if (find_stats.enabled) {
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        find_stats.phase_ns[phase] += \
+            (end.tv_sec - start->tv_sec) * 1000000000LL + \
+            (end.tv_nsec - start->tv_nsec);
+    }
+}
+
+/**
+ * Returns the nanoseconds since stats were enabled, or 0 if they aren't.
+ */
+long long stats_total_ns(void) {
+    struct timespec end;
+    long long ret = 0;
+
+    if (find_stats.enabled) {
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        ret = (end.tv_sec - find_stats.start.tv_sec) * 1000000000LL + \
+            (end.tv_nsec - find_stats.start.tv_nsec);
+    }
+    return ret;
+}
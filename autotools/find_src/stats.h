@@ -0,0 +1,59 @@
+#ifndef __STATS_H
+#define __STATS_H
+#include <stdbool.h>
+#include <time.h>
+
+typedef struct stats_s stats_t;
+typedef enum stats_phase stats_phase;
+
+// Phases of a run timed by --stats. Time spent running -exec children is
+//   also part of evaluation, and sorting part of output when it happens while
+//   paths are written out. The stat calls of a streaming walk are also part
+//   of walking, while those fts makes can't be told apart from it.
+enum stats_phase {
+    STATS_WALK   = 0,
+    STATS_EVAL   = 1,
+    STATS_EXEC   = 2,
+    STATS_SORT   = 3,
+    STATS_OUTPUT = 4,
+    STATS_STAT   = 5,
+    STATS_PHASE_NUM = 6
+};
+
+// Counters of a run. They are cheap enough to always be kept, but phases are
+//   only timed if enabled, as reading the clock is not.
+struct stats_s {
+    bool enabled;
+    struct timespec start;
+
+    unsigned long entries;
+    unsigned long dirs;
+    unsigned long stat_calls;
+    unsigned long prefetch_queued;
+    unsigned long prefetched;
+    unsigned long matches;
+    unsigned long exec_c;
+    unsigned long long compares;
+    unsigned long long bytes;
+    long long phase_ns[STATS_PHASE_NUM];
+};
+
+// The counters of the traversals run by the calling thread, which for find
+//   are those of its one run
+extern _Thread_local stats_t find_stats;
+// Maps a phase to its name when printed
+extern const char *const stats_phase_map[];
+
+// Starts timing phases, and the run as a whole.
+void stats_enable(void);
+
+// Sets start to now if phases are timed.
+void stats_begin(struct timespec *start);
+
+// Adds the time since start to phase if phases are timed.
+void stats_end(stats_phase phase, struct timespec *start);
+
+// Returns the nanoseconds since the run started, 0 if it isn't timed.
+long long stats_total_ns(void);
+
+#endif /* __STATS_H */
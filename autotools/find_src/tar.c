@@ -0,0 +1,481 @@
+/**
+ * Lists the members of uncompressed tar archives, for find to descend into
+ *   an archive as if it were a directory. Only headers are read, one block
+ *   at a time in archive order, and the contents of each member are seeked
+ *   over, so listing an archive reads about one block per member however
+ *   large it is. Each member gets an entry like a file of a streaming walk
+ *   would, with a path below the archive's and a stat struct filled in from
+ *   its header: its type, permissions, owner, size and modification time,
+ *   and the target of a symbolic link kept for tar_readlink.
+ * A member's path doesn't exist on disk, so its entry points to the archive
+ *   with fts_pointer to tell it apart from a file. The builtins of -exec give
+ *   way to the command they stand for on such entries, so the answer is the
+ *   one the command gets for the path.
+ * Headers are ustar, with its prefix field, or old style tar, along with the
+ *   GNU long name and link name and the path, linkpath, size and mtime
+ *   records of pax headers. An
+ *   archive ends at its first zero or invalid header, so a file that only
+ *   happens to end in TAR_SUFFIX lists no members.
+ */
+#include "tar.h"
+
+/**
+ * Checks that entry is a regular file whose name ends in TAR_SUFFIX.
+ * Returns true if it is to be listed and false otherwise.
+ */
+bool tar_is_archive(FTSENT *entry) {
+    size_t suffix_len = strlen(TAR_SUFFIX);
+
+    return entry->fts_info == FTS_F && entry->fts_namelen > suffix_len && \
+        strcmp(entry->fts_name + entry->fts_namelen - suffix_len, \
+        TAR_SUFFIX) == 0;
+}
+
+/**
+ * Opens the archive at entry's path and sets up tar to build the paths of
+ *   its members on it.
+ * Returns 0 on success and -1 if the archive can't be opened or memory
+ *   allocation fails, with errno set.
+ */
+int tar_open(tar_t *tar, FTSENT *entry) {
+    int ret = 0;
+
+    tar->level = entry->fts_level;
+    tar->dev = entry->fts_statp->st_dev;
+    tar->long_name = NULL;
+    tar->long_link = NULL;
+    tar->pax_size = -1;
+    tar->pax_mtime = -1;
+    tar->archive_len = strlen(entry->fts_path);
+    tar->path_max = TAR_PATH_INIT_MAX;
+    while (tar->path_max < tar->archive_len + 2) {
+        tar->path_max *= 2;
+    }
+    tar->entry = NULL;
+    tar->link_len = 0;
+    errno = 0;
+    tar->path = malloc(tar->path_max);
+    tar->fd = open(entry->fts_accpath, O_RDONLY | O_CLOEXEC);
+    if (tar->path == NULL || tar->fd < 0 || \
+            (tar->entry = calloc(1, sizeof(FTSENT) + NAME_MAX + 1)) == NULL) {
+        tar_close(tar);
+        ret = -1;
+    }
+    else {
+        memcpy(tar->path, entry->fts_path, tar->archive_len + 1);
+        posix_fadvise(tar->fd, 0, 0, POSIX_FADV_RANDOM);
+        tar->entry->fts_pointer = tar;
+    }
+    return ret;
+}
+
+/**
+ * Reads headers until one of a member, skipping over the contents of each,
+ *   and applying GNU long names and link names and pax headers to the member
+ *   after them.
+ *   Members whose path is empty, like "./", are passed over.
+ * Returns the member's entry, or NULL at the end of the archive or if
+ *   reading it fails, with errno set in the latter case.
+ */
+FTSENT* tar_read(tar_t *tar) {
+    unsigned char block[TAR_BLOCK];
+    char *meta = NULL, type = '\0';
+    long long size = 0;
+    FTSENT *ret = NULL;
+    bool done = false;
+
+    while (ret == NULL && !done) {
+        errno = 0;
+        if (tar_read_block(tar, block) <= 0 || !tar_check(block) || \
+                (size = tar_number(block + TAR_SIZE, TAR_NUM_LEN)) < 0) {
+            done = true;
+        }
+        else if ((type = block[TAR_TYPE]) == 'L' || type == 'K' || \
+                type == 'x') {
+            meta = tar_read_meta(tar, size);
+            if (meta == NULL && errno) {
+                done = true;
+            }
+            else if (type == 'L' && meta != NULL) {
+                free(tar->long_name);
+                tar->long_name = meta;
+            }
+            else if (type == 'K' && meta != NULL) {
+                free(tar->long_link);
+                tar->long_link = meta;
+            }
+            else if (meta != NULL) {
+                tar_parse_pax(tar, meta, size);
+                free(meta);
+            }
+        }
+        else {
+            if (tar->pax_size >= 0) {
+                size = tar->pax_size;
+            }
+            if (type != '0' && type != '\0' && type != '7' && \
+                    tar_type(type) != 0) {
+                size = 0;
+            }
+            ret = tar_type(type) != 0 ? tar_set_entry(tar, block, size) : NULL;
+            if (ret == NULL && errno) {
+                done = true;
+            }
+            else if (tar_skip(tar, size) < 0) {
+                ret = NULL;
+                done = true;
+            }
+            if (tar_type(type) != 0) {
+                free(tar->long_name);
+                free(tar->long_link);
+                tar->long_name = NULL;
+                tar->long_link = NULL;
+                tar->pax_size = -1;
+                tar->pax_mtime = -1;
+            }
+        }
+    }
+    return ret;
+}
+
+/**
+ * Copies up to len bytes of the target of the symbolic link last read by tar
+ *   into buf, without a '\0', as readlink(2) does.
+ * Returns the number of bytes copied, or -1 with errno set to EINVAL if the
+ *   member isn't a symbolic link.
+ */
+ssize_t tar_readlink(tar_t *tar, char *buf, size_t len) {
+    ssize_t ret = -1;
+
+    if (tar->entry == NULL || !S_ISLNK(tar->st.st_mode)) {
+        errno = EINVAL;
+    }
+    else {
+        ret = tar->link_len < len ? tar->link_len : len;
+        memcpy(buf, tar->link, ret);
+    }
+    return ret;
+}
+
+/**
+ * Closes tar's archive and frees its buffers.
+ */
+void tar_close(tar_t *tar) {
+    if (tar->fd >= 0) {
+        close(tar->fd);
+    }
+    free(tar->long_name);
+    free(tar->long_link);
+    free(tar->path);
+    free(tar->entry);
+    tar->fd = -1;
+    tar->long_name = NULL;
+    tar->long_link = NULL;
+    tar->path = NULL;
+    tar->entry = NULL;
+}
+
+/**
+ * Reads the next TAR_BLOCK bytes of tar's archive into block.
+ * Returns 1 if a whole block was read, 0 if the archive ended first and -1
+ *   if reading failed.
+ */
+int tar_read_block(tar_t *tar, unsigned char *block) {
+    ssize_t n = 1;
+    size_t len = 0;
+    int ret = 1;
+
+    while (ret == 1 && len < TAR_BLOCK) {
+        errno = 0;
+        n = read(tar->fd, block + len, TAR_BLOCK - len);
+        if (n < 0 && errno != EINTR) {
+            ret = -1;
+        }
+        else if (n == 0) {
+            ret = 0;
+        }
+        else if (n > 0) {
+            len += n;
+        }
+    }
+    return ret;
+}
+
+/**
+ * Checks the checksum of the header in block, the sum of its bytes with the
+ *   checksum's own taken as spaces, either unsigned or signed as some old
+ *   tars computed it. A block of zeros, which ends an archive, fails.
+ * Returns true if the header is valid and false otherwise.
+ */
+bool tar_check(unsigned char *block) {
+    long long sum = tar_number(block + TAR_CHKSUM, TAR_CHKSUM_LEN);
+    long unsigned_sum = 0, signed_sum = 0;
+
+    for (int i = 0; i < TAR_BLOCK; i++) {
+        if (i >= TAR_CHKSUM && i < TAR_CHKSUM + TAR_CHKSUM_LEN) {
+            unsigned_sum += ' ';
+            signed_sum += ' ';
+        }
+        else {
+            unsigned_sum += block[i];
+            signed_sum += (signed char)block[i];
+        }
+    }
+    return sum > 0 && (sum == unsigned_sum || sum == signed_sum);
+}
+
+/**
+ * Parses the numeric header field of len bytes at field, either octal
+ *   digits, optionally led by spaces and ended by a space or '\0', or the GNU
+ *   base-256 form marked by the high bit of its first byte.
+ * Returns the number, or -1 if it is negative or too large.
+ */
+long long tar_number(unsigned char *field, size_t len) {
+    long long ret = 0;
+    size_t i = 0;
+
+    if (field[0] & 0x80) {
+        ret = field[0] & 0x40 ? -1 : field[0] & 0x3f;
+        for (i = 1; i < len && ret >= 0; i++) {
+            ret = ret > (LLONG_MAX >> 8) ? -1 : (ret << 8) | field[i];
+        }
+    }
+    else {
+        while (i < len && field[i] == ' ') {
+            i++;
+        }
+        for (; i < len && field[i] >= '0' && field[i] <= '7' && ret >= 0; \
+                i++) {
+            ret = ret > (LLONG_MAX >> 3) ? -1 : (ret << 3) | (field[i] - '0');
+        }
+    }
+    return ret;
+}
+
+/**
+ * Reads the size bytes of a GNU long name or pax header, which follow its
+ *   header, and skips their padding. Contents larger than TAR_META_MAX are
+ *   skipped over.
+ * Returns the contents, '\0' terminated, NULL if they were skipped, or NULL
+ *   with errno set if reading fails or memory allocation fails.
+ */
+char* tar_read_meta(tar_t *tar, long long size) {
+    char *ret = NULL;
+    ssize_t n = 1;
+    long long len = 0;
+
+    errno = 0;
+    if (size <= TAR_META_MAX && (ret = malloc(size + 1)) != NULL) {
+        while (n > 0 && len < size) {
+            n = read(tar->fd, ret + len, size - len);
+            len += n > 0 ? n : 0;
+        }
+        ret[len] = '\0';
+        if (len < size) {
+            free(ret);
+            ret = NULL;
+            if (errno == 0) {
+                errno = EINVAL;
+            }
+        }
+        else if (lseek(tar->fd, -size & (TAR_BLOCK - 1), SEEK_CUR) < 0) {
+            free(ret);
+            ret = NULL;
+        }
+    }
+    else if (size > TAR_META_MAX) {
+        tar_skip(tar, size);
+    }
+    return ret;
+}
+
+/**
+ * Reads the records of a pax extended header, each "length key=value\n",
+ *   keeping the path, linkpath, size and mtime for the next member.
+ */
+void tar_parse_pax(tar_t *tar, char *records, long long size) {
+    char *record = records, *key = NULL, *value = NULL, *end = NULL;
+    long len = 0;
+
+    while (record < records + size) {
+        len = strtol(record, &key, 10);
+        if (len <= 0 || len > records + size - record || *key != ' ' || \
+                record[len - 1] != '\n') {
+            record = records + size;
+        }
+        else {
+            record[len - 1] = '\0';
+            key++;
+            value = strchr(key, '=');
+            if (value != NULL) {
+                *(value++) = '\0';
+                if (strcmp(key, "path") == 0) {
+                    free(tar->long_name);
+                    tar->long_name = strdup(value);
+                }
+                else if (strcmp(key, "linkpath") == 0) {
+                    free(tar->long_link);
+                    tar->long_link = strdup(value);
+                }
+                else if (strcmp(key, "size") == 0) {
+                    tar->pax_size = strtoll(value, &end, 10);
+                }
+                else if (strcmp(key, "mtime") == 0) {
+                    tar->pax_mtime = strtoll(value, &end, 10);
+                }
+            }
+            record += len;
+        }
+    }
+}
+
+/**
+ * Seeks past size bytes of member contents and their padding to a whole
+ *   block.
+ * Returns 0 on success and -1 on failure.
+ */
+int tar_skip(tar_t *tar, long long size) {
+    int ret = 0;
+
+    size += -size & (TAR_BLOCK - 1);
+    errno = 0;
+    if (size > 0 && lseek(tar->fd, size, SEEK_CUR) < 0) {
+        ret = -1;
+    }
+    return ret;
+}
+
+/**
+ * Builds the path of the member whose header is block, below the archive's,
+ *   from the long name if there is one and otherwise from the ustar prefix
+ *   and name. Leading "./" and '/' and trailing '/' are dropped. Its stat
+ *   struct is filled in from the header, with size bytes, and the target of
+ *   a symbolic link is kept from the long link name or the header.
+ * Returns the member's entry, or NULL if its path is empty, or if memory
+ *   allocation fails with errno set.
+ */
+FTSENT* tar_set_entry(tar_t *tar, unsigned char *block, long long size) {
+    char name[TAR_PREFIX_LEN + TAR_NAME_LEN + 2], *member = name, *path = NULL;
+    char *base = NULL;
+    FTSENT *ret = tar->entry;
+    size_t len = 0, path_max = tar->path_max;
+    int level = tar->level + 1;
+
+    if (tar->long_name != NULL) {
+        member = tar->long_name;
+    }
+    else if (memcmp(block + TAR_MAGIC, "ustar", 5) == 0 && \
+            block[TAR_PREFIX] != '\0') {
+        len = strnlen((char*)block + TAR_PREFIX, TAR_PREFIX_LEN);
+        memcpy(name, block + TAR_PREFIX, len);
+        name[len++] = '/';
+    }
+    if (member == name) {
+        memcpy(name + len, block + TAR_NAME, TAR_NAME_LEN);
+        name[len + strnlen((char*)block + TAR_NAME, TAR_NAME_LEN)] = '\0';
+    }
+    while (member[0] == '/' || (member[0] == '.' && member[1] == '/')) {
+        member += member[0] == '/' ? 1 : 2;
+    }
+    len = strlen(member);
+    while (len > 0 && member[len - 1] == '/') {
+        len--;
+    }
+    errno = 0;
+    while (tar->archive_len + len + 2 > path_max) {
+        path_max *= 2;
+    }
+    if (len == 0 || (member[0] == '.' && len == 1)) {
+        ret = NULL;
+    }
+    else if (path_max > tar->path_max && \
+            (path = realloc(tar->path, path_max)) == NULL) {
+        ret = NULL;
+    }
+    else {
+        if (path != NULL) {
+            tar->path = path;
+            tar->path_max = path_max;
+        }
+        tar->path[tar->archive_len] = '/';
+        memcpy(tar->path + tar->archive_len + 1, member, len);
+        tar->path[tar->archive_len + 1 + len] = '\0';
+        base = tar->path + tar->archive_len + 1;
+        for (char *c = base; *c != '\0'; c++) {
+            if (*c == '/') {
+                base = c + 1;
+                level++;
+            }
+        }
+
+        memset(&(tar->st), 0, sizeof(struct stat));
+        tar->st.st_mode = tar_type(block[TAR_TYPE]) | \
+            (tar_number(block + TAR_MODE, TAR_ID_LEN) & 07777);
+        tar->st.st_uid = tar_number(block + TAR_UID, TAR_ID_LEN);
+        tar->st.st_gid = tar_number(block + TAR_GID, TAR_ID_LEN);
+        tar->st.st_size = size;
+        tar->st.st_blocks = (size + TAR_BLOCK - 1) / TAR_BLOCK;
+        tar->st.st_mtime = tar->pax_mtime >= 0 ? tar->pax_mtime : \
+            tar_number(block + TAR_MTIME, TAR_NUM_LEN);
+        tar->st.st_atime = tar->st.st_mtime;
+        tar->st.st_ctime = tar->st.st_mtime;
+        tar->st.st_nlink = 1;
+        tar->st.st_dev = tar->dev;
+        tar->link_len = 0;
+        if (S_ISLNK(tar->st.st_mode) && tar->long_link != NULL) {
+            tar->link_len = strnlen(tar->long_link, PATH_MAX);
+            memcpy(tar->link, tar->long_link, tar->link_len);
+        }
+        else if (S_ISLNK(tar->st.st_mode)) {
+            tar->link_len = strnlen((char*)block + TAR_LINKNAME, \
+                TAR_LINKNAME_LEN);
+            memcpy(tar->link, block + TAR_LINKNAME, tar->link_len);
+        }
+
+        ret->fts_path = tar->path;
+        ret->fts_accpath = tar->path;
+        ret->fts_pathlen = tar->archive_len + 1 + len;
+        ret->fts_namelen = strlen(base) > NAME_MAX ? NAME_MAX : strlen(base);
+        memcpy(ret->fts_name, base, ret->fts_namelen);
+        ret->fts_name[ret->fts_namelen] = '\0';
+        ret->fts_level = level;
+        ret->fts_info = walk_info(&(tar->st));
+        ret->fts_errno = 0;
+        ret->fts_statp = &(tar->st);
+    }
+    return ret;
+}
+
+/**
+ * Maps the type flag of a member to the file type bits of st_mode. Hard
+ *   links are listed as the regular files they link to.
+ * Returns the bits, or 0 for a header that isn't of a member.
+ */
+mode_t tar_type(char type) {
+    mode_t ret = 0;
+
+    switch (type) {
+    case '\0':
+    case '0':
+    case '1':
+    case '7':
+        ret = S_IFREG;
+        break;
+    case '2':
+        ret = S_IFLNK;
+        break;
+    case '3':
+        ret = S_IFCHR;
+        break;
+    case '4':
+        ret = S_IFBLK;
+        break;
+    case '5':
+        ret = S_IFDIR;
+        break;
+    case '6':
+        ret = S_IFIFO;
+        break;
+    }
+    return ret;
+}
@@ -0,0 +1,100 @@
+#ifndef __TAR_H
+#define __TAR_H
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <limits.h>
+#include <fts.h>
+#include "walk.h"
+
+// Name a file must end in to be listed as an archive
+#define TAR_SUFFIX ".tar"
+// Size of a header, and the unit member contents are padded to
+#define TAR_BLOCK 512
+// Largest GNU long name or pax header read, anything larger is skipped
+#define TAR_META_MAX (1 << 20)
+// Initial bytes of the path being built
+#define TAR_PATH_INIT_MAX 256
+
+// Offsets and lengths of the fields of a ustar header used
+#define TAR_NAME 0
+#define TAR_NAME_LEN 100
+#define TAR_MODE 100
+#define TAR_UID 108
+#define TAR_GID 116
+#define TAR_ID_LEN 8
+#define TAR_SIZE 124
+#define TAR_MTIME 136
+#define TAR_NUM_LEN 12
+#define TAR_CHKSUM 148
+#define TAR_CHKSUM_LEN 8
+#define TAR_TYPE 156
+#define TAR_LINKNAME 157
+#define TAR_LINKNAME_LEN 100
+#define TAR_MAGIC 257
+#define TAR_PREFIX 345
+#define TAR_PREFIX_LEN 155
+
+typedef struct tar_s tar_t;
+
+// A sequential read of the headers of an uncompressed tar archive. Member
+//   contents are skipped over, never read. The GNU long name and link name
+//   and the pax path and linkpath, if the last headers gave them, apply to
+//   the next member. The entry of each member points back to tar with
+//   fts_pointer.
+struct tar_s {
+    int fd;
+    int level;
+    dev_t dev;
+    char *long_name;
+    char *long_link;
+    long long pax_size;
+    time_t pax_mtime;
+    // Path of the member last read, which starts with the archive's path, and
+    //   the entry returned for it.
+    char *path;
+    size_t path_max;
+    size_t archive_len;
+    FTSENT *entry;
+    struct stat st;
+    // Target of the member last read if it is a symbolic link, cut to
+    //   PATH_MAX bytes, and link_len 0 otherwise.
+    char link[PATH_MAX];
+    size_t link_len;
+};
+
+// Determines if entry is a file to be listed as an archive.
+bool tar_is_archive(FTSENT *entry);
+
+// Opens the archive entry for reading its headers. Its members are given
+//   paths below the archive's, as if it were a directory.
+int tar_open(tar_t *tar, FTSENT *entry);
+
+// Returns an entry for the next member of the archive, NULL at its end or
+//   on error, with errno set in the latter case. The entry is valid until the
+//   next call.
+FTSENT* tar_read(tar_t *tar);
+
+// Copies the target of the symbolic link last read by tar into buf, like
+//   readlink(2) does for a file.
+ssize_t tar_readlink(tar_t *tar, char *buf, size_t len);
+
+// Closes the archive and frees tar's memory.
+void tar_close(tar_t *tar);
+
+// Helpers for tar_read
+int tar_read_block(tar_t *tar, unsigned char *block);
+bool tar_check(unsigned char *block);
+long long tar_number(unsigned char *field, size_t len);
+char* tar_read_meta(tar_t *tar, long long size);
+void tar_parse_pax(tar_t *tar, char *records, long long size);
+int tar_skip(tar_t *tar, long long size);
+FTSENT* tar_set_entry(tar_t *tar, unsigned char *block, long long size);
+mode_t tar_type(char type);
+
+#endif /* __TAR_H */
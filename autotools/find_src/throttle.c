@@ -0,0 +1,125 @@
+/**
+ * Throttling of the file system operations a traversal makes, so a scan can
+ *   run alongside a busy workload. Every directory read and stat call takes a
+ *   token from a bucket refilled at a fixed rate, sleeping until one is
+ *   available, and the bucket holds up to THROTTLE_BURST_SEC worth of them.
+ * Given a target latency, the rate is instead driven by how long the
+ *   operations themselves take, which is how loaded the file system is.
+ *   After every THROTTLE_WINDOW operations the THROTTLE_PERCENTILE of their
+ *   latency is compared against the target, raising the rate by a fixed step
+ *   if it is within it and cutting it by a fraction if not. The traversal
+ *   makes one operation at a time, so the rate stands in for the number of
+ *   operations in flight.
+ */
+#include "throttle.h"
+
+/**
+ * Initializes throttle with a full bucket. An adaptive throttle without a
+ *   rate starts at THROTTLE_INIT_RATE and has no limit.
+ */
+void throttle_create(throttle_t *throttle, double rate, long target_ns) {
+    throttle->max_rate = rate;
+    throttle->rate = rate;
+    if (rate == 0) {
+        throttle->rate = THROTTLE_INIT_RATE;
+    }
+    throttle->tokens = throttle->rate * THROTTLE_BURST_SEC;
+    throttle->target_ns = target_ns;
+    throttle->sample_c = 0;
+    clock_gettime(CLOCK_MONOTONIC, &(throttle->last));
+}
+
+/**
+ * Refills throttle's bucket for the time since it was last refilled and takes
+ *   a token, first sleeping for as long as it takes for one to be added if
+ *   the bucket is empty.
+ */
+void throttle_acquire(throttle_t *throttle, struct timespec *start) {
+    struct timespec wait;
+    double burst = 0, wait_sec = 0;
+
+    if (throttle != NULL) {
+        clock_gettime(CLOCK_MONOTONIC, start);
+        burst = throttle->rate * THROTTLE_BURST_SEC;
+        if (burst < 1) {
+            burst = 1;
+        }
+        throttle->tokens += elapsed_ns(&(throttle->last), start) * \
+            throttle->rate / NSEC_PER_SEC;
+        if (throttle->tokens > burst) {
+            throttle->tokens = burst;
+        }
+        throttle->last = *start;
+        if (throttle->tokens < 1) {
+            wait_sec = (1 - throttle->tokens) / throttle->rate;
+            wait.tv_sec = (time_t)wait_sec;
+            wait.tv_nsec = (long)((wait_sec - wait.tv_sec) * NSEC_PER_SEC);
+            while (nanosleep(&wait, &wait) < 0 && errno == EINTR);
+            clock_gettime(CLOCK_MONOTONIC, start);
+            throttle->tokens += elapsed_ns(&(throttle->last), start) * \
+                throttle->rate / NSEC_PER_SEC;
+            throttle->last = *start;
+        }
+        throttle->tokens--;
+    }
+}
+
+/**
+ * Adds the time since start to throttle's window if it adapts, adjusting the
+ *   rate once the window is full.
+ */
+void throttle_release(throttle_t *throttle, struct timespec *start) {
+    struct timespec end;
+
+    if (throttle != NULL && throttle->target_ns > 0) {
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        throttle->samples[throttle->sample_c++] = elapsed_ns(start, &end);
+        if (throttle->sample_c == THROTTLE_WINDOW) {
+            throttle_adapt(throttle);
+            throttle->sample_c = 0;
+        }
+    }
+}
+
+/**
+ * Sorts throttle's window and compares its THROTTLE_PERCENTILE against the
+ *   target, raising the rate additively if it is within it and lowering it
+ *   multiplicatively otherwise, within THROTTLE_MIN_RATE and max_rate.
+ */
+void throttle_adapt(throttle_t *throttle) {
+    long latency = 0;
+
+    qsort(throttle->samples, THROTTLE_WINDOW, sizeof(long), compare_long);
+    latency = throttle->samples[THROTTLE_WINDOW * THROTTLE_PERCENTILE / 100];
+    if (latency <= throttle->target_ns) {
+        throttle->rate += THROTTLE_STEP;
+        if (throttle->max_rate > 0 && throttle->rate > throttle->max_rate) {
+            throttle->rate = throttle->max_rate;
+        }
+    }
+    else {
+        throttle->rate *= THROTTLE_DECREASE;
+        if (throttle->rate < THROTTLE_MIN_RATE) {
+            throttle->rate = THROTTLE_MIN_RATE;
+        }
+    }
+}
+
+/**
+ * Compares the longs a and b point to, for qsort.
+ * Returns a negative number, 0 or a positive number if a is less than, equal
+ *   to or greater than b respectively.
+ */
+int compare_long(const void *a, const void *b) {
+    long x = *(const long*)a, y = *(const long*)b;
+
+    return (x > y) - (x < y);
+}
+
+/**
+ * Returns the nanoseconds from start to end.
+ */
+long elapsed_ns(struct timespec *start, struct timespec *end) {
+    return (end->tv_sec - start->tv_sec) * NSEC_PER_SEC + \
+        (end->tv_nsec - start->tv_nsec);
+}
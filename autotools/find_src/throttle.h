@@ -0,0 +1,58 @@
+#ifndef __THROTTLE_H
+#define __THROTTLE_H
+#include <stdlib.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <time.h>
+
+// Seconds of operations a full bucket holds, so short bursts aren't delayed
+#define THROTTLE_BURST_SEC 0.1
+// Latency samples gathered before the adaptive rate is adjusted, and the
+//   percentile of them compared against the target
+#define THROTTLE_WINDOW 128
+#define THROTTLE_PERCENTILE 95
+// Rate an adaptive throttle without a limit starts at, how much it is raised
+//   after a window within the target and how much of it is kept after one
+//   that isn't, never going under THROTTLE_MIN_RATE
+#define THROTTLE_INIT_RATE 1000.0
+#define THROTTLE_STEP 500.0
+#define THROTTLE_DECREASE 0.5
+#define THROTTLE_MIN_RATE 10.0
+#define NSEC_PER_SEC 1000000000L
+
+typedef struct throttle_s throttle_t;
+
+// A token bucket limiting file system operations to rate per second. If
+//   target_ns is not 0 the rate adapts to the operations' latency, rising by
+//   THROTTLE_STEP while the THROTTLE_PERCENTILE of a window is within the
+//   target and falling by THROTTLE_DECREASE when it is not, up to max_rate if
+//   it is not 0.
+struct throttle_s {
+    double rate;
+    double max_rate;
+    double tokens;
+    struct timespec last;
+
+    long target_ns;
+    long samples[THROTTLE_WINDOW];
+    int sample_c;
+};
+
+// Initializes throttle to allow rate operations per second, or any number if
+//   rate is 0, adapting to a latency of target_ns if it is not 0.
+void throttle_create(throttle_t *throttle, double rate, long target_ns);
+
+// Waits until throttle allows another operation, then sets start to the time
+//   it begins. Does nothing if throttle is NULL.
+void throttle_acquire(throttle_t *throttle, struct timespec *start);
+
+// Records the latency of the operation that began at start, adjusting the
+//   rate once a window is full. Does nothing if throttle is NULL.
+void throttle_release(throttle_t *throttle, struct timespec *start);
+
+// Helpers for throttle_release
+void throttle_adapt(throttle_t *throttle);
+int compare_long(const void *a, const void *b);
+long elapsed_ns(struct timespec *start, struct timespec *end);
+
+#endif /* __THROTTLE_H */
@@ -0,0 +1,814 @@
+/**
+ * Traversal of the file tree. By default this is fts, which reads every entry
+ *   of a directory into memory before returning the first one. For
+ *   directories with millions of files that costs gigabytes, and nothing is
+ *   found until the whole listing has been read.
+ * A streaming walk instead reads each directory with getdents64 in chunks of
+ *   WALK_BUF_SIZE, returning every file as soon as its chunk is read. Only
+ *   subdirectories are queued, to be descended into once the directory has
+ *   been read, so memory only grows with the number of subdirectories. Since
+ *   a directory is read to the end before any subdirectory is opened, only
+ *   one directory is ever open, and one buffer serves them all.
+ * Entries are returned as FTSENTs filled in as fts would, in preorder with
+ *   each directory returned again as FTS_DP once everything below it has been
+ *   returned, so the rest of find doesn't need to know which walk it is
+ *   given. Within a directory files come before its subdirectories, but
+ *   sorted output is unaffected.
+ * A streaming walk can also stat the files of each chunk in the order of their
+ *   inode numbers rather than the order they are listed in. On ext4 and XFS
+ *   inodes are laid out in tables by number, so on rotational or networked
+ *   storage this turns a chunk's worth of random reads into one pass. The
+ *   files are still returned in the order they are listed. fts stats every
+ *   file itself as it reads a directory, so only a streaming walk can.
+ * A streaming walk can also have a helper thread read the subdirectories of
+ *   each directory it finishes reading, so they are cached by the time it
+ *   descends into them.
+ * Either walk can be throttled. A streaming walk takes a token for every
+ *   chunk it reads and every stat call it makes, while fts, which does both
+ *   out of sight, takes one for every entry it returns.
+ */
+#include "walk.h"
+
+/**
+ * Opens a traversal of the tree rooted at file, physical and without changing
+ *   the working directory. A streaming walk allocates its buffers here and
+ *   reads the root on the first walk_read. throttle must be valid until walk
+ *   is closed.
+ * Returns 0 on success and -1 on failure, with errno set.
+ */
+int walk_open(walk_t *walk, char *file, bool stream, throttle_t *throttle) {
+    char *files[] = {file, NULL};
+    size_t len = strlen(file);
+    int ret = 0;
+
+    walk->file_tree = NULL;
+    walk->throttle = throttle;
+    walk->stream = stream;
+    walk->frames = NULL;
+    walk->frame_c = 0;
+    walk->frame_max = 0;
+    walk->buf = NULL;
+    walk->buf_len = 0;
+    walk->buf_pos = 0;
+    walk->path = NULL;
+    walk->path_max = len + 1 > WALK_NAMES_INIT_MAX ? len + 1 : \
+        WALK_NAMES_INIT_MAX;
+    walk->entry = NULL;
+    walk->descend = false;
+    walk->skipped = false;
+    walk->root = true;
+    walk->inode_order = false;
+    walk->stats = NULL;
+    walk->stat_c = 0;
+    walk->stat_i = 0;
+    walk->prefetch = NULL;
+
+    errno = 0;
+    if (!stream) {
+        walk->file_tree = fts_open(files, FTS_PHYSICAL | FTS_NOCHDIR, NULL);
+        if (walk->file_tree == NULL) {
+            ret = -1;
+        }
+    }
+    else if ((walk->buf = malloc(WALK_BUF_SIZE)) == NULL || \
+            (walk->path = malloc(walk->path_max)) == NULL || \
+            (walk->entry = calloc(1, sizeof(FTSENT) + \
+            (len > NAME_MAX ? len : NAME_MAX) + 1)) == NULL) {
+        walk_close(walk);
+        ret = -1;
+    }
+    else {
+        memcpy(walk->path, file, len + 1);
+        walk->entry->fts_pathlen = len;
+        walk->entry->fts_statp = &(walk->st);
+    }
+    return ret;
+}
+
+/**
+ * Reads the next entry with fts, or with the streaming walk.
+ * Returns the entry, or NULL once the traversal is over or on failure, in
+ *   which case errno is set.
+ */
+FTSENT* walk_read(walk_t *walk) {
+    struct timespec start;
+    FTSENT *ret = NULL;
+
+    if (walk->file_tree != NULL) {
+        throttle_acquire(walk->throttle, &start);
+        ret = fts_read(walk->file_tree);
+        throttle_release(walk->throttle, &start);
+        if (ret != NULL && ret->fts_info != FTS_DP) {
+            find_stats.stat_calls++;
+        }
+    }
+    else {
+        ret = walk_stream_read(walk);
+    }
+    return ret;
+}
+
+/**
+ * Keeps entry, a directory just returned by walk_read, from being descended
+ *   into. As with fts it is returned again as FTS_DP next.
+ */
+void walk_skip(walk_t *walk, FTSENT *entry) {
+    if (walk->file_tree != NULL) {
+        fts_set(walk->file_tree, entry, FTS_SKIP);
+    }
+    else if (walk->descend) {
+        walk->descend = false;
+        walk->skipped = true;
+    }
+}
+
+/**
+ * Counts the subdirectories queued in every frame of a streaming walk, along
+ *   with the directory last returned if it is waiting to be descended into.
+ * Returns the count, or -1 if walk is fts.
+ */
+long walk_pending(walk_t *walk) {
+    long ret = walk->descend ? 1 : 0;
+
+    if (walk->file_tree != NULL) {
+        ret = -1;
+    }
+    for (int i = 0; i < walk->frame_c; i++) {
+        ret += walk->frames[i].sub_c - walk->frames[i].sub_i;
+    }
+    return ret;
+}
+
+/**
+ * A streaming walk's frontier can only be saved once it has started and its
+ *   top directory has been read to the end, as the files already returned
+ *   from a partly read directory can't be told apart from the rest. The
+ *   directory just returned may still be waiting to be descended into.
+ * Returns true if walk_save can be called, false otherwise.
+ */
+bool walk_can_save(walk_t *walk) {
+    return walk->file_tree == NULL && !walk->root && !walk->skipped && \
+        (walk->descend || (walk->frame_c > 0 && \
+        walk->frames[walk->frame_c - 1].fd < 0));
+}
+
+/**
+ * Writes the number of frames, then for each from the bottom a line with its
+ *   level, whether it has been read, the length of its path and the number
+ *   of subdirectories it has left, followed by its path and the names of
+ *   those subdirectories, each terminated by a '\0' so any name can be
+ *   stored. A directory waiting to be descended into is saved as an unread
+ *   frame on top. walk_can_save must be true.
+ * Returns 0 on success and -1 if writing fails.
+ */
+int walk_save(walk_t *walk, FILE *file) {
+    walk_frame *frame = NULL;
+
+    fprintf(file, "%d\n", walk->frame_c + (walk->descend ? 1 : 0));
+    for (int i = 0; i < walk->frame_c; i++) {
+        frame = &(walk->frames[i]);
+        fprintf(file, "%d 1 %zu %d\n", frame->level, frame->path_len, \
+            frame->sub_c - frame->sub_i);
+        fwrite(walk->path, 1, frame->path_len, file);
+        fputc('\0', file);
+        for (int j = frame->sub_i; j < frame->sub_c; j++) {
+            fputs(frame->names + frame->subs[j].name_off, file);
+            fputc('\0', file);
+        }
+    }
+    if (walk->descend) {
+        fprintf(file, "%d 0 %zu 0\n", walk->entry->fts_level, \
+            (size_t)walk->entry->fts_pathlen);
+        fwrite(walk->path, 1, walk->entry->fts_pathlen, file);
+        fputc('\0', file);
+    }
+    return ferror(file) ? -1 : 0;
+}
+
+/**
+ * Reads the frames saved by walk_save into walk in place of its root, which
+ *   must be the path of the bottom frame. The stat struct of each directory
+ *   is read again, and subdirectories that are gone are dropped. Unread
+ *   frames are opened to be read from the start.
+ * Returns 0 on success and -1 if file is not a valid frontier for walk, a
+ *   saved directory can't be stat'd or memory allocation fails, with errno
+ *   set.
+ */
+int walk_load(walk_t *walk, FILE *file) {
+    char *buf = NULL;
+    size_t buf_max = 0;
+    int frame_c = 0, ret = 0;
+
+    walk->root = false;
+    errno = 0;
+    if (getline(&buf, &buf_max, file) < 0 || sscanf(buf, "%d", &frame_c) != 1) {
+        ret = -1;
+    }
+    for (int i = 0; i < frame_c && ret == 0; i++) {
+        ret = walk_load_frame(walk, file, &buf, &buf_max);
+    }
+    if (ret < 0 && errno == 0) {
+        errno = EINVAL;
+    }
+    free(buf);
+    return ret;
+}
+
+/**
+ * Reads past the frames saved by walk_save in file, each a line followed by
+ *   its path and the names of its subdirectories left.
+ * Returns 0 on success and -1 if file doesn't hold a whole frontier.
+ */
+int walk_skip_saved(FILE *file) {
+    char *buf = NULL;
+    size_t buf_max = 0, path_len = 0;
+    int frame_c = 0, level = 0, listed = 0, sub_c = 0, ret = 0;
+
+    errno = 0;
+    if (getline(&buf, &buf_max, file) < 0 || sscanf(buf, "%d", &frame_c) != 1) {
+        ret = -1;
+    }
+    for (int i = 0; i < frame_c && ret == 0; i++) {
+        if (getline(&buf, &buf_max, file) < 0 || sscanf(buf, "%d %d %zu %d", \
+                &level, &listed, &path_len, &sub_c) != 4 || sub_c < 0) {
+            ret = -1;
+        }
+        for (int j = 0; j <= sub_c && ret == 0; j++) {
+            if (getdelim(&buf, &buf_max, '\0', file) < 0) {
+                ret = -1;
+            }
+        }
+    }
+    free(buf);
+    return ret;
+}
+
+/**
+ * Fills walk's entry for the directory of its ith frame. Unlike the entries
+ *   walk_read returns, its path isn't terminated, and its name is left as it
+ *   was.
+ * Returns walk's entry.
+ */
+FTSENT* walk_frame_entry(walk_t *walk, int i) {
+    FTSENT *entry = walk->entry;
+
+    entry->fts_path = walk->path;
+    entry->fts_accpath = walk->path;
+    entry->fts_pathlen = walk->frames[i].path_len;
+    entry->fts_level = walk->frames[i].level;
+    entry->fts_info = FTS_D;
+    entry->fts_errno = 0;
+    entry->fts_statp = &(walk->frames[i].st);
+    return entry;
+}
+
+/**
+ * Ends the traversal, closing any directory still open and freeing every
+ *   frame and buffer of walk.
+ */
+void walk_close(walk_t *walk) {
+    if (walk->file_tree != NULL) {
+        fts_close(walk->file_tree);
+        walk->file_tree = NULL;
+    }
+    while (walk->frame_c > 0) {
+        walk_pop(walk);
+    }
+    free(walk->frames);
+    free(walk->buf);
+    free(walk->path);
+    free(walk->entry);
+    free(walk->stats);
+    walk->frames = NULL;
+    walk->buf = NULL;
+    walk->path = NULL;
+    walk->entry = NULL;
+    walk->stats = NULL;
+}
+
+/**
+ * Returns the next entry of a streaming walk. The root is returned first, and
+ *   a directory just returned is opened and pushed onto the stack unless it
+ *   was skipped. Then the top directory gives, in turn, its files as they are
+ *   read, its queued subdirectories and finally itself as FTS_DP, after which
+ *   it is popped. A file that can't be stat'd is returned as FTS_NS, and a
+ *   directory that can't be read is returned as FTS_DP with its fts_errno
+ *   set.
+ * Returns the entry, or NULL once the stack is empty or if memory allocation
+ *   fails, with errno set in the latter case.
+ */
+FTSENT* walk_stream_read(walk_t *walk) {
+    struct timespec start;
+    walk_frame *frame = NULL;
+    walk_dirent *dirent = NULL;
+    walk_sub *sub = NULL;
+    char *name = NULL;
+    FTSENT *ret = NULL;
+    bool failed = false;
+    int read = 0, err = 0;
+
+    if (walk->root) {
+        walk->root = false;
+        throttle_acquire(walk->throttle, &start);
+        errno = 0;
+        err = lstat(walk->path, &(walk->st)) < 0 ? errno : 0;
+        throttle_release(walk->throttle, &start);
+        find_stats.stat_calls++;
+        if (err) {
+            ret = walk_set_entry(walk, walk->path, FTS_ROOTLEVEL, FTS_NS, \
+                err);
+        }
+        else {
+            ret = walk_set_entry(walk, walk->path, FTS_ROOTLEVEL, \
+                walk_info(&(walk->st)), 0);
+            walk->descend = ret->fts_info == FTS_D;
+        }
+    }
+    else if (walk->skipped) {
+        walk->skipped = false;
+        walk->entry->fts_info = FTS_DP;
+        ret = walk->entry;
+    }
+    else if (walk->descend) {
+        walk->descend = false;
+        failed = walk_push(walk, walk->entry->fts_level, &(walk->st)) < 0;
+    }
+
+    while (ret == NULL && !failed && walk->frame_c > 0) {
+        frame = &(walk->frames[walk->frame_c - 1]);
+        if (frame->fd >= 0) {
+            read = walk_next_dirent(walk, frame, &dirent);
+            if (dirent == NULL) {
+                frame->err = read < 0 ? errno : 0;
+                close(frame->fd);
+                frame->fd = -1;
+                if (walk->prefetch != NULL) {
+                    walk_prefetch_subs(walk, frame);
+                }
+            }
+            else if (strcmp(dirent->d_name, ".") != 0 && \
+                    strcmp(dirent->d_name, "..") != 0) {
+                name = dirent->d_name;
+                errno = 0;
+                if (walk_set_path(walk, frame->path_len, name) < 0) {
+                    failed = true;
+                }
+                else if ((err = walk_stat_next(walk, frame->fd, name)) != 0) {
+                    ret = walk_set_entry(walk, name, frame->level + 1, \
+                        FTS_NS, err);
+                }
+                else if (S_ISDIR(walk->st.st_mode)) {
+                    failed = walk_queue(frame, name, &(walk->st)) < 0;
+                }
+                else {
+                    ret = walk_set_entry(walk, name, frame->level + 1, \
+                        walk_info(&(walk->st)), 0);
+                }
+            }
+        }
+        else if (frame->sub_i < frame->sub_c) {
+            sub = &(frame->subs[frame->sub_i++]);
+            name = frame->names + sub->name_off;
+            if (walk_set_path(walk, frame->path_len, name) < 0) {
+                failed = true;
+            }
+            else {
+                walk->st = sub->st;
+                ret = walk_set_entry(walk, name, frame->level + 1, FTS_D, 0);
+                walk->descend = true;
+            }
+        }
+        else {
+            walk_set_path(walk, frame->path_len, NULL);
+            name = frame->level == FTS_ROOTLEVEL ? walk->path : \
+                strrchr(walk->path, '/') + 1;
+            walk->st = frame->st;
+            ret = walk_set_entry(walk, name, frame->level, FTS_DP, \
+                frame->err);
+            walk_pop(walk);
+        }
+    }
+    if (ret == NULL && !failed) {
+        errno = 0;
+    }
+    return ret;
+}
+
+/**
+ * Gets the next entry of the directory being read by frame, reading the next
+ *   chunk of it into walk's buffer once the last is used up. If walk stats in
+ *   inode order, the files of a chunk are all stat'd once it is read.
+ * Returns 0 on success, with dirent pointing at the entry or NULL if there are
+ *   no more, and -1 if reading fails.
+ */
+int walk_next_dirent(walk_t *walk, walk_frame *frame, walk_dirent **dirent) {
+    struct timespec start;
+    long n = 0;
+    int ret = 0;
+
+    *dirent = NULL;
+    if (walk->buf_pos >= walk->buf_len) {
+        throttle_acquire(walk->throttle, &start);
+        errno = 0;
+        n = syscall(SYS_getdents64, frame->fd, walk->buf, WALK_BUF_SIZE);
+        if (n < 0) {
+            ret = -1;
+        }
+        throttle_release(walk->throttle, &start);
+        walk->buf_len = n > 0 ? n : 0;
+        walk->buf_pos = 0;
+        if (walk->inode_order) {
+            walk_stat_chunk(walk, frame->fd);
+        }
+    }
+    if (walk->buf_pos < walk->buf_len) {
+        *dirent = (walk_dirent*)(walk->buf + walk->buf_pos);
+        walk->buf_pos += (*dirent)->d_reclen;
+    }
+    return ret;
+}
+
+/**
+ * Stats the file name in the directory open at fd into st, without following
+ *   a symbolic link, throttled by walk's throttle. The call is timed as the
+ *   stat phase.
+ * Returns 0 on success and the errno of the failure otherwise.
+ */
+int walk_fstatat(walk_t *walk, int fd, char *name, struct stat *st) {
+    struct timespec start, stat_start;
+    int ret = 0;
+
+    throttle_acquire(walk->throttle, &start);
+    stats_begin(&stat_start);
+    errno = 0;
+    if (fstatat(fd, name, st, AT_SYMLINK_NOFOLLOW) < 0) {
+        ret = errno;
+    }
+    stats_end(STATS_STAT, &stat_start);
+    throttle_release(walk->throttle, &start);
+    find_stats.stat_calls++;
+    return ret;
+}
+
+/**
+ * Gets the stat struct of name, the file of the chunk last returned by
+ *   walk_next_dirent, into walk's stat struct. If walk stats in inode order it
+ *   was already stat'd with the rest of its chunk, and otherwise it is stat'd
+ *   now in the directory open at fd.
+ * Returns 0 on success and the errno of the failure otherwise.
+ */
+int walk_stat_next(walk_t *walk, int fd, char *name) {
+    int ret = 0;
+
+    if (walk->inode_order) {
+        assert(walk->stat_i < walk->stat_c && \
+            walk->buf + walk->stats[walk->stat_i].pos + \
+            offsetof(walk_dirent, d_name) == name);
+        walk->st = walk->stats[walk->stat_i].st;
+        ret = walk->stats[walk->stat_i].err;
+        walk->stat_i++;
+    }
+    else {
+        ret = walk_fstatat(walk, fd, name, &(walk->st));
+    }
+    return ret;
+}
+
+/**
+ * Stats every file of the chunk in walk's buffer, read from the directory
+ *   open at fd, in increasing order of their inode numbers, and then puts
+ *   their results back in the order they are listed. "." and ".." are left
+ *   out, as the walk skips them.
+ */
+void walk_stat_chunk(walk_t *walk, int fd) {
+    walk_dirent *dirent = NULL;
+    walk_stat *curr = NULL;
+    long pos = 0;
+
+    walk->stat_c = 0;
+    walk->stat_i = 0;
+    while (pos < walk->buf_len) {
+        dirent = (walk_dirent*)(walk->buf + pos);
+        if (strcmp(dirent->d_name, ".") != 0 && \
+                strcmp(dirent->d_name, "..") != 0) {
+            curr = &(walk->stats[walk->stat_c++]);
+            curr->ino = dirent->d_ino;
+            curr->pos = pos;
+        }
+        pos += dirent->d_reclen;
+    }
+    qsort(walk->stats, walk->stat_c, sizeof(walk_stat), compare_stat_ino);
+    for (int i = 0; i < walk->stat_c; i++) {
+        curr = &(walk->stats[i]);
+        curr->err = walk_fstatat(walk, fd, walk->buf + curr->pos + \
+            offsetof(walk_dirent, d_name), &(curr->st));
+    }
+    qsort(walk->stats, walk->stat_c, sizeof(walk_stat), compare_stat_pos);
+}
+
+/**
+ * Hands the path of every subdirectory queued in frame, a directory just read
+ *   to the end, to walk's prefetch, in the order they will be descended into,
+ *   until its ring is full. walk's path is used to build them.
+ */
+void walk_prefetch_subs(walk_t *walk, walk_frame *frame) {
+    bool queued = true;
+
+    for (int i = frame->sub_i; i < frame->sub_c && queued; i++) {
+        queued = walk_set_path(walk, frame->path_len, \
+            frame->names + frame->subs[i].name_off) == 0 && \
+            prefetch_push(walk->prefetch, walk->path, \
+            walk->entry->fts_pathlen);
+    }
+}
+
+/**
+ * Compares two walk_stats by inode number.
+ * Returns >0 if s1 > s2, <0 if s1 < s2, and 0 if s1 == s2.
+ */
+int compare_stat_ino(const void *s1, const void *s2) {
+    uint64_t ino1 = ((const walk_stat*)s1)->ino;
+    uint64_t ino2 = ((const walk_stat*)s2)->ino;
+
+    return (ino1 > ino2) - (ino1 < ino2);
+}
+
+/**
+ * Compares two walk_stats by where their names are in the chunk.
+ * Returns >0 if s1 > s2, <0 if s1 < s2, and 0 if s1 == s2.
+ */
+int compare_stat_pos(const void *s1, const void *s2) {
+    long pos1 = ((const walk_stat*)s1)->pos;
+    long pos2 = ((const walk_stat*)s2)->pos;
+
+    return (pos1 > pos2) - (pos1 < pos2);
+}
+
+/**
+ * Queues the subdirectory name with its stat struct st in frame, copying
+ *   name into frame's names.
+ * Returns 0 on success and -1 if memory allocation fails.
+ */
+int walk_queue(walk_frame *frame, char *name, struct stat *st) {
+    walk_sub *subs = NULL;
+    char *names = NULL;
+    size_t len = strlen(name) + 1, names_max = frame->names_max;
+    int sub_max = frame->sub_max == 0 ? WALK_INIT_MAX : frame->sub_max * 2;
+    int ret = 0;
+
+    if (frame->sub_c == frame->sub_max) {
+        errno = 0;
+        subs = realloc(frame->subs, sizeof(walk_sub) * sub_max);
+        if (subs == NULL) {
+            ret = -1;
+        }
+        else {
+            frame->subs = subs;
+            frame->sub_max = sub_max;
+        }
+    }
+    if (ret == 0 && frame->names_len + len > frame->names_max) {
+        if (names_max == 0) {
+            names_max = WALK_NAMES_INIT_MAX;
+        }
+        while (frame->names_len + len > names_max) {
+            names_max *= 2;
+        }
+        errno = 0;
+        names = realloc(frame->names, names_max);
+        if (names == NULL) {
+            ret = -1;
+        }
+        else {
+            frame->names = names;
+            frame->names_max = names_max;
+        }
+    }
+    if (ret == 0) {
+        frame->subs[frame->sub_c].name_off = frame->names_len;
+        frame->subs[frame->sub_c].st = *st;
+        frame->sub_c++;
+        memcpy(frame->names + frame->names_len, name, len);
+        frame->names_len += len;
+    }
+    return ret;
+}
+
+/**
+ * Pushes a frame for the directory at walk's path, the last entry returned,
+ *   at level with stat struct st, and opens it. If it can't be opened the
+ *   frame is pushed anyway with the error, so it is still returned as FTS_DP.
+ *   The first push of a walk stating in inode order allocates room for the
+ *   results of the largest chunk.
+ * Returns 0 on success and -1 if memory allocation fails.
+ */
+int walk_push(walk_t *walk, int level, struct stat *st) {
+    walk_frame *frames = NULL, *frame = NULL;
+    int frame_max = walk->frame_max == 0 ? WALK_INIT_MAX : \
+        walk->frame_max * 2;
+    int ret = 0;
+
+    errno = 0;
+    if (walk->inode_order && walk->stats == NULL) {
+        walk->stats = malloc(sizeof(walk_stat) * \
+            (WALK_BUF_SIZE / WALK_DIRENT_MIN));
+        if (walk->stats == NULL) {
+            ret = -1;
+        }
+    }
+    if (ret == 0 && walk->frame_c == walk->frame_max) {
+        errno = 0;
+        frames = realloc(walk->frames, sizeof(walk_frame) * frame_max);
+        if (frames == NULL) {
+            ret = -1;
+        }
+        else {
+            walk->frames = frames;
+            walk->frame_max = frame_max;
+        }
+    }
+    if (ret == 0) {
+        frame = &(walk->frames[walk->frame_c++]);
+        frame->level = level;
+        frame->path_len = walk->entry->fts_pathlen;
+        frame->st = *st;
+        frame->err = 0;
+        frame->subs = NULL;
+        frame->sub_c = 0;
+        frame->sub_max = 0;
+        frame->sub_i = 0;
+        frame->names = NULL;
+        frame->names_len = 0;
+        frame->names_max = 0;
+        walk->buf_len = 0;
+        walk->buf_pos = 0;
+        walk->stat_c = 0;
+        walk->stat_i = 0;
+        errno = 0;
+        frame->fd = open(walk->path, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | \
+            O_CLOEXEC);
+        if (frame->fd < 0) {
+            frame->err = errno;
+        }
+    }
+    return ret;
+}
+
+/**
+ * Pops the top frame of walk, closing its directory if it is still open.
+ */
+void walk_pop(walk_t *walk) {
+    walk_frame *frame = &(walk->frames[walk->frame_c - 1]);
+
+    if (frame->fd >= 0) {
+        close(frame->fd);
+    }
+    free(frame->subs);
+    free(frame->names);
+    walk->frame_c--;
+}
+
+/**
+ * Sets walk's path to name within the directory whose path is the first
+ *   dir_len bytes of it, or to that directory if name is NULL, growing the
+ *   path if needed. As with fts, no '/' is added after a directory path that
+ *   already ends in one.
+ * Returns 0 on success and -1 if memory allocation fails.
+ */
+int walk_set_path(walk_t *walk, size_t dir_len, char *name) {
+    char *path = NULL;
+    size_t len = dir_len, name_len = name != NULL ? strlen(name) : 0;
+    size_t path_max = walk->path_max;
+    int ret = 0;
+
+    if (name != NULL && (len == 0 || walk->path[len - 1] != '/')) {
+        len++;
+    }
+    if (len + name_len + 1 > path_max) {
+        while (len + name_len + 1 > path_max) {
+            path_max *= 2;
+        }
+        errno = 0;
+        path = realloc(walk->path, path_max);
+        if (path == NULL) {
+            ret = -1;
+        }
+        else {
+            walk->path = path;
+            walk->path_max = path_max;
+        }
+    }
+    if (ret == 0) {
+        walk->path[dir_len] = '/';
+        memcpy(walk->path + len, name != NULL ? name : "", name_len + 1);
+        walk->entry->fts_pathlen = len + name_len;
+    }
+    return ret;
+}
+
+/**
+ * Fills walk's entry for the file at walk's path, named name, with its stat
+ *   struct in walk, which is zeroed if it couldn't be read.
+ * Returns walk's entry.
+ */
+FTSENT* walk_set_entry(walk_t *walk, char *name, int level, int info, \
+        int err) {
+    FTSENT *entry = walk->entry;
+
+    entry->fts_path = walk->path;
+    entry->fts_accpath = walk->path;
+    entry->fts_namelen = strlen(name);
+    memmove(entry->fts_name, name, entry->fts_namelen + 1);
+    entry->fts_level = level;
+    entry->fts_info = info;
+    entry->fts_errno = err;
+    entry->fts_statp = &(walk->st);
+    if (info == FTS_NS) {
+        memset(&(walk->st), 0, sizeof(struct stat));
+    }
+    return entry;
+}
+
+/**
+ * Gets the fts_info of a file with stat struct st, which fts would give it.
+ * Returns FTS_D, FTS_F, FTS_SL or FTS_DEFAULT.
+ */
+int walk_info(struct stat *st) {
+    int ret = FTS_DEFAULT;
+
+    if (S_ISDIR(st->st_mode)) {
+        ret = FTS_D;
+    }
+    else if (S_ISREG(st->st_mode)) {
+        ret = FTS_F;
+    }
+    else if (S_ISLNK(st->st_mode)) {
+        ret = FTS_SL;
+    }
+    return ret;
+}
+
+/**
+ * Reads one frame written by walk_save and pushes it onto walk. Its path must
+ *   be the root for the bottom frame, and extend the path of the frame below
+ *   for any other. buf is used to read lines and names into.
+ * Returns 0 on success and -1 on failure, with errno set if it was not
+ *   because file is invalid.
+ */
+int walk_load_frame(walk_t *walk, FILE *file, char **buf, size_t *buf_max) {
+    walk_frame *frame = NULL;
+    struct stat st;
+    char *path = NULL;
+    size_t path_len = 0, prev_len = 0;
+    int level = 0, listed = 0, sub_c = 0, ret = 0;
+
+    if (walk->frame_c > 0) {
+        prev_len = walk->frames[walk->frame_c - 1].path_len;
+    }
+    errno = 0;
+    if (getline(buf, buf_max, file) < 0 || sscanf(*buf, "%d %d %zu %d", \
+            &level, &listed, &path_len, &sub_c) != 4 || \
+            getdelim(buf, buf_max, '\0', file) < 0 || \
+            strlen(*buf) != path_len || (walk->frame_c == 0 ? \
+            strcmp(*buf, walk->path) != 0 : path_len <= prev_len || \
+            memcmp(*buf, walk->path, prev_len) != 0)) {
+        ret = -1;
+    }
+    else if (path_len + 1 > walk->path_max) {
+        errno = 0;
+        path = realloc(walk->path, path_len + 1);
+        if (path == NULL) {
+            ret = -1;
+        }
+        else {
+            walk->path = path;
+            walk->path_max = path_len + 1;
+        }
+    }
+    if (ret == 0) {
+        memcpy(walk->path, *buf, path_len + 1);
+        walk->entry->fts_pathlen = path_len;
+        errno = 0;
+        if (lstat(walk->path, &st) < 0 || walk_push(walk, level, &st) < 0) {
+            ret = -1;
+        }
+    }
+    if (ret == 0) {
+        frame = &(walk->frames[walk->frame_c - 1]);
+        if (listed && frame->fd >= 0) {
+            close(frame->fd);
+            frame->fd = -1;
+        }
+    }
+    for (int i = 0; i < sub_c && ret == 0; i++) {
+        errno = 0;
+        if (getdelim(buf, buf_max, '\0', file) < 0 || \
+                walk_set_path(walk, path_len, *buf) < 0) {
+            ret = -1;
+        }
+        else if (lstat(walk->path, &st) == 0 && S_ISDIR(st.st_mode)) {
+            ret = walk_queue(frame, *buf, &st);
+        }
+    }
+    return ret;
+}
@@ -0,0 +1,189 @@
+#ifndef __WALK_H
+#define __WALK_H
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <limits.h>
+#include <fts.h>
+#include <stddef.h>
+#include <assert.h>
+#include "throttle.h"
+#include "prefetch.h"
+#include "stats.h"
+
+// Size of the chunks a streamed directory is read in with getdents64
+#define WALK_BUF_SIZE (1 << 15)
+// Initial number of subdirectories a directory has room to queue, and bytes
+//   for their names and the path being built
+#define WALK_INIT_MAX 16
+#define WALK_NAMES_INIT_MAX 256
+// Smallest record getdents64 returns, bounding the entries of a chunk
+#define WALK_DIRENT_MIN 24
+
+typedef struct walk_dirent walk_dirent;
+typedef struct walk_sub walk_sub;
+typedef struct walk_stat walk_stat;
+typedef struct walk_frame walk_frame;
+typedef struct walk_s walk_t;
+
+// A directory entry as getdents64 returns it.
+struct walk_dirent {
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+
+// A subdirectory found while reading a directory, waiting to be descended
+//   into once the directory has been read. Its name is at name_off in the
+//   directory's names.
+struct walk_sub {
+    size_t name_off;
+    struct stat st;
+};
+
+// A file of the chunk just read, stat'd before any file of the chunk is
+//   returned when the walk stats in inode order. Its name is at pos in the
+//   walk's buffer.
+struct walk_stat {
+    uint64_t ino;
+    long pos;
+    int err;
+    struct stat st;
+};
+
+// A directory being walked. While fd is open it is being read, and files are
+//   returned as they arrive. Once it is read, its subdirectories are returned
+//   and descended into one at a time, and then the directory itself is
+//   returned one last time as FTS_DP.
+struct walk_frame {
+    int fd;
+    int level;
+    // Length of the directory's path, which stays at the start of the walk's
+    //   path while it is on the stack.
+    size_t path_len;
+    struct stat st;
+    int err;
+
+    walk_sub *subs;
+    int sub_c;
+    int sub_max;
+    int sub_i;
+    char *names;
+    size_t names_len;
+    size_t names_max;
+};
+
+// A traversal of a file tree, either by fts or, if streaming, by reading
+//   each directory in WALK_BUF_SIZE chunks. Only the stack of directories
+//   being walked and their queued subdirectories are kept, so memory does not
+//   grow with the number of files in a directory, and files are returned as
+//   soon as their chunk is read. Only one directory is open at a time.
+struct walk_s {
+    FTS *file_tree;
+    // Limits the directory reads and stat calls of the walk, NULL for none.
+    throttle_t *throttle;
+
+    bool stream;
+    walk_frame *frames;
+    int frame_c;
+    int frame_max;
+    char *buf;
+    long buf_len;
+    long buf_pos;
+    char *path;
+    size_t path_max;
+    // The entry last returned and its stat struct. If it is a directory,
+    //   descend is set until it is skipped or the next read descends into it,
+    //   and skipped is set until the next read returns it as FTS_DP.
+    FTSENT *entry;
+    struct stat st;
+    bool descend;
+    bool skipped;
+    bool root;
+
+    // If set, a streaming walk stats the files of each chunk it reads in the
+    //   order of their inode numbers, which on a spinning disk reads the inode
+    //   table in one sweep rather than seeking back and forth. The results
+    //   are put back in the chunk's order in stats, so files are still
+    //   returned in directory order, stat_i being the next one returned. May
+    //   be set any time before the first read.
+    bool inode_order;
+    walk_stat *stats;
+    int stat_c;
+    int stat_i;
+
+    // If not NULL, a streaming walk hands the subdirectories of each
+    //   directory it finishes reading to prefetch, whose helper reads them
+    //   ahead of the walk. May be set any time before the first read.
+    prefetch_t *prefetch;
+};
+
+// Opens a traversal of the tree rooted at file. If stream is true directories
+//   are streamed, otherwise they are read by fts. If throttle is not NULL it
+//   paces the walk's file system operations.
+int walk_open(walk_t *walk, char *file, bool stream, throttle_t *throttle);
+
+// Returns the next entry of the traversal in the manner of fts_read, NULL
+//   once it is over or on error, with errno set in the latter case. The entry
+//   is valid until the next call.
+FTSENT* walk_read(walk_t *walk);
+
+// Keeps the traversal from descending into entry, the directory last read.
+void walk_skip(walk_t *walk, FTSENT *entry);
+
+// Returns the number of directories found but not yet read by a streaming
+//   walk, or -1 for fts, which doesn't tell.
+long walk_pending(walk_t *walk);
+
+// Determines if the frontier of a streaming walk can be saved now, which is
+//   only between directory listings.
+bool walk_can_save(walk_t *walk);
+
+// Writes the frontier of walk to file: the directories on its stack, each
+//   with the subdirectories it has yet to descend into.
+int walk_save(walk_t *walk, FILE *file);
+
+// Reads a frontier written by walk_save into walk, which must be a streaming
+//   walk just opened on the same root, so it continues from there.
+int walk_load(walk_t *walk, FILE *file);
+
+// Reads past a frontier written by walk_save without loading it.
+int walk_skip_saved(FILE *file);
+
+// Gets an entry for the directory of walk's ith frame from the bottom. Its
+//   fts_path is only valid for fts_pathlen bytes, and only until the next
+//   read.
+FTSENT* walk_frame_entry(walk_t *walk, int i);
+
+// Ends the traversal and frees walk's memory.
+void walk_close(walk_t *walk);
+
+// Helpers for streaming
+FTSENT* walk_stream_read(walk_t *walk);
+int walk_next_dirent(walk_t *walk, walk_frame *frame, walk_dirent **dirent);
+int walk_fstatat(walk_t *walk, int fd, char *name, struct stat *st);
+int walk_stat_next(walk_t *walk, int fd, char *name);
+void walk_stat_chunk(walk_t *walk, int fd);
+void walk_prefetch_subs(walk_t *walk, walk_frame *frame);
+int compare_stat_ino(const void *s1, const void *s2);
+int compare_stat_pos(const void *s1, const void *s2);
+int walk_queue(walk_frame *frame, char *name, struct stat *st);
+int walk_push(walk_t *walk, int level, struct stat *st);
+void walk_pop(walk_t *walk);
+int walk_set_path(walk_t *walk, size_t dir_len, char *name);
+FTSENT* walk_set_entry(walk_t *walk, char *name, int level, int info, \
+    int err);
+int walk_info(struct stat *st);
+int walk_load_frame(walk_t *walk, FILE *file, char **buf, size_t *buf_max);
+
+#endif /* __WALK_H */
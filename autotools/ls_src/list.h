@@ -6,6 +6,7 @@
 #include <stdlib.h>
 #include <errno.h>
 #include <assert.h>
+#include "../common_src/arena.h"
 
 typedef struct node_s node;
 typedef struct list_s list;
@@ -21,37 +22,33 @@ struct node_s {
     node *next;
 };
 
+// A list whose nodes, names and stat structs are all carved from mem.
 struct list_s {
     int size;
     node *head;
+    arena_t *mem;
 };
 
-// Initializes the values of l. l must already be allocated.
-void list_init(list *l);
+// Initializes the values of l, whose nodes are carved from mem. l must already
+//   be allocated.
+void list_init(list *l, arena_t *mem);
 
-// Creates a new node with data specified by f_name and f_stat. The user must
-//   ensure f_stat is a valid reference for the entire life of the list.
-node* list_create_node(char *f_name, struct stat *f_stat);
-
-// Sets the given data in n.
-int node_set_data(node *n, char *f_name, struct stat *f_stat);
+// Creates a new node in l's memory with data specified by f_name and f_stat.
+//   The user must ensure f_stat is a valid reference for the entire life of
+//   the list.
+node* list_create_node(list *l, char *f_name, struct stat *f_stat);
 
 // Inserts n into l while preserving increasing order of l.
 // If adding the first element of an empty list, that list must be initialized
 //   with list_init.
 void list_insert_ordered(list *l, node *n);
 
-// Deletes l and points its head to NULL. The user must not be holding any
-//   references to data internal to this list after it is deleted.
+// Deletes l, freeing everything carved from its memory at once, and points
+//   its head to NULL. The user must not be holding any references to data
+//   internal to this list after it is deleted.
 void list_delete(list *l);
 
-// Deletes n and all its entries.
-void node_delete(node *n);
-
 // Determines order between two nodes.
 int node_order(node *n1, node *n2);
 
-// Puts a lowercase copy of src into the string pointed at by dest.
-int lower_string_cpy(char** dest, char *src);
-
 #endif /* __LIST_H */
\ No newline at end of file
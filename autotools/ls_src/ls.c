@@ -11,9 +11,12 @@
 #include "list.h"
 #include "long_out.h"
 #include "print_utils.h"
+#include "../common_src/trace.h"
 
 // All valid options for ls
-#define OPTION_STRING "adil"
+#define OPTION_STRING "adilO"
+// Initial number of entries a directory read in i-node order has room for
+#define DIR_ENTS_INIT_MAX 64
 
 // Option flags. These are ONLY set by the get_options function.
 
@@ -25,6 +28,14 @@ bool option_l = false;
 bool option_i = false;
 // Output just the file specified, don't open it as a directory
 bool option_d = false;
+// Get the stat structs of a directory's files in the order of their i-nodes
+bool option_O = false;
+
+// A file read from a directory, waiting to be stat'd in i-node order.
+struct dir_ent_s {
+    ino_t ino;
+    char *name;
+};
 
 // Error definitions
 typedef enum ls_err ls_err;
@@ -41,17 +52,23 @@ enum ls_err {
 };
 
 // List all the directory entries of path. Outputs the result to standard out.
-ls_err ls(char *path);
+//   Everything the listing needs is carved from mem, which is reset after.
+ls_err ls(char *path, arena_t *mem);
 
 // Gets all the entries located in path and stores them in dir_entries.
 ls_err get_entries(const char *path, list *dir_entries);
 
+// Helpers for get_entries, when the entries are stat'd in i-node order.
+ls_err get_entries_ino(DIR *d, const char *path, list *dir_entries);
+int compare_ino(const void *e1, const void *e2);
+
 // Adds the file f_name at path to dir_entries. If path is NULL it is ignored.
 //   dir_entries must already be allocated.
 ls_err add_entry(char *f_name, const char *path, list *dir_entries);
 
 // Helper functions for getting a files stat struct.
-ls_err get_f_stat(char *f_name, const char *path, struct stat **f_stat);
+ls_err get_f_stat(char *f_name, const char *path, arena_t *mem, \
+    struct stat **f_stat);
 ls_err get_full_path(char *path_buf, int path_buf_len, const char *f_name, \
     const char *path);
 
@@ -77,12 +94,15 @@ void ls_perror(ls_err err, char *pname);
  * Entry point for ls. Sets argument flags and then calls ls for all specified
  *   file paths. On an error, will print the error and attempt to continue
  *   running any additional paths unless a memory allocation error has occured.
+ *   Every call shares one arena, so listing many paths reuses its memory.
  * Returns 0 on success, >0 on error.
  */
 int main(int argc, char **argv) {
+    arena_t mem;
     ls_err err = LS_ERR_NONE;
     int ret = 0;
 
+    arena_create(&mem);
     ret = get_options(argc, argv);
     if (ret < 0) {
         printf("Usage: %s [-%s] [paths...]\n", argv[0], OPTION_STRING);
@@ -93,14 +113,14 @@ int main(int argc, char **argv) {
             i++;
         }
         if (argv[i] == NULL) {
-            err = ls(".");
+            err = ls(".", &mem);
             if (err != LS_ERR_NONE) {
                 ls_perror(err, argv[0]);
                 ret = err;
             }
         }
         else if (argv[i+1] == NULL) {
-            err = ls(argv[i]);
+            err = ls(argv[i], &mem);
             if (err != LS_ERR_NONE) {
                 ls_perror(err, argv[0]);
                 ret = err;
@@ -115,7 +135,7 @@ int main(int argc, char **argv) {
                 if (!option_d) {
                     printf("%s:\n", argv[j]);
                 }
-                err = ls(argv[j]);
+                err = ls(argv[j], &mem);
                 if (err != LS_ERR_NONE) {
                     ls_perror(err, argv[0]);
                     ret = err;
@@ -125,20 +145,22 @@ int main(int argc, char **argv) {
         }
     }
 
+    arena_delete(&mem);
     return ret;
 }
 
 /**
  * Prints the entries of the directory specified by path to stdout. If option_d
- *   is specified, path is treated as a file instead.
+ *   is specified, path is treated as a file instead. The entries, and anything
+ *   built to output them, are carved from mem and freed at once when done.
  * Returns LS_ERR_NONE on success, and on error an ls_err value corresponding
  *   to the type of error.
  */
-ls_err ls(char *path) {
+ls_err ls(char *path, arena_t *mem) {
     list dir_entries;
     ls_err ret = LS_ERR_NONE;
 
-    list_init(&dir_entries);
+    list_init(&dir_entries, mem);
     if (option_d) {
         ret = add_entry(path, NULL, &dir_entries);
     }
@@ -164,7 +186,9 @@ ls_err ls(char *path) {
 
 /**
  * Opens and iterates through a directory stream at path, and for each entry
- *   entering it into dir_entries with a call to add_entry.
+ *   entering it into dir_entries with a call to add_entry. If option_O is true
+ *   and the entries need their stat structs, they are read by
+ *   get_entries_ino instead.
  * Returns LS_ERR_NONE on success, and on error an ls_err value corresponding
  *   to the type of error.
  */
@@ -179,23 +203,97 @@ ls_err get_entries(const char *path, list *dir_entries) {
         ret = LS_ERR_DIR_STREAM_OPEN;
     }
     else {
-        errno = 0;
-        ent = readdir(d);
-        while (ent != NULL && ret == LS_ERR_NONE) {
-            if (option_a || ent->d_name[0] != '.') {
-                ret = add_entry(ent->d_name, path, dir_entries);
-            }
+        TRACE1(ls, dir_open, path);
+        if (option_O && (option_l || option_i)) {
+            ret = get_entries_ino(d, path, dir_entries);
+        }
+        else {
             errno = 0;
             ent = readdir(d);
-        }
-        if (ent == NULL && errno) {
-            ret = LS_ERR_DIR_STREAM_READ;
+            while (ent != NULL && ret == LS_ERR_NONE) {
+                if (option_a || ent->d_name[0] != '.') {
+                    ret = add_entry(ent->d_name, path, dir_entries);
+                }
+                errno = 0;
+                ent = readdir(d);
+            }
+            if (ent == NULL && errno) {
+                ret = LS_ERR_DIR_STREAM_READ;
+            }
         }
         closedir(d);
+        TRACE2(ls, dir_close, path, (int)ret);
     }
     return ret;
 }
 
+/**
+ * Reads every entry of the directory stream d, opened at path, before getting
+ *   any of their stat structs, and then adds them to dir_entries in increasing
+ *   order of their i-node numbers. On ext4 and XFS i-nodes are stored in
+ *   tables by number, so on a spinning disk this reads them in one sweep
+ *   instead of seeking back and forth. dir_entries keeps its own order, so
+ *   the output is the same. The names are carved from dir_entries' memory.
+ * Returns LS_ERR_NONE on success, and on error an ls_err value corresponding
+ *   to the type of error.
+ */
+ls_err get_entries_ino(DIR *d, const char *path, list *dir_entries) {
+    struct dirent *ent = NULL;
+    struct dir_ent_s *ents = NULL, *grown = NULL;
+    int ent_c = 0, ent_max = 0;
+    ls_err ret = LS_ERR_NONE;
+
+    errno = 0;
+    ent = readdir(d);
+    while (ent != NULL && ret == LS_ERR_NONE) {
+        if (option_a || ent->d_name[0] != '.') {
+            if (ent_c == ent_max) {
+                ent_max = ent_max == 0 ? DIR_ENTS_INIT_MAX : ent_max * 2;
+                errno = 0;
+                grown = realloc(ents, sizeof(struct dir_ent_s) * ent_max);
+                if (grown == NULL) {
+                    ret = LS_ERR_MALLOC;
+                }
+                else {
+                    ents = grown;
+                }
+            }
+            if (ret == LS_ERR_NONE) {
+                ents[ent_c].ino = ent->d_ino;
+                ents[ent_c].name = arena_strndup(dir_entries->mem, \
+                    ent->d_name, strlen(ent->d_name));
+                if (ents[ent_c++].name == NULL) {
+                    ret = LS_ERR_MALLOC;
+                }
+            }
+        }
+        errno = 0;
+        ent = ret == LS_ERR_NONE ? readdir(d) : NULL;
+    }
+    if (ret == LS_ERR_NONE && errno) {
+        ret = LS_ERR_DIR_STREAM_READ;
+    }
+    if (ret == LS_ERR_NONE) {
+        qsort(ents, ent_c, sizeof(struct dir_ent_s), compare_ino);
+    }
+    for (int i = 0; i < ent_c && ret == LS_ERR_NONE; i++) {
+        ret = add_entry(ents[i].name, path, dir_entries);
+    }
+    free(ents);
+    return ret;
+}
+
+/**
+ * Compares two dir_ent_s structs by i-node number.
+ * Returns >0 if e1 > e2, <0 if e1 < e2, and 0 if e1 == e2.
+ */
+int compare_ino(const void *e1, const void *e2) {
+    ino_t ino1 = ((const struct dir_ent_s*)e1)->ino;
+    ino_t ino2 = ((const struct dir_ent_s*)e2)->ino;
+
+    return (ino1 > ino2) - (ino1 < ino2);
+}
+
 /** 
  * Adds a new node containing f_name into dir_entries. If option_l or option_i
  *   are true, it also stores the file's stat struct in dir_entries as well. If
@@ -210,7 +308,7 @@ ls_err add_entry(char *f_name, const char *path, list *dir_entries) {
     ls_err ret = LS_ERR_NONE;
 
     if (option_l || option_i || option_d) {
-        ret = get_f_stat(f_name, path, &f_stat);
+        ret = get_f_stat(f_name, path, dir_entries->mem, &f_stat);
     }
 
     if (ret == LS_ERR_STAT && option_d) {
@@ -218,7 +316,7 @@ ls_err add_entry(char *f_name, const char *path, list *dir_entries) {
     }
 
     if (ret == LS_ERR_NONE) {
-        ent_node = list_create_node(f_name, f_stat);
+        ent_node = list_create_node(dir_entries, f_name, f_stat);
         if (ent_node == NULL) {
             ret = LS_ERR_MALLOC;
         }
@@ -230,30 +328,33 @@ ls_err add_entry(char *f_name, const char *path, list *dir_entries) {
 }
 
 /**
- * Allocates and gets the stat struct for f_name at path. If path is NULL, it
- *   is ignored and f_name is passed by itself to lstat.
+ * Carves the stat struct for f_name at path from mem and gets it. If path is
+ *   NULL, it is ignored and f_name is passed by itself to lstat. A struct
+ *   that couldn't be filled is left in mem until it is reset.
  * Returns LS_ERR_NONE on success, and on error an ls_err value corresponding
  *   to the type of error.
  */
-ls_err get_f_stat(char *f_name, const char *path, struct stat **f_stat) {
+ls_err get_f_stat(char *f_name, const char *path, arena_t *mem, \
+        struct stat **f_stat) {
     char stat_path[PATH_MAX];
     ls_err ret = LS_ERR_NONE;
 
-    errno = 0;
-    *f_stat = malloc(sizeof(struct stat));
+    *f_stat = arena_alloc(mem, sizeof(struct stat));
     if (*f_stat == NULL) {
         ret = LS_ERR_MALLOC;
     }
     else if (path != NULL) {
         ret = get_full_path(stat_path, PATH_MAX, f_name, path);
+        errno = 0;
         if (ret == LS_ERR_NONE && lstat(stat_path, *f_stat) < 0) {
-            free(*f_stat);
             ret = LS_ERR_STAT;
         }
     }
-    else if (lstat(f_name, *f_stat) < 0) {
-        free(*f_stat);
-        ret = LS_ERR_STAT;
+    else {
+        errno = 0;
+        if (lstat(f_name, *f_stat) < 0) {
+            ret = LS_ERR_STAT;
+        }
     }
     return ret;
 }
@@ -354,8 +455,9 @@ ls_err output_entries_tty(list *dir_entries) {
 }
 
 /**
- * Creates an array of strings for terminal output in output_entries_tty. If
- *   option_i is true, the i-node is prepended to the file name.
+ * Creates an array of strings for terminal output in output_entries_tty,
+ *   carved from the memory of dir_entries. If option_i is true, the i-node is
+ *   prepended to the file name.
  * Returns the array on success and NULL if memory allocation failed.
  */
 char** get_tty_out(list *dir_entries) {
@@ -363,20 +465,16 @@ char** get_tty_out(list *dir_entries) {
     char **tty_out;
     int err = 0;
 
-    errno = 0;
-    tty_out = malloc(sizeof(char*) * dir_entries->size);
+    tty_out = arena_alloc(dir_entries->mem, sizeof(char*) * dir_entries->size);
     if (tty_out != NULL) {
         curr = dir_entries->head;
         int i = 0;
         while (err == 0 && curr != NULL && i < dir_entries->size) {
             if (option_i) {
-                errno = 0;
-                tty_out[i] = malloc(strlen(curr->data.f_name) + \
+                tty_out[i] = arena_alloc(dir_entries->mem, \
+                    strlen(curr->data.f_name) + \
                     get_f_max_strlen(INO_PRINTF) + 1);
                 if (tty_out[i] == NULL) {
-                    for (int j = 0; j < i; j++) {
-                        free(tty_out[j]);
-                    }
                     err = -1;
                 }
                 else {
@@ -396,7 +494,6 @@ char** get_tty_out(list *dir_entries) {
             assert(curr == NULL && i == dir_entries->size);
         }
         else {
-            free(tty_out);
             tty_out = NULL;
         }
     }
@@ -453,6 +550,9 @@ int get_options(const int argc, char **argv) {
         case 'l':
             option_l = true;
             break;
+        case 'O':
+            option_O = true;
+            break;
         case '?':
             ret = -1;
         }
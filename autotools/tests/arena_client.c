@@ -0,0 +1,48 @@
+/**
+ * Client of the arena shared by ls and find, for tests/common_arena. Carves
+ *   the number of pieces of the size given as arguments, checking each is
+ *   aligned and that the pieces don't overlap, then resets the arena and
+ *   carves them again. Prints the pieces carved and chunks allocated after
+ *   each round, and the bytes carved after the reset.
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include "../common_src/arena.h"
+
+/**
+ * Returns 0 on success and 1 if a piece is misplaced or allocation fails.
+ */
+int main(int argc, char **argv) {
+    arena_t arena;
+    unsigned char *piece = NULL, *last = NULL;
+    long count = argc > 2 ? atol(argv[1]) : 0;
+    size_t size = argc > 2 ? (size_t)atol(argv[2]) : 0;
+    int ret = size > 0 ? 0 : 1;
+
+    arena_create(&arena);
+    for (int round = 0; round < 2 && ret == 0; round++) {
+        last = NULL;
+        for (long i = 0; i < count && ret == 0; i++) {
+            piece = arena_alloc(&arena, size);
+            if (piece == NULL || (uintptr_t)piece % ARENA_ALIGN != 0) {
+                ret = 1;
+            }
+            else {
+                memset(piece, (unsigned char)i, size);
+                if (last != NULL && last[size - 1] != (unsigned char)(i - 1)) {
+                    ret = 1;
+                }
+                last = piece;
+            }
+        }
+        printf("%lu %lu\n", arena.alloc_c, arena.chunk_c);
+        arena_reset(&arena);
+        printf("%zu\n", arena.bytes);
+    }
+    piece = (unsigned char*)arena_strndup(&arena, "abcdef", 3);
+    if (ret == 0 && (piece == NULL || strcmp((char*)piece, "abc") != 0)) {
+        ret = 1;
+    }
+    arena_delete(&arena);
+    return ret;
+}
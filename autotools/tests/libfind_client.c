@@ -0,0 +1,116 @@
+/**
+ * Client of libfind for tests/find_libfind. Walks the tree at the first
+ *   argument with the expressions after it, printing the index of the query
+ *   that matched each file, its size and its path. Matches are pulled with
+ *   libfind_next, or pushed to a callback if the first argument is -c. If it
+ *   is -t, the tree is walked by CLIENT_THREADS threads at once, each with
+ *   its own finder, and each prints the number of matches it got.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include "../find_src/libfind.h"
+
+// Number of finders walking the tree at once with -t
+#define CLIENT_THREADS 4
+
+// A finder walking on a thread of its own, and the matches it got
+struct client_thread {
+    pthread_t thread;
+    char *root;
+    char **expr_argv;
+    unsigned long match_c;
+    libfind_err err;
+};
+
+bool print_match(libfind_match *match, void *data);
+bool count_match(libfind_match *match, void *data);
+void* run_thread(void *arg);
+
+/**
+ * Returns 0 on success and 1 if the tree could not be walked.
+ */
+int main(int argc, char **argv) {
+    struct client_thread threads[CLIENT_THREADS];
+    libfind_t *finder = NULL;
+    libfind_match match;
+    bool callback = argc > 1 && strcmp(argv[1], "-c") == 0;
+    bool threaded = argc > 1 && strcmp(argv[1], "-t") == 0;
+    int root_i = callback || threaded ? 2 : 1, ret = 0;
+
+    if (threaded && root_i < argc) {
+        for (int i = 0; i < CLIENT_THREADS; i++) {
+            threads[i].root = argv[root_i];
+            threads[i].expr_argv = &(argv[root_i + 1]);
+            threads[i].match_c = 0;
+            threads[i].err = LIBFIND_ERR_NONE;
+            pthread_create(&(threads[i].thread), NULL, run_thread, \
+                &(threads[i]));
+        }
+        for (int i = 0; i < CLIENT_THREADS; i++) {
+            pthread_join(threads[i].thread, NULL);
+            if (threads[i].err != LIBFIND_ERR_NONE) {
+                ret = 1;
+            }
+            printf("%lu\n", threads[i].match_c);
+        }
+    }
+    else if (root_i >= argc || libfind_open(&finder, argv[root_i], \
+            &(argv[root_i + 1]), LIBFIND_STREAM_DIRS) != LIBFIND_ERR_NONE) {
+        ret = 1;
+    }
+    else if (callback) {
+        ret = libfind_run(finder, print_match, NULL) != LIBFIND_ERR_NONE;
+    }
+    else {
+        match.path = "";
+        while (match.path != NULL && ret == 0) {
+            ret = libfind_next(finder, &match) != LIBFIND_ERR_NONE;
+            if (match.path != NULL) {
+                print_match(&match, NULL);
+            }
+        }
+    }
+    if (finder != NULL) {
+        libfind_close(finder);
+    }
+    return ret;
+}
+
+/**
+ * Prints match. data is unused.
+ * Returns true, to be given every match.
+ */
+bool print_match(libfind_match *match, void *data) {
+    (void)data;
+    printf("%d %lld %s\n", match->query, \
+        match->st != NULL ? (long long)match->st->st_size : -1LL, match->path);
+    return true;
+}
+
+/**
+ * Counts match in the client_thread data points to.
+ * Returns true, to be given every match.
+ */
+bool count_match(libfind_match *match, void *data) {
+    (void)match;
+    ((struct client_thread*)data)->match_c++;
+    return true;
+}
+
+/**
+ * Body of a thread of -t. Opens a finder of its own and counts its matches.
+ * Returns NULL.
+ */
+void* run_thread(void *arg) {
+    struct client_thread *thread = arg;
+    libfind_t *finder = NULL;
+
+    thread->err = libfind_open(&finder, thread->root, thread->expr_argv, \
+        LIBFIND_STREAM_DIRS);
+    if (thread->err == LIBFIND_ERR_NONE) {
+        thread->err = libfind_run(finder, count_match, thread);
+        libfind_close(finder);
+    }
+    return NULL;
+}